@@ -0,0 +1,106 @@
+#include "core/admission.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace https_server {
+
+static std::string build_overload_response(std::uint32_t retry_after_s) {
+    static const std::string body = "503 Service Unavailable\n";
+    return "HTTP/1.1 503 Service Unavailable\r\n"
+           "Content-Type: text/plain; charset=utf-8\r\n"
+           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+           "Retry-After: " + std::to_string(retry_after_s) + "\r\n"
+           "Connection: close\r\n"
+           "\r\n" + body;
+}
+
+AdmissionController::AdmissionController(const ServerConfig& config, size_t worker_count)
+    : min_limit_(static_cast<std::uint32_t>(std::max<size_t>(1, worker_count))),
+      max_limit_(std::max(min_limit_, config.max_pending_requests)),
+      target_delay_us_(static_cast<std::uint64_t>(config.queue_delay_target_ms) * 1000),
+      max_connections_(config.max_connections),
+      overload_response_(build_overload_response(config.retry_after_s)),
+      limit_(max_limit_),
+      in_flight_(0),
+      successes_(0),
+      last_decrease_us_(0),
+      connections_(0)
+{
+}
+
+bool AdmissionController::try_admit() noexcept {
+    const std::uint32_t limit = limit_.load(std::memory_order_relaxed);
+    if (in_flight_.fetch_add(1, std::memory_order_relaxed) >= limit) {
+        in_flight_.fetch_sub(1, std::memory_order_relaxed);
+        stats_.shed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    stats_.admitted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void AdmissionController::complete(std::uint64_t queue_delay_us, std::uint64_t now) noexcept {
+    in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    
+    if (target_delay_us_ == 0) {
+        return;
+    }
+    
+    if (queue_delay_us > target_delay_us_) {
+        decrease(now);
+    } else {
+        increase();
+    }
+}
+
+void AdmissionController::increase() noexcept {
+    // Additive increase: +1 once 'limit' requests in a row met the target.
+    std::uint32_t limit = limit_.load(std::memory_order_relaxed);
+    if (limit >= max_limit_) {
+        return;
+    }
+    if (successes_.fetch_add(1, std::memory_order_relaxed) + 1 < limit) {
+        return;
+    }
+    
+    successes_.store(0, std::memory_order_relaxed);
+    limit_.compare_exchange_strong(limit, limit + 1, std::memory_order_relaxed);
+}
+
+void AdmissionController::decrease(std::uint64_t now) noexcept {
+    // A burst of late requests is one congestion signal, not one per request.
+    std::uint64_t last = last_decrease_us_.load(std::memory_order_relaxed);
+    if (now - last < DECREASE_INTERVAL_US ||
+        !last_decrease_us_.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+        return;
+    }
+    
+    successes_.store(0, std::memory_order_relaxed);
+    std::uint32_t limit = limit_.load(std::memory_order_relaxed);
+    std::uint32_t reduced;
+    do {
+        reduced = std::max(min_limit_, limit - limit / 4);
+    } while (!limit_.compare_exchange_weak(limit, reduced, std::memory_order_relaxed));
+}
+
+bool AdmissionController::try_open_connection() noexcept {
+    const std::uint32_t open = connections_.fetch_add(1, std::memory_order_relaxed);
+    if (max_connections_ != 0 && open >= max_connections_) {
+        connections_.fetch_sub(1, std::memory_order_relaxed);
+        stats_.rejected_connections.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void AdmissionController::close_connection() noexcept {
+    connections_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+std::uint64_t AdmissionController::now_us() noexcept {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace https_server
@@ -0,0 +1,75 @@
+#ifndef HTTPS_SERVER_ADMISSION_HPP
+#define HTTPS_SERVER_ADMISSION_HPP
+
+#include "core/config.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace https_server {
+
+struct AdmissionStats {
+    std::atomic<std::uint64_t> admitted{0};
+    std::atomic<std::uint64_t> shed{0};
+    std::atomic<std::uint64_t> rejected_connections{0};
+};
+
+// Admission control in front of the thread pool. Requests queued or running
+// on the pool are bounded by an adaptive concurrency limit, tuned with AIMD
+// on queue delay (the time between enqueue and a worker picking the request
+// up). While delay stays under target, the limit grows by one per 'limit'
+// completions. When delay exceeds target, the limit is cut to 3/4, at most
+// once per decrease interval. The limit never exceeds max_pending_requests,
+// so the pool's queue is bounded. Over the limit, requests are shed with a
+// pre-serialized 503. Past max_connections, sockets are closed at accept.
+class AdmissionController {
+public:
+    AdmissionController(const ServerConfig& config, size_t worker_count);
+    
+    AdmissionController(const AdmissionController&) = delete;
+    AdmissionController& operator=(const AdmissionController&) = delete;
+    
+    // Reserves a slot for one request, or counts it as shed.
+    bool try_admit() noexcept;
+    
+    // Releases the slot and feeds the request's queue delay into the limit.
+    void complete(std::uint64_t queue_delay_us) noexcept { complete(queue_delay_us, now_us()); }
+    // The same at 'now', in now_us() microseconds, which paces decreases.
+    void complete(std::uint64_t queue_delay_us, std::uint64_t now) noexcept;
+    
+    bool try_open_connection() noexcept;
+    void close_connection() noexcept;
+    
+    // "503 Service Unavailable" with Retry-After and Connection: close.
+    const std::string& overload_response() const noexcept { return overload_response_; }
+    
+    std::uint32_t limit() const noexcept { return limit_.load(std::memory_order_relaxed); }
+    std::uint32_t in_flight() const noexcept { return in_flight_.load(std::memory_order_relaxed); }
+    std::uint32_t connections() const noexcept { return connections_.load(std::memory_order_relaxed); }
+    const AdmissionStats& stats() const noexcept { return stats_; }
+    
+    static std::uint64_t now_us() noexcept;
+
+private:
+    static constexpr std::uint64_t DECREASE_INTERVAL_US = 50000;
+    
+    void increase() noexcept;
+    void decrease(std::uint64_t now) noexcept;
+    
+    const std::uint32_t min_limit_;
+    const std::uint32_t max_limit_;
+    const std::uint64_t target_delay_us_;
+    const std::uint32_t max_connections_;
+    const std::string overload_response_;
+    
+    std::atomic<std::uint32_t> limit_;
+    std::atomic<std::uint32_t> in_flight_;
+    std::atomic<std::uint32_t> successes_;
+    std::atomic<std::uint64_t> last_decrease_us_;
+    std::atomic<std::uint32_t> connections_;
+    AdmissionStats stats_;
+};
+
+} // namespace https_server
+
+#endif // HTTPS_SERVER_ADMISSION_HPP
@@ -1,5 +1,7 @@
 #include "core/config.hpp"
 #include "nlohmann/json.hpp"
+#include <algorithm>
+#include <cctype>
 #include <fstream>
 #include <stdexcept>
 
@@ -7,6 +9,42 @@ using json = nlohmann::json;
 
 namespace https_server {
 
+void SecurityConfig::build_header_block() {
+    std::vector<std::pair<std::string, std::string>> fields;
+    
+    if (enable_hsts) {
+        std::string value = "max-age=" + hsts_max_age;
+        if (hsts_include_subdomains) {
+            value += "; includeSubDomains";
+        }
+        if (hsts_preload) {
+            value += "; preload";
+        }
+        fields.emplace_back("Strict-Transport-Security", value);
+    }
+    if (enable_csp) {
+        fields.emplace_back("Content-Security-Policy", csp_policy);
+    }
+    if (enable_xcto) {
+        fields.emplace_back("X-Content-Type-Options", "nosniff");
+    }
+    if (enable_xfo) {
+        fields.emplace_back("X-Frame-Options", "DENY");
+    }
+    fields.emplace_back("X-XSS-Protection", "1; mode=block");
+    fields.emplace_back("Referrer-Policy", "strict-origin-when-cross-origin");
+    fields.emplace_back("Permissions-Policy", "geolocation=(), microphone=(), camera=()");
+    
+    header_block.clear();
+    header_fields.clear();
+    for (auto& [name, value] : fields) {
+        header_block += name + ": " + value + "\r\n";
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        header_fields.emplace_back(std::move(name), std::move(value));
+    }
+}
+
 ServerConfig Config::load(const std::string& filename) {
     ServerConfig config;
     
@@ -20,12 +58,33 @@ ServerConfig Config::load(const std::string& filename) {
     
     if (j.contains("port")) config.port = j["port"];
     if (j.contains("threads")) config.threads = j["threads"];
+    if (j.contains("event_loops")) config.event_loops = j["event_loops"];
+    if (j.contains("listen_backlog")) config.listen_backlog = j["listen_backlog"];
     if (j.contains("cert_file")) config.cert_file = j["cert_file"];
     if (j.contains("key_file")) config.key_file = j["key_file"];
     if (j.contains("web_root")) config.web_root = j["web_root"];
     
     if (j.contains("client_ca_file")) config.client_ca_file = j["client_ca_file"];
     
+    if (j.contains("keep_alive_timeout_ms")) config.keep_alive_timeout_ms = j["keep_alive_timeout_ms"];
+    if (j.contains("max_keep_alive_requests")) config.max_keep_alive_requests = j["max_keep_alive_requests"];
+    if (j.contains("handshake_timeout_ms")) config.handshake_timeout_ms = j["handshake_timeout_ms"];
+    if (j.contains("header_timeout_ms")) config.header_timeout_ms = j["header_timeout_ms"];
+    if (j.contains("body_timeout_ms")) config.body_timeout_ms = j["body_timeout_ms"];
+    if (j.contains("write_timeout_ms")) config.write_timeout_ms = j["write_timeout_ms"];
+    if (j.contains("max_body_size")) config.max_body_size = j["max_body_size"];
+    
+    if (j.contains("max_pending_requests")) config.max_pending_requests = j["max_pending_requests"];
+    if (j.contains("queue_delay_target_ms")) config.queue_delay_target_ms = j["queue_delay_target_ms"];
+    if (j.contains("retry_after_s")) config.retry_after_s = j["retry_after_s"];
+    if (j.contains("max_connections")) config.max_connections = j["max_connections"];
+    
+    if (j.contains("http2")) config.http2 = j["http2"];
+    if (j.contains("http2_max_concurrent_streams")) config.http2_max_concurrent_streams = j["http2_max_concurrent_streams"];
+    if (j.contains("static_cache_size")) config.static_cache_size = j["static_cache_size"];
+    if (j.contains("static_cache_max_file_size")) config.static_cache_max_file_size = j["static_cache_max_file_size"];
+    if (j.contains("ktls")) config.ktls = j["ktls"];
+    
     if (j.contains("log_level")) {
         const std::string level = j["log_level"];
         if (level == "Debug") config.log_level = LogLevel::Debug;
@@ -34,6 +93,12 @@ ServerConfig Config::load(const std::string& filename) {
         else if (level == "Error") config.log_level = LogLevel::Error;
     }
     
+    if (j.contains("io_backend")) {
+        const std::string backend = j["io_backend"];
+        if (backend == "epoll") config.io_backend = IoBackend::Epoll;
+        else if (backend == "io_uring") config.io_backend = IoBackend::IoUring;
+    }
+    
     if (j.contains("security")) {
         const auto& security = j["security"];
         
@@ -62,6 +127,7 @@ ServerConfig Config::load(const std::string& filename) {
             config.security.csp_policy = security["csp_policy"];
         }
     }
+    config.security.build_header_block();
     
     return config;
 }
@@ -4,9 +4,16 @@
 #include "utils/logger.hpp"
 #include <string>
 #include <cstdint>
+#include <utility>
+#include <vector>
 
 namespace https_server {
 
+enum class IoBackend {
+    Epoll,
+    IoUring
+};
+
 struct SecurityConfig {
     bool enable_hsts = true;
     bool enable_csp = true;
@@ -16,11 +23,23 @@ struct SecurityConfig {
     bool hsts_include_subdomains = true;
     bool hsts_preload = false;
     std::string csp_policy = "default-src 'self'; script-src 'self' 'unsafe-inline'; style-src 'self' 'unsafe-inline'; img-src 'self' data:; font-src 'self'";
+    
+    // The header lines for the settings above, serialized once so responses
+    // append them with a single copy. Config::load builds it; call
+    // build_header_block() again after changing a field.
+    std::string header_block;
+    // The same headers with lowercase names, for HTTP/2.
+    std::vector<std::pair<std::string, std::string>> header_fields;
+    
+    void build_header_block();
 };
 
 struct ServerConfig {
     std::uint16_t port = 8443;
     std::uint32_t threads = 0;
+    std::uint32_t event_loops = 0;
+    std::uint32_t listen_backlog = 1024;
+    IoBackend io_backend = IoBackend::Epoll;
     std::string cert_file = "cert.pem";
     std::string key_file = "key.pem";
     std::string web_root = "public";
@@ -28,6 +47,51 @@ struct ServerConfig {
     
     std::string client_ca_file = "";
     
+    std::uint32_t keep_alive_timeout_ms = 5000;
+    std::uint32_t max_keep_alive_requests = 100;
+    
+    // Per-connection deadlines, 0 disables. Header and body deadlines run
+    // from the first byte of that part, so trickling data does not extend them.
+    // The write deadline restarts with each piece of a streamed response.
+    std::uint32_t handshake_timeout_ms = 10000;
+    std::uint32_t header_timeout_ms = 10000;
+    std::uint32_t body_timeout_ms = 30000;
+    std::uint32_t write_timeout_ms = 30000;
+    
+    // Largest request body accepted, after chunked decoding (0 = unlimited).
+    // Larger bodies get 413, before any of the body is read when the size
+    // is declared up front.
+    std::uint64_t max_body_size = 1048576;
+    
+    // Admission control: requests queued or running on the pool are capped
+    // at max_pending_requests, and the adaptive limit backs off while queue
+    // delay exceeds the target (0 keeps the limit fixed). Shed requests get a
+    // 503 with Retry-After. Connections past max_connections (0 = unlimited)
+    // are closed at accept.
+    std::uint32_t max_pending_requests = 1024;
+    std::uint32_t queue_delay_target_ms = 20;
+    std::uint32_t retry_after_s = 1;
+    std::uint32_t max_connections = 0;
+    
+    // HTTP/2 is offered through ALPN next to HTTP/1.1. Each stream counts
+    // against max_keep_alive_requests like a request on HTTP/1.1, and
+    // max_body_size applies per stream.
+    bool http2 = true;
+    std::uint32_t http2_max_concurrent_streams = 100;
+    
+    // Static files are kept in memory up to static_cache_size bytes (0
+    // disables the cache); files above static_cache_max_file_size are
+    // streamed from disk in pieces as each response is sent.
+    std::uint64_t static_cache_size = 67108864;
+    std::uint64_t static_cache_max_file_size = 1048576;
+    
+    // Kernel TLS: once the handshake is done, record encryption moves into
+    // the kernel and files streamed over HTTP/1.1 are sent with
+    // SSL_sendfile, never copied into userspace. Connections whose cipher or
+    // kernel does not support it, and the io_uring backend, keep TLS in
+    // userspace.
+    bool ktls = false;
+    
     SecurityConfig security;
 };
 
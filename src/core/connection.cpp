@@ -0,0 +1,1013 @@
+#ifdef _WIN32
+#define NOMINMAX
+#endif
+
+#include "core/connection.hpp"
+#include "utils/logger.hpp"
+#include "utils/http_accelerated.hpp"
+#include "http/http.hpp"
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <string_view>
+#include <stdexcept>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+namespace https_server {
+
+void log_openssl_errors();
+void close_socket(SOCKET s);
+
+Connection::Connection(SOCKET socket, SSL* ssl, EventLoop& loop, ThreadPool& pool,
+                       AdmissionController& admission, TlsStats& tls_stats, const Router& router,
+                       const ServerConfig& config)
+    : socket_(socket),
+      ssl_(ssl),
+      state_(State::Handshake),
+      read_phase_(ReadPhase::Idle),
+      interest_(EventLoop::EVENT_READ),
+      requests_served_(0),
+      keep_alive_(true),
+      request_keep_alive_(false),
+      request_head_(false),
+      completion_(loop.completion_io()),
+      send_in_flight_(false),
+      ktls_send_(false),
+      ktls_recv_(false),
+      loop_(loop),
+      pool_(pool),
+      admission_(admission),
+      tls_stats_(tls_stats),
+      router_(router),
+      config_(config),
+      timer_([this] { on_timeout(); }),
+      body_consumed_(0),
+      body_decoded_(0),
+      request_size_(0),
+      next_response_(0),
+      large_body_(),
+      body_sent_(0),
+      producer_(nullptr),
+      producer_chunked_(false),
+      producer_remaining_(0)
+{
+    batch_.reserve(MAX_PIPELINE_DEPTH);
+    responses_.reserve(MAX_PIPELINE_DEPTH);
+}
+
+Connection::~Connection() {
+    if (ssl_) {
+        SSL_free(ssl_);
+    }
+    
+    if (socket_ != static_cast<SOCKET>(-1)) {
+        close_socket(socket_);
+    }
+    
+    admission_.close_connection();
+}
+
+void Connection::start() {
+    if (completion_) {
+        BIO* rbio = BIO_new(BIO_s_mem());
+        BIO* wbio = BIO_new(BIO_s_mem());
+        if (!rbio || !wbio) {
+            BIO_free(rbio);
+            BIO_free(wbio);
+            throw std::runtime_error("Failed to allocate TLS memory BIOs");
+        }
+        BIO_set_mem_eof_return(rbio, -1);
+        BIO_set_mem_eof_return(wbio, -1);
+        SSL_set_bio(ssl_, rbio, wbio);
+        
+        loop_.start_receive(socket_, shared_from_this());
+    } else {
+        SSL_set_fd(ssl_, static_cast<int>(socket_));
+        
+        loop_.add_socket(socket_, shared_from_this(), EventLoop::EVENT_READ);
+    }
+    
+    arm_timeout(config_.handshake_timeout_ms);
+    do_handshake();
+}
+
+void Connection::on_event(std::uint32_t events) {
+    if (events & EventLoop::EVENT_ERROR) {
+        close();
+        return;
+    }
+    
+    switch (state_) {
+        case State::Handshake:
+            do_handshake();
+            break;
+        case State::Reading:
+            if (h2_) {
+                drive_http2();
+            } else {
+                do_read();
+            }
+            break;
+        case State::Processing:
+            read_ahead();
+            break;
+        case State::Writing:
+            if (events & EventLoop::EVENT_READ) {
+                read_ahead();
+            }
+            if (state_ == State::Writing) {
+                do_write();
+            }
+            break;
+        case State::Shutdown:
+            do_shutdown();
+            break;
+        case State::Closed:
+            break;
+    }
+}
+
+void Connection::on_receive(const char* data, int len) {
+    if (state_ == State::Closed) {
+        return;
+    }
+    
+    if (len <= 0) {
+        close();
+        return;
+    }
+    
+    BIO_write(SSL_get_rbio(ssl_), data, len);
+    on_event(EventLoop::EVENT_READ);
+}
+
+void Connection::flush_tls() {
+    if (send_in_flight_ || state_ == State::Closed) {
+        return;
+    }
+    
+    BIO* wbio = SSL_get_wbio(ssl_);
+    size_t pending;
+    while ((pending = BIO_ctrl_pending(wbio)) > 0) {
+        tls_out_.ensure_capacity(pending);
+        const int bytes_read = BIO_read(wbio, tls_out_.write_ptr(), static_cast<int>(pending));
+        if (bytes_read <= 0) {
+            break;
+        }
+        tls_out_.has_written(static_cast<size_t>(bytes_read));
+    }
+    
+    const bool close_after = state_ == State::Shutdown;
+    if (tls_out_.readable_bytes() == 0) {
+        if (close_after) {
+            close();
+        }
+        return;
+    }
+    
+    send_in_flight_ = true;
+    auto self = shared_from_this();
+    const auto view = tls_out_.readable_view();
+    
+    if (close_after) {
+        // The loop closes the socket once the final flight is on the wire.
+        loop_.remove_socket(socket_);
+    }
+    
+    loop_.submit_send(socket_, view.data(), view.size(), [self](int result) {
+        self->on_send_complete(result);
+    }, close_after);
+    
+    if (close_after) {
+        socket_ = static_cast<SOCKET>(-1);
+        close();
+    }
+}
+
+void Connection::on_send_complete(int result) {
+    send_in_flight_ = false;
+    if (state_ == State::Closed) {
+        return;
+    }
+    
+    if (result < 0) {
+        close();
+        return;
+    }
+    
+    tls_out_.consume(static_cast<size_t>(result));
+    flush_tls();
+    
+    if (producer_ && state_ == State::Writing) {
+        do_write();
+    } else if (h2_ && state_ == State::Reading) {
+        drive_http2();
+    }
+}
+
+void Connection::do_handshake() {
+    const int result = SSL_accept(ssl_);
+    if (result == 1) {
+        tls_stats_.handshakes.fetch_add(1, std::memory_order_relaxed);
+        if (!completion_) {
+            ktls_send_ = BIO_get_ktls_send(SSL_get_wbio(ssl_)) != 0;
+            ktls_recv_ = BIO_get_ktls_recv(SSL_get_rbio(ssl_)) != 0;
+            if (ktls_send_) {
+                tls_stats_.ktls_send.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (ktls_recv_) {
+                tls_stats_.ktls_recv.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        LOG_DEBUG(std::string("Handshake done: ") + SSL_get_version(ssl_) + " " + SSL_get_cipher_name(ssl_) +
+                  ", kTLS TX " + (ktls_send_ ? "on" : "off") + ", RX " + (ktls_recv_ ? "on" : "off"));
+        
+        const unsigned char* protocol = nullptr;
+        unsigned int length = 0;
+        SSL_get0_alpn_selected(ssl_, &protocol, &length);
+        if (length == 2 && std::memcmp(protocol, "h2", 2) == 0) {
+            start_http2();
+            return;
+        }
+        
+        state_ = State::Reading;
+        read_phase_ = ReadPhase::Headers;
+        arm_timeout(config_.header_timeout_ms);
+        do_read();
+        return;
+    }
+    
+    if (!wait_for_io(result)) {
+        LOG_WARNING("SSL handshake failed");
+        log_openssl_errors();
+        close();
+    }
+}
+
+void Connection::do_read() {
+    while (true) {
+        // Each request is parsed right behind the ones already batched.
+        const std::string_view view = in_.readable_view().substr(request_size_);
+        if (parser_.status() != http_accelerated::ParseStatus::Complete) {
+            const auto status = parser_.parse(view.data(), view.size());
+            if (status != http_accelerated::ParseStatus::Complete && !batch_.empty()) {
+                // Answer what is complete now; the rest is read, or
+                // rejected, once those responses are written.
+                dispatch_batch();
+                return;
+            }
+            
+            switch (status) {
+                case http_accelerated::ParseStatus::Complete:
+                    if (!begin_body()) {
+                        return;
+                    }
+                    break;
+                case http_accelerated::ParseStatus::Error:
+                    LOG_WARNING("Malformed request from client: " +
+                                std::string(http_accelerated::to_string(parser_.error())));
+                    if (parser_.error() == http_accelerated::ParseError::HeadersTooLarge ||
+                        parser_.error() == http_accelerated::ParseError::TooManyHeaders) {
+                        reject_request(431, "Request Header Fields Too Large");
+                    } else {
+                        reject_request(400, "Bad Request");
+                    }
+                    return;
+                case http_accelerated::ParseStatus::Incomplete:
+                    if (!view.empty()) {
+                        enter_read_phase(ReadPhase::Headers);
+                    }
+                    break;
+            }
+        }
+        
+        if (parser_.status() == http_accelerated::ParseStatus::Complete) {
+            switch (read_body()) {
+                case http::BodyStatus::Complete:
+                    if (!queue_request()) {
+                        dispatch_batch();
+                        return;
+                    }
+                    continue;
+                case http::BodyStatus::Error:
+                    return;
+                case http::BodyStatus::Incomplete:
+                    enter_read_phase(ReadPhase::Body);
+                    break;
+            }
+        }
+        
+        in_.ensure_capacity(4096);
+        const int bytes_read = SSL_read(ssl_, in_.write_ptr(), static_cast<int>(in_.writable_bytes()));
+        if (bytes_read <= 0) {
+            if (!wait_for_io(bytes_read)) {
+                close();
+            }
+            return;
+        }
+        
+        in_.has_written(static_cast<size_t>(bytes_read));
+    }
+}
+
+void Connection::read_ahead() {
+    // Pipelined requests keep being decrypted while the batch before them is
+    // handled and written, so the next batch is parsed and dispatched as
+    // soon as this one is out. While the batch is on the pool its requests
+    // view in_, so only its spare capacity is used then. Read failures are
+    // left for do_read to hit again once the responses are written.
+    while (in_.readable_bytes() < READ_AHEAD_LIMIT) {
+        if (state_ != State::Processing) {
+            in_.ensure_capacity(4096);
+        }
+        const size_t room = std::min(in_.writable_bytes(), READ_AHEAD_LIMIT - in_.readable_bytes());
+        if (room == 0) {
+            return;
+        }
+        
+        const int bytes_read = SSL_read(ssl_, in_.write_ptr(), static_cast<int>(room));
+        if (bytes_read <= 0) {
+            const int error = SSL_get_error(ssl_, bytes_read);
+            if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) {
+                ERR_clear_error();
+            }
+            return;
+        }
+        
+        in_.has_written(static_cast<size_t>(bytes_read));
+    }
+}
+
+bool Connection::begin_body() {
+    const std::string_view raw = in_.readable_view().substr(request_size_);
+    const bool framed = http::assign_request(parser_, raw, request_);
+    const auto max_body_size = static_cast<size_t>(config_.max_body_size);
+    const StreamingHandlerFactory* factory = framed ? router_.find_streaming_route(request_) : nullptr;
+    
+    if (!batch_.empty()) {
+        // Behind a batched request only plain requests whose whole body is
+        // already here are taken. Anything else waits for the batch to be
+        // answered: chunked bodies are decoded in place, streamed ones
+        // consume in_, and rejections clear it.
+        const bool buffered = framed && !factory && !request_.chunked &&
+            (max_body_size == 0 || request_.content_length <= max_body_size) &&
+            raw.size() - parser_.header_length() >= request_.content_length;
+        if (!buffered) {
+            dispatch_batch();
+            return false;
+        }
+    }
+    
+    if (!framed) {
+        LOG_WARNING("Unsupported request body framing from client");
+        reject_request(400, "Bad Request");
+        return false;
+    }
+    LOG_DEBUG("Request: " + std::string(request_.method) + " " + std::string(request_.uri));
+    
+    if (request_.chunked) {
+        body_.start_chunked(max_body_size);
+    } else if (max_body_size != 0 && request_.content_length > max_body_size) {
+        reject_request(413, "Payload Too Large");
+        return false;
+    } else {
+        body_.start_length(request_.content_length);
+    }
+    body_consumed_ = 0;
+    body_decoded_ = 0;
+    request_keep_alive_ = request_.keep_alive();
+    request_head_ = request_.method == "HEAD";
+    
+    if (factory) {
+        try {
+            stream_ = (*factory)(request_);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Handler failed: " + std::string(e.what()));
+        }
+        if (!stream_) {
+            reject_request(500, "Internal Server Error");
+            return false;
+        }
+        
+        // Nothing refers to the head any more; body bytes are handed to the
+        // handler and dropped as they are decoded.
+        in_.consume(parser_.header_length());
+    }
+    return true;
+}
+
+http::BodyStatus Connection::read_body() {
+    // Buffered bodies are decoded in place, compacted right behind the head
+    // so request_.body can view them; streamed ones start at the front.
+    const size_t base = stream_ ? 0 : request_size_ + parser_.header_length();
+    char* const data = in_.read_ptr() + base;
+    char* const out = data + body_decoded_;
+    size_t consumed = 0;
+    size_t produced = 0;
+    const http::BodyStatus status = body_.decode(data + body_consumed_, in_.readable_bytes() - base - body_consumed_,
+                                                 out, consumed, produced);
+    
+    if (stream_) {
+        if (produced > 0) {
+            try {
+                stream_->on_body(std::string_view(out, produced));
+            } catch (const std::exception& e) {
+                LOG_ERROR("Handler failed: " + std::string(e.what()));
+                reject_request(500, "Internal Server Error");
+                return http::BodyStatus::Error;
+            }
+        }
+        in_.consume(consumed);
+    } else {
+        body_consumed_ += consumed;
+        body_decoded_ += produced;
+    }
+    
+    if (status == http::BodyStatus::Error) {
+        if (body_.error() == http::BodyError::TooLarge) {
+            reject_request(413, "Payload Too Large");
+        } else {
+            LOG_WARNING("Malformed chunked body from client");
+            reject_request(400, "Bad Request");
+        }
+    }
+    return status;
+}
+
+void Connection::reject_request(int status_code, const std::string& status_text) {
+    responses_.clear();
+    http::HttpResponse& response = responses_.emplace_back();
+    response.status_code = status_code;
+    response.status_text = status_text;
+    response.body = "<h1>" + std::to_string(status_code) + " " + status_text + "</h1>";
+    response.headers["Connection"] = "close";
+    in_.clear();
+    request_size_ = 0;
+    start_write(false);
+}
+
+bool Connection::queue_request() {
+    ++requests_served_;
+    const bool keep_alive = request_keep_alive_ &&
+        (config_.max_keep_alive_requests == 0 || requests_served_ < config_.max_keep_alive_requests);
+    
+    if (stream_) {
+        // Head and body were consumed as they were decoded, and the handler
+        // builds the response without the request.
+        batch_.push_back(PipelinedRequest{http::HttpRequest{}, keep_alive, request_head_});
+        return false;
+    }
+    
+    // The views are re-taken since in_ may have moved while the body was
+    // arriving; from here on in_ only grows into its spare capacity until
+    // the batch is answered.
+    const std::string_view raw = in_.readable_view().substr(request_size_);
+    http::assign_request(parser_, raw, request_);
+    request_.body = raw.substr(parser_.header_length(), body_decoded_);
+    request_size_ += parser_.header_length() + body_consumed_;
+    batch_.push_back(PipelinedRequest{request_, keep_alive, request_head_});
+    parser_.reset();
+    
+    return keep_alive && batch_.size() < MAX_PIPELINE_DEPTH;
+}
+
+void Connection::dispatch_batch() {
+    state_ = State::Processing;
+    timer_.cancel();
+    set_interest(EventLoop::EVENT_READ);
+    
+    if (!admission_.try_admit()) {
+        LOG_DEBUG("Shedding request, limit " + std::to_string(admission_.limit()));
+        send_serialized(admission_.overload_response());
+        return;
+    }
+    
+    // The batch and its responses stay with the connection, which does not
+    // touch them again until the task posts back, so the task only
+    // captures 'self'. One task per batch keeps the responses in request
+    // order and pays for one handoff.
+    auto self = shared_from_this();
+    const std::uint64_t queued_at = AdmissionController::now_us();
+    pool_.enqueue([self, queued_at] {
+        const std::uint64_t queue_delay = AdmissionController::now_us() - queued_at;
+        
+        // The previous batch's responses are gone, so the arena starts over.
+        // Responses are moved into place rather than assigned, which would
+        // copy them out of the arena.
+        ArenaScope scope(self->arena_);
+        self->responses_.clear();
+        self->arena_.reset();
+        const std::uint32_t timeout_ms = self->config_.keep_alive_timeout_ms;
+        for (size_t i = 0; i < self->batch_.size(); ++i) {
+            PipelinedRequest& pipelined = self->batch_[i];
+            http::HttpResponse& response =
+                self->responses_.emplace_back(self->run_handler(self->stream_.get(), pipelined.request));
+            response.omit_body = pipelined.head;
+            
+            if (response.closes_connection()) {
+                pipelined.keep_alive = false;
+            }
+            if (!pipelined.keep_alive) {
+                // Nothing is sent after a close, so the requests behind it
+                // are left unanswered, as the client expects, and not run.
+                response.headers["Connection"] = "close";
+                self->batch_.erase(self->batch_.begin() + static_cast<std::ptrdiff_t>(i) + 1, self->batch_.end());
+                break;
+            }
+            response.headers["Connection"] = "keep-alive";
+            // Whole seconds, rounded up since "timeout=0" reads as already
+            // closed; a disabled timeout is not advertised.
+            if (timeout_ms != 0) {
+                response.headers["Keep-Alive"] = "timeout=" + std::to_string((timeout_ms + 999) / 1000);
+            }
+        }
+        
+        self->admission_.complete(queue_delay);
+        self->loop_.post([self] {
+            self->send_responses();
+        });
+    });
+}
+
+http::HttpResponse Connection::run_handler(StreamingHandler* handler, http::HttpRequest& request) const {
+    try {
+        http::HttpResponse response = handler ? handler->on_complete() : router_.route_request(request);
+        // HTTP/1.0 has no chunked coding.
+        if (response.chunked() && request.http_version == "HTTP/1.0") {
+            response.buffer_body();
+        }
+        return response;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Handler failed: " + std::string(e.what()));
+        http::HttpResponse response;
+        response.status_code = 500;
+        response.status_text = "Internal Server Error";
+        response.body = "<h1>500 Internal Server Error</h1>";
+        return response;
+    }
+}
+
+void Connection::send_responses() {
+    if (state_ == State::Closed) {
+        return;
+    }
+    
+    start_write(batch_.back().keep_alive);
+}
+
+void Connection::send_serialized(const std::string& response) {
+    if (state_ == State::Closed) {
+        return;
+    }
+    
+    out_.append(response);
+    start_write(false);
+}
+
+void Connection::start_write(bool keep_alive) {
+    in_.consume(request_size_);
+    request_size_ = 0;
+    batch_.clear();
+    parser_.reset();
+    stream_.reset();
+    next_response_ = 0;
+    large_body_ = {};
+    body_sent_ = 0;
+    producer_ = nullptr;
+    keep_alive_ = keep_alive;
+    state_ = State::Writing;
+    arm_timeout(config_.write_timeout_ms);
+    do_write();
+}
+
+void Connection::fill_output() {
+    // Heads and bodies up to a record are serialized into out_ behind what
+    // is still there, so back-to-back responses share records and
+    // SSL_writes. A larger body tops the current record up with its start;
+    // the rest is written from where the handler left it, without a copy,
+    // once out_ has drained.
+    while (large_body_.empty() && !producer_ && next_response_ < responses_.size()) {
+        const http::HttpResponse& response = responses_[next_response_++];
+        response.write_head(out_);
+        
+        if (response.omit_body) {
+            continue;
+        }
+        if (response.producer) {
+            producer_ = response.producer.get();
+            producer_chunked_ = response.chunked();
+            if (!producer_chunked_) {
+                const std::string_view length = response.headers.find("Content-Length")->second;
+                const auto result = std::from_chars(length.data(), length.data() + length.size(), producer_remaining_);
+                if (result.ec != std::errc() || result.ptr != length.data() + length.size()) {
+                    producer_remaining_ = 0;
+                }
+                if (producer_remaining_ == 0) {
+                    producer_ = nullptr;
+                }
+            }
+            continue;
+        }
+        if (const http::FileRegion* region = response.file_region()) {
+            if (region->length > 0) {
+                file_reader_.reset(*region);
+                producer_ = &file_reader_;
+                producer_chunked_ = false;
+                producer_remaining_ = region->length;
+            }
+            continue;
+        }
+        
+        const std::string_view body = response.payload();
+        if (body.size() <= TLS_RECORD_SIZE) {
+            out_.append(body.data(), body.size());
+            continue;
+        }
+        body_sent_ = TLS_RECORD_SIZE - out_.readable_bytes() % TLS_RECORD_SIZE;
+        out_.append(body.data(), body_sent_);
+        large_body_ = body;
+    }
+}
+
+bool Connection::send_backlogged() {
+    if (!completion_) {
+        return false;
+    }
+    // Records sealed while a send is in flight wait in the write BIO.
+    flush_tls();
+    return tls_out_.readable_bytes() + BIO_ctrl_pending(SSL_get_wbio(ssl_)) >= SEND_WINDOW;
+}
+
+bool Connection::produce_body() {
+    // Chunks are framed around the producer's output in place: a fixed
+    // four-digit size (a record is at most 0x4000 bytes) and CRLF in front,
+    // CRLF and, after the last one, the zero-size chunk behind.
+    static constexpr size_t CHUNK_HEAD = 6;
+    static constexpr size_t CHUNK_OVERHEAD = CHUNK_HEAD + 2 + 5;
+    
+    const size_t overhead = producer_chunked_ ? CHUNK_OVERHEAD : 0;
+    size_t capacity = TLS_RECORD_SIZE - out_.readable_bytes() - overhead;
+    if (!producer_chunked_) {
+        capacity = static_cast<size_t>(std::min<std::uint64_t>(capacity, producer_remaining_));
+    }
+    out_.ensure_capacity(capacity + overhead);
+    char* const frame = out_.write_ptr();
+    char* const data = frame + (producer_chunked_ ? CHUNK_HEAD : 0);
+    
+    bool done = false;
+    size_t produced = 0;
+    try {
+        produced = std::min(producer_->produce(data, capacity, done), capacity);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Handler failed: " + std::string(e.what()));
+        return false;
+    }
+    if (produced == 0 && !done) {
+        LOG_ERROR("Response body producer stalled");
+        return false;
+    }
+    
+    size_t length = produced;
+    if (producer_chunked_) {
+        static constexpr char HEX[] = "0123456789abcdef";
+        length = 0;
+        if (produced > 0) {
+            for (size_t i = 0; i < 4; ++i) {
+                frame[3 - i] = HEX[(produced >> (4 * i)) & 0xf];
+            }
+            std::memcpy(frame + 4, "\r\n", 2);
+            std::memcpy(data + produced, "\r\n", 2);
+            length = CHUNK_HEAD + produced + 2;
+        }
+        if (done) {
+            std::memcpy(frame + length, "0\r\n\r\n", 5);
+            length += 5;
+        }
+    } else {
+        producer_remaining_ -= produced;
+        if (done && producer_remaining_ > 0) {
+            LOG_ERROR("Response body shorter than its Content-Length");
+            return false;
+        }
+        done = producer_remaining_ == 0;
+    }
+    
+    out_.has_written(length);
+    if (done) {
+        producer_ = nullptr;
+    }
+    arm_timeout(config_.write_timeout_ms);
+    return true;
+}
+
+void Connection::do_write() {
+    while (true) {
+        fill_output();
+        
+        // With kernel TLS a file region goes from the page cache to the
+        // socket once everything ahead of it has been written.
+        if (producer_ == &file_reader_ && ktls_send_ && out_.readable_bytes() == 0) {
+            const ossl_ssize_t sent = SSL_sendfile(ssl_, file_reader_.fd(),
+                                                   static_cast<off_t>(file_reader_.position()),
+                                                   static_cast<size_t>(std::min<std::uint64_t>(
+                                                       producer_remaining_, SENDFILE_CHUNK)), 0);
+            if (sent <= 0) {
+                if (!wait_for_io(static_cast<int>(sent))) {
+                    close();
+                }
+                return;
+            }
+            file_reader_.advance(static_cast<std::uint64_t>(sent));
+            producer_remaining_ -= static_cast<std::uint64_t>(sent);
+            if (producer_remaining_ == 0) {
+                producer_ = nullptr;
+            }
+            arm_timeout(config_.write_timeout_ms);
+            continue;
+        }
+        
+        // The next piece of a streamed body is only produced once the
+        // socket has taken all but half a record of what came before.
+        if (producer_ && out_.readable_bytes() < TLS_RECORD_SIZE / 2) {
+            if (send_backlogged()) {
+                return;
+            }
+            if (!produce_body()) {
+                close();
+                return;
+            }
+            continue;
+        }
+        
+        const bool from_out = out_.readable_bytes() > 0;
+        const std::string_view pending = from_out ? out_.readable_view()
+            : large_body_.empty() ? std::string_view() : large_body_.substr(body_sent_);
+        if (pending.empty()) {
+            if (large_body_.empty()) {
+                break;
+            }
+            large_body_ = {};
+            continue;
+        }
+        
+        const int written = SSL_write(ssl_, pending.data(),
+                                      static_cast<int>(std::min<size_t>(pending.size(), INT_MAX)));
+        if (written <= 0) {
+            if (!wait_for_io(written)) {
+                close();
+            }
+            return;
+        }
+        
+        if (from_out) {
+            out_.consume(static_cast<size_t>(written));
+        } else {
+            body_sent_ += static_cast<size_t>(written);
+        }
+    }
+    responses_.clear();
+    
+    if (completion_) {
+        flush_tls();
+    }
+    
+    if (!keep_alive_) {
+        state_ = State::Shutdown;
+        do_shutdown();
+        return;
+    }
+    
+    state_ = State::Reading;
+    enter_read_phase(ReadPhase::Idle);
+    set_interest(EventLoop::EVENT_READ);
+    do_read();
+}
+
+void Connection::start_http2() {
+    http2::Session::Settings settings;
+    settings.max_concurrent_streams = config_.http2_max_concurrent_streams;
+    settings.max_body_size = config_.max_body_size;
+    settings.max_requests = config_.max_keep_alive_requests;
+    h2_ = std::make_unique<http2::Session>(router_, settings);
+    
+    state_ = State::Reading;
+    h2_->start(out_);
+    drive_http2();
+}
+
+void Connection::drive_http2() {
+    // Reading pauses while out_ is full, so it resumes whenever a write has
+    // emptied it.
+    while (state_ == State::Reading) {
+        const bool paused = http2_read();
+        if (state_ != State::Reading || !http2_write() || !paused) {
+            break;
+        }
+    }
+}
+
+bool Connection::http2_read() {
+    while (out_.readable_bytes() < HTTP2_OUTPUT_LIMIT) {
+        const bool received = h2_->receive(in_, out_, h2_ready_);
+        if (received) {
+            for (http2::Stream* stream : h2_ready_) {
+                dispatch_stream(*stream);
+            }
+        }
+        h2_ready_.clear();
+        if (!received) {
+            // The GOAWAY is in out_; http2_write sends it and shuts down.
+            return false;
+        }
+        
+        in_.ensure_capacity(4096);
+        const int bytes_read = SSL_read(ssl_, in_.write_ptr(), static_cast<int>(in_.writable_bytes()));
+        if (bytes_read <= 0) {
+            if (!wait_for_io(bytes_read)) {
+                close();
+            }
+            return false;
+        }
+        
+        in_.has_written(static_cast<size_t>(bytes_read));
+    }
+    return true;
+}
+
+bool Connection::http2_write() {
+    while (true) {
+        // Frames are only produced once the socket has taken what came
+        // before, a record at a time.
+        if (out_.readable_bytes() < TLS_RECORD_SIZE && !send_backlogged()) {
+            h2_->write(out_, TLS_RECORD_SIZE);
+        }
+        if (out_.readable_bytes() == 0) {
+            break;
+        }
+        
+        const int written = SSL_write(ssl_, out_.read_ptr(),
+                                      static_cast<int>(std::min(out_.readable_bytes(), TLS_RECORD_SIZE)));
+        if (written <= 0) {
+            if (!wait_for_io(written)) {
+                close();
+            }
+            return false;
+        }
+        out_.consume(static_cast<size_t>(written));
+    }
+    
+    if (completion_) {
+        flush_tls();
+    }
+    
+    if (h2_->finished()) {
+        state_ = State::Shutdown;
+        do_shutdown();
+        return false;
+    }
+    
+    // Idle without streams, unguarded while every stream is with a handler,
+    // and otherwise bounded like a write.
+    set_interest(EventLoop::EVENT_READ);
+    if (h2_->open_streams() == 0) {
+        arm_timeout(config_.keep_alive_timeout_ms);
+    } else if (h2_->open_streams() == h2_->handling_streams()) {
+        timer_.cancel();
+    } else {
+        arm_timeout(config_.write_timeout_ms);
+    }
+    return true;
+}
+
+void Connection::dispatch_stream(http2::Stream& stream) {
+    if (!admission_.try_admit()) {
+        LOG_DEBUG("Shedding stream, limit " + std::to_string(admission_.limit()));
+        h2_->refuse(stream, out_);
+        return;
+    }
+    
+    // The session leaves a stream's request and response alone while it is
+    // with the handler, and keeps the stream until it is passed back.
+    auto self = shared_from_this();
+    http2::Stream* const target = &stream;
+    const std::uint64_t queued_at = AdmissionController::now_us();
+    pool_.enqueue([self, target, queued_at] {
+        const std::uint64_t queue_delay = AdmissionController::now_us() - queued_at;
+        ArenaScope scope(target->arena);
+        target->arena.reset();
+        target->response.emplace(self->run_handler(target->handler.get(), target->request));
+        
+        self->admission_.complete(queue_delay);
+        self->loop_.post([self, target] {
+            if (self->state_ != State::Reading) {
+                return;
+            }
+            self->h2_->respond(*target);
+            self->drive_http2();
+        });
+    });
+}
+
+void Connection::do_shutdown() {
+    const int result = SSL_shutdown(ssl_);
+    if (completion_) {
+        flush_tls();
+        return;
+    }
+    
+    if (result < 0 && wait_for_io(result)) {
+        return;
+    }
+    
+    close();
+}
+
+void Connection::close() {
+    if (state_ == State::Closed) {
+        return;
+    }
+    
+    state_ = State::Closed;
+    timer_.cancel();
+    
+    SSL_free(ssl_);
+    ssl_ = nullptr;
+    
+    // The error queue is per thread; anything this connection left behind
+    // would make SSL_get_error report SSL_ERROR_SSL for the next one.
+    ERR_clear_error();
+    
+    if (socket_ != static_cast<SOCKET>(-1)) {
+        loop_.remove_socket(socket_);
+        close_socket(socket_);
+        socket_ = static_cast<SOCKET>(-1);
+    }
+}
+
+bool Connection::wait_for_io(int result) {
+    switch (SSL_get_error(ssl_, result)) {
+        case SSL_ERROR_WANT_READ:
+            if (completion_) {
+                flush_tls();
+            }
+            set_interest(EventLoop::EVENT_READ);
+            return true;
+        case SSL_ERROR_WANT_WRITE:
+            // A blocked response keeps reading pipelined requests, or HTTP/2
+            // frames, meanwhile.
+            set_interest(state_ == State::Writing || h2_ ? EventLoop::EVENT_READ | EventLoop::EVENT_WRITE
+                                                         : EventLoop::EVENT_WRITE);
+            return true;
+        default:
+            return false;
+    }
+}
+
+void Connection::set_interest(std::uint32_t events) {
+    if (events != interest_ && state_ != State::Closed && !completion_) {
+        interest_ = events;
+        loop_.modify_socket(socket_, events);
+    }
+}
+
+void Connection::enter_read_phase(ReadPhase phase) {
+    if (read_phase_ == phase) {
+        return;
+    }
+    
+    read_phase_ = phase;
+    switch (phase) {
+        case ReadPhase::Idle:
+            arm_timeout(config_.keep_alive_timeout_ms);
+            break;
+        case ReadPhase::Headers:
+            arm_timeout(config_.header_timeout_ms);
+            break;
+        case ReadPhase::Body:
+            arm_timeout(config_.body_timeout_ms);
+            break;
+    }
+}
+
+void Connection::arm_timeout(std::uint32_t timeout_ms) {
+    if (timeout_ms == 0) {
+        timer_.cancel();
+        return;
+    }
+    
+    loop_.schedule(timer_, timeout_ms);
+}
+
+void Connection::on_timeout() {
+    if (state_ == State::Closed) {
+        return;
+    }
+    
+    LOG_DEBUG("Connection timed out");
+    auto self = shared_from_this();
+    close();
+}
+
+} // namespace https_server
@@ -0,0 +1,203 @@
+#ifndef HTTPS_SERVER_CONNECTION_HPP
+#define HTTPS_SERVER_CONNECTION_HPP
+
+#include "core/admission.hpp"
+#include "core/event_loop.hpp"
+#include "core/timer_wheel.hpp"
+#include "core/thread_pool.hpp"
+#include "core/config.hpp"
+#include "http/body_reader.hpp"
+#include "http/http2.hpp"
+#include "http/router.hpp"
+#include "utils/arena.hpp"
+#include "utils/buffer.hpp"
+#include "utils/http_accelerated.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ssl_st;
+using SSL = struct ssl_st;
+
+namespace https_server {
+
+// Completed handshakes, and how many of them moved record encryption into
+// the kernel in each direction.
+struct TlsStats {
+    std::atomic<std::uint64_t> handshakes{0};
+    std::atomic<std::uint64_t> ktls_send{0};
+    std::atomic<std::uint64_t> ktls_recv{0};
+};
+
+// Non-blocking TLS connection driven by EventLoop readiness events, or by
+// completions when the loop does its own I/O (io_uring). In completion mode
+// OpenSSL runs over memory BIOs and ciphertext is moved by the loop.
+// All state transitions happen on the loop thread; only the routed handlers
+// run on the thread pool and their responses are posted back.
+// Pipelined requests that are already complete in the receive buffer are
+// dispatched together, in order, as one pool task, and their responses are
+// coalesced into as few SSL_writes and TLS records as possible.
+// Streamed response bodies are produced a record at a time, only once the
+// socket has taken what came before.
+// A connection that negotiates h2 through ALPN hands its plaintext to an
+// http2::Session instead and stays in Reading; each stream is dispatched to
+// the pool on its own as soon as its request is complete.
+// With kernel TLS, files streamed over HTTP/1.1 go out with SSL_sendfile.
+// The loop dispatches straight to the object, so the fields touched on every
+// event are grouped at the front and the object starts on a cache line.
+class alignas(64) Connection : public EventHandler, public std::enable_shared_from_this<Connection> {
+public:
+    enum class State {
+        Handshake,
+        Reading,
+        Processing,
+        Writing,
+        Shutdown,
+        Closed
+    };
+    
+    Connection(SOCKET socket, SSL* ssl, EventLoop& loop, ThreadPool& pool,
+               AdmissionController& admission, TlsStats& tls_stats, const Router& router,
+               const ServerConfig& config);
+    ~Connection();
+    
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+    
+    void start();
+    void on_event(std::uint32_t events) override;
+    void on_receive(const char* data, int len) override;
+    
+    State state() const noexcept { return state_; }
+    // Whether the kernel encrypts what is sent, and decrypts what is
+    // received, known once the handshake is done.
+    bool ktls_send() const noexcept { return ktls_send_; }
+    bool ktls_recv() const noexcept { return ktls_recv_; }
+
+private:
+    // Plaintext per SSL_write: one full TLS record.
+    static constexpr size_t TLS_RECORD_SIZE = 16384;
+    // Most pipelined requests dispatched as one batch.
+    static constexpr size_t MAX_PIPELINE_DEPTH = 16;
+    // Received bytes buffered ahead of the request being answered.
+    static constexpr size_t READ_AHEAD_LIMIT = 64 * 1024;
+    // Ciphertext queued for the loop to send before a streamed body stops
+    // being produced, in completion mode where SSL_write never blocks.
+    static constexpr size_t SEND_WINDOW = 4 * TLS_RECORD_SIZE;
+    // Output queued before an HTTP/2 connection stops reading frames, which
+    // bounds what a client that does not read can make it queue.
+    static constexpr size_t HTTP2_OUTPUT_LIMIT = 64 * 1024;
+    // Most file bytes handed to one SSL_sendfile, so one large response
+    // does not hold the loop while the socket keeps taking data.
+    static constexpr size_t SENDFILE_CHUNK = 64 * TLS_RECORD_SIZE;
+    
+    // Which deadline guards the Reading state: keep-alive idle before the
+    // next request starts, then header-read and body-read.
+    enum class ReadPhase {
+        Idle,
+        Headers,
+        Body
+    };
+    
+    struct PipelinedRequest {
+        http::HttpRequest request;
+        bool keep_alive;
+        bool head;
+    };
+    
+    void do_handshake();
+    void do_read();
+    void read_ahead();
+    void do_write();
+    void do_shutdown();
+    void close();
+    
+    void on_send_complete(int result);
+    void flush_tls();
+    
+    bool begin_body();
+    http::BodyStatus read_body();
+    bool queue_request();
+    void dispatch_batch();
+    void reject_request(int status_code, const std::string& status_text);
+    http::HttpResponse run_handler(StreamingHandler* handler, http::HttpRequest& request) const;
+    void send_responses();
+    void send_serialized(const std::string& response);
+    void start_write(bool keep_alive);
+    void fill_output();
+    bool produce_body();
+    bool send_backlogged();
+    
+    void start_http2();
+    void drive_http2();
+    bool http2_read();
+    bool http2_write();
+    void dispatch_stream(http2::Stream& stream);
+    
+    bool wait_for_io(int result);
+    void set_interest(std::uint32_t events);
+    void enter_read_phase(ReadPhase phase);
+    void arm_timeout(std::uint32_t timeout_ms);
+    void on_timeout();
+    
+    SOCKET socket_;
+    SSL* ssl_;
+    State state_;
+    ReadPhase read_phase_;
+    std::uint32_t interest_;
+    std::uint32_t requests_served_;
+    bool keep_alive_;
+    bool request_keep_alive_;
+    bool request_head_;
+    bool completion_;
+    bool send_in_flight_;
+    bool ktls_send_;
+    bool ktls_recv_;
+    
+    EventLoop& loop_;
+    ThreadPool& pool_;
+    AdmissionController& admission_;
+    TlsStats& tls_stats_;
+    const Router& router_;
+    const ServerConfig& config_;
+    Timer timer_;
+    
+    http_accelerated::RequestParser parser_;
+    http::HttpRequest request_;
+    http::BodyReader body_;
+    size_t body_consumed_;
+    size_t body_decoded_;
+    std::unique_ptr<StreamingHandler> stream_;
+    // Requests parsed but not answered yet, and the bytes of in_ they span.
+    std::vector<PipelinedRequest> batch_;
+    size_t request_size_;
+    // The batch's responses, serialized into out_ in order. A large body is
+    // sent from the response it belongs to rather than copied. Handlers
+    // build them in arena_, which is reset for each batch and so declared
+    // ahead of everything that draws from it.
+    Arena arena_;
+    std::vector<http::HttpResponse> responses_;
+    size_t next_response_;
+    // The rest of a large payload, empty when there is none.
+    std::string_view large_body_;
+    size_t body_sent_;
+    // The streamed body being sent, its framing, and for Content-Length
+    // framing the bytes still owed. File regions are streamed through
+    // file_reader_.
+    http::BodyProducer* producer_;
+    bool producer_chunked_;
+    std::uint64_t producer_remaining_;
+    http::FileRegionReader file_reader_;
+    Buffer in_;
+    Buffer out_;
+    Buffer tls_out_;
+    // Set once h2 is negotiated; the HTTP/1.1 request state is unused then.
+    std::unique_ptr<http2::Session> h2_;
+    std::vector<http2::Stream*> h2_ready_;
+};
+
+} // namespace https_server
+
+#endif // HTTPS_SERVER_CONNECTION_HPP
@@ -1,5 +1,7 @@
 #include "core/event_loop.hpp"
+#include "core/io_uring_loop.hpp"
 #include "utils/logger.hpp"
+#include <algorithm>
 #include <stdexcept>
 #include <cstring>
 
@@ -9,13 +11,156 @@
 #else
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
 #include <fcntl.h>
 #include <errno.h>
 #endif
 
 namespace https_server {
 
-EventLoop::EventLoop() {
+#ifndef _WIN32
+static std::uint32_t to_epoll_events(std::uint32_t events) {
+    std::uint32_t epoll_events = EPOLLET;
+    if (events & EventLoop::EVENT_READ) epoll_events |= EPOLLIN;
+    if (events & EventLoop::EVENT_WRITE) epoll_events |= EPOLLOUT;
+    return epoll_events;
+}
+
+static std::uint32_t from_epoll_events(std::uint32_t epoll_events) {
+    std::uint32_t events = 0;
+    if (epoll_events & EPOLLIN) events |= EventLoop::EVENT_READ;
+    if (epoll_events & EPOLLOUT) events |= EventLoop::EVENT_WRITE;
+    if (epoll_events & (EPOLLERR | EPOLLHUP)) events |= EventLoop::EVENT_ERROR;
+    return events;
+}
+#endif
+
+std::unique_ptr<EventLoop> EventLoop::create(IoBackend backend) {
+#ifdef __linux__
+    if (backend == IoBackend::IoUring) {
+        if (IoUringEventLoop::is_supported()) {
+            try {
+                return std::make_unique<IoUringEventLoop>();
+            } catch (const std::exception& e) {
+                LOG_WARNING("io_uring setup failed, falling back to epoll: " + std::string(e.what()));
+            }
+        } else {
+            LOG_WARNING("io_uring is not available on this kernel, falling back to epoll");
+        }
+    }
+#else
+    (void)backend;
+#endif
+    return std::make_unique<EpollEventLoop>();
+}
+
+EventLoop::EventLoop() : timers_(now_ms()), reserve_fd_(-1) {
+#ifndef _WIN32
+    reserve_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+#endif
+}
+
+EventLoop::~EventLoop() {
+#ifndef _WIN32
+    if (reserve_fd_ != -1) {
+        close(reserve_fd_);
+    }
+#endif
+}
+
+void EventLoop::shed_pending_connections(SOCKET listen_socket) {
+    accept_stats_.emfile.fetch_add(1, std::memory_order_relaxed);
+
+#ifdef _WIN32
+    (void)listen_socket;
+#else
+    if (reserve_fd_ == -1) {
+        return;
+    }
+    
+    // Give back the reserved descriptor so there is room to accept and
+    // immediately close each pending client.
+    close(reserve_fd_);
+    std::uint64_t dropped = 0;
+    while (true) {
+        const int client_socket = accept4(listen_socket, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client_socket < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        close(client_socket);
+        ++dropped;
+    }
+    reserve_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    
+    if (dropped > 0) {
+        accept_stats_.dropped.fetch_add(dropped, std::memory_order_relaxed);
+        LOG_WARNING("Out of file descriptors, dropped " + std::to_string(dropped) + " pending connections");
+    }
+#endif
+}
+
+void EventHandler::on_receive(const char*, int) {
+}
+
+void EventLoop::start_receive(SOCKET, std::shared_ptr<EventHandler>) {
+    throw std::logic_error(std::string(name()) + " event loop does not support completion I/O");
+}
+
+void EventLoop::submit_send(SOCKET, const char*, size_t, SendCallback, bool) {
+    throw std::logic_error(std::string(name()) + " event loop does not support completion I/O");
+}
+
+void EventLoop::retire(std::shared_ptr<EventHandler> handler) {
+    if (handler) {
+        retired_.push_back(std::move(handler));
+    }
+}
+
+class EpollEventLoop::Listener : public EventHandler {
+public:
+    Listener(EpollEventLoop& loop, SOCKET socket, AcceptCallback callback)
+        : loop_(loop), socket_(socket), callback_(std::move(callback)) {}
+    
+    void on_event(std::uint32_t) override {
+#ifdef _WIN32
+        const SOCKET client_socket = accept(socket_, nullptr, nullptr);
+        if (client_socket != INVALID_SOCKET) {
+            loop_.accept_stats_.accepted.fetch_add(1, std::memory_order_relaxed);
+            callback_(client_socket);
+        }
+#else
+        // The listener is edge-triggered: drain the backlog or the remaining
+        // connections wait for the next SYN to produce another edge.
+        while (true) {
+            const SOCKET client_socket = accept4(socket_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client_socket >= 0) {
+                loop_.accept_stats_.accepted.fetch_add(1, std::memory_order_relaxed);
+                callback_(client_socket);
+                continue;
+            }
+            
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno == EMFILE || errno == ENFILE) {
+                loop_.shed_pending_connections(socket_);
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_WARNING("accept4 failed: " + std::string(strerror(errno)));
+            }
+            break;
+        }
+#endif
+    }
+
+private:
+    EpollEventLoop& loop_;
+    SOCKET socket_;
+    AcceptCallback callback_;
+};
+
+EpollEventLoop::EpollEventLoop() {
 #ifdef _WIN32
     LOG_DEBUG("Windows event loop initialized (simplified)");
 #else
@@ -23,80 +168,193 @@ EventLoop::EventLoop() {
     if (epoll_fd_ == -1) {
         throw std::runtime_error("Failed to create epoll file descriptor");
     }
+    
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ == -1) {
+        close(epoll_fd_);
+        throw std::runtime_error("Failed to create wakeup eventfd");
+    }
+    
+    // The wakeup eventfd is the only registration without a handler.
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &event) == -1) {
+        close(wakeup_fd_);
+        close(epoll_fd_);
+        throw std::runtime_error("Failed to add wakeup eventfd to epoll");
+    }
     LOG_DEBUG("Linux epoll event loop initialized");
 #endif
 }
 
-EventLoop::~EventLoop() {
+EpollEventLoop::~EpollEventLoop() {
     cleanup();
 }
 
-void EventLoop::cleanup() {
+void EpollEventLoop::cleanup() {
 #ifdef _WIN32
-    callbacks_.clear();
+    handlers_.clear();
+    interests_.clear();
 #else
+    if (wakeup_fd_ != -1) {
+        close(wakeup_fd_);
+        wakeup_fd_ = -1;
+    }
     if (epoll_fd_ != -1) {
         close(epoll_fd_);
         epoll_fd_ = -1;
     }
-    callbacks_.clear();
+    handlers_.clear();
 #endif
+    release_retired();
+    clear_tasks();
 }
 
-void EventLoop::add_socket(SOCKET socket, EventCallback callback) {
+void EpollEventLoop::add_socket(SOCKET socket, std::shared_ptr<EventHandler> handler, std::uint32_t events) {
 #ifdef _WIN32
     // Simplified Windows implementation using select-style polling
-    callbacks_[socket] = std::move(callback);
+    handlers_[socket] = std::move(handler);
+    interests_[socket] = events;
     LOG_DEBUG("Socket added to Windows event loop");
 #else
-    int flags = fcntl(socket, F_GETFL, 0);
-    if (flags == -1) {
-        throw std::runtime_error("Failed to get socket flags");
-    }
-    
-    if (fcntl(socket, F_SETFL, flags | O_NONBLOCK) == -1) {
-        throw std::runtime_error("Failed to set socket non-blocking");
-    }
-    
     epoll_event event;
-    event.events = EPOLLIN | EPOLLET;
-    event.data.fd = socket;
+    event.events = to_epoll_events(events);
+    event.data.ptr = handler.get();
     
     if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket, &event) == -1) {
         throw std::runtime_error("Failed to add socket to epoll");
     }
     
-    callbacks_[socket] = std::move(callback);
+    handlers_[socket] = std::move(handler);
     LOG_DEBUG("Socket added to epoll event loop");
 #endif
 }
 
-void EventLoop::remove_socket(SOCKET socket) {
+void EpollEventLoop::modify_socket(SOCKET socket, std::uint32_t events) {
+#ifdef _WIN32
+    interests_[socket] = events;
+#else
+    const auto* slot = handlers_.find(socket);
+    if (!slot || !*slot) {
+        return;
+    }
+    
+    epoll_event event;
+    event.events = to_epoll_events(events);
+    event.data.ptr = slot->get();
+    
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, socket, &event) == -1) {
+        LOG_WARNING("Failed to modify socket in epoll: " + std::string(strerror(errno)));
+    }
+#endif
+}
+
+void EpollEventLoop::remove_socket(SOCKET socket) {
 #ifdef _WIN32
-    callbacks_.erase(socket);
+    handlers_.erase(socket);
+    interests_.erase(socket);
     LOG_DEBUG("Socket removed from Windows event loop");
 #else
     if (epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket, nullptr) == -1) {
         LOG_WARNING("Failed to remove socket from epoll");
     }
     
-    callbacks_.erase(socket);
+    if (auto* slot = handlers_.find(socket)) {
+        retire(std::move(*slot));
+        slot->reset();
+    }
     LOG_DEBUG("Socket removed from epoll event loop");
 #endif
 }
 
-void EventLoop::run_once(int timeout_ms) {
+void EpollEventLoop::add_listener(SOCKET listen_socket, AcceptCallback callback) {
+    add_socket(listen_socket, std::make_shared<Listener>(*this, listen_socket, std::move(callback)));
+}
+
+void EpollEventLoop::wakeup() {
+#ifndef _WIN32
+    const std::uint64_t one = 1;
+    if (write(wakeup_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        LOG_WARNING("Failed to wake up event loop: " + std::string(strerror(errno)));
+    }
+#endif
+}
+
+void EventLoop::post(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(posted_mutex_);
+        posted_tasks_.push_back(std::move(task));
+    }
+    
+    wakeup();
+}
+
+void EventLoop::run_after(std::uint32_t delay_ms, Task task) {
+    timers_.schedule_once(now_ms() - timers_.now() + delay_ms, std::move(task));
+}
+
+void EventLoop::schedule(Timer& timer, std::uint32_t delay_ms) {
+    timers_.schedule(timer, now_ms() - timers_.now() + delay_ms);
+}
+
+std::uint64_t EventLoop::now_ms() noexcept {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        Clock::now().time_since_epoch()).count());
+}
+
+void EventLoop::run_posted_tasks() {
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(posted_mutex_);
+        tasks.swap(posted_tasks_);
+    }
+    
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+void EventLoop::run_expired_timers() {
+    timers_.advance(now_ms());
+}
+
+void EventLoop::clear_tasks() {
+    std::lock_guard<std::mutex> lock(posted_mutex_);
+    posted_tasks_.clear();
+}
+
+int EventLoop::next_timeout(int timeout_ms) const {
+    {
+        std::lock_guard<std::mutex> lock(posted_mutex_);
+        if (!posted_tasks_.empty()) return 0;
+    }
+    
+    const std::int64_t next_event = timers_.next_event();
+    if (next_event < 0) return timeout_ms;
+    
+    const std::uint64_t due = timers_.now() + static_cast<std::uint64_t>(next_event);
+    const std::uint64_t now = now_ms();
+    const int timer_ms = due > now ? static_cast<int>((std::min)(due - now, static_cast<std::uint64_t>(INT32_MAX))) : 0;
+    return (timeout_ms < 0 || timer_ms < timeout_ms) ? timer_ms : timeout_ms;
+}
+
+void EpollEventLoop::run_once(int timeout_ms) {
 #ifdef _WIN32
-    // Simplified Windows implementation - just call callbacks for now
-    for (const auto& [socket, callback] : callbacks_) {
-        if (callback) {
-            callback(socket);
+    // Simplified Windows implementation - just call handlers for now
+    const auto handlers = handlers_;
+    for (const auto& [socket, handler] : handlers) {
+        if (handler) {
+            handler->on_event(interests_[socket]);
         }
     }
+    release_retired();
+    run_posted_tasks();
+    run_expired_timers();
     Sleep(timeout_ms > 0 ? timeout_ms : 10);
 #else
     epoll_event events[MAX_EVENTS];
-    int event_count = epoll_wait(epoll_fd_, events, MAX_EVENTS, timeout_ms);
+    int event_count = epoll_wait(epoll_fd_, events, MAX_EVENTS, next_timeout(timeout_ms));
     
     if (event_count == -1) {
         if (errno != EINTR) {
@@ -106,22 +364,21 @@ void EventLoop::run_once(int timeout_ms) {
     }
     
     for (int i = 0; i < event_count; ++i) {
-        SOCKET socket = events[i].data.fd;
-        
-        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
-            LOG_WARNING("Socket error/hangup detected");
-            remove_socket(socket);
+        auto* handler = static_cast<EventHandler*>(events[i].data.ptr);
+        if (!handler) {
+            std::uint64_t counter;
+            while (read(wakeup_fd_, &counter, sizeof(counter)) > 0) {}
             continue;
         }
         
-        if (events[i].events & EPOLLIN) {
-            auto it = callbacks_.find(socket);
-            if (it != callbacks_.end() && it->second) {
-                it->second(socket);
-            }
-        }
+        handler->on_event(from_epoll_events(events[i].events));
     }
+    release_retired();
+    
+    run_posted_tasks();
+    run_expired_timers();
+    release_retired();
 #endif
 }
 
-} // namespace https_server
\ No newline at end of file
+} // namespace https_server
@@ -1,10 +1,17 @@
 #ifndef HTTPS_SERVER_EVENT_LOOP_HPP
 #define HTTPS_SERVER_EVENT_LOOP_HPP
 
+#include "core/config.hpp"
+#include "core/timer_wheel.hpp"
+#include "core/fd_slab.hpp"
 #include <functional>
 #include <map>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -17,33 +24,145 @@ using SOCKET = int;
 
 namespace https_server {
 
-class EventLoop {
+// Listener counters, written by the owning loop and readable from any thread.
+struct AcceptStats {
+    std::atomic<std::uint64_t> accepted{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> emfile{0};
+};
+
+// Per-socket state registered with a loop. The loop holds a reference while
+// the socket is registered and dispatches straight to the handler: epoll
+// carries the pointer in epoll_event.data.ptr, so an event costs one
+// virtual call and no lookup.
+class EventHandler {
 public:
-    using EventCallback = std::function<void(SOCKET)>;
+    virtual ~EventHandler() = default;
+    
+    virtual void on_event(std::uint32_t events) = 0;
+    
+    // Completion-mode receive: data is only valid for the duration of the
+    // call; a length of 0 means EOF and a negative length is -errno.
+    virtual void on_receive(const char* data, int len);
+};
 
+class EventLoop {
+public:
+    using AcceptCallback = std::function<void(SOCKET)>;
+    using SendCallback = std::function<void(int)>;
+    using Task = std::function<void()>;
+    
+    static constexpr std::uint32_t EVENT_READ = 1u << 0;
+    static constexpr std::uint32_t EVENT_WRITE = 1u << 1;
+    static constexpr std::uint32_t EVENT_ERROR = 1u << 2;
+    
+    static std::unique_ptr<EventLoop> create(IoBackend backend);
+    
     EventLoop();
-    ~EventLoop();
-
+    virtual ~EventLoop();
+    
     EventLoop(const EventLoop&) = delete;
     EventLoop& operator=(const EventLoop&) = delete;
+    
+    virtual const char* name() const noexcept = 0;
+    
+    // Readiness interface: the handler is told which of EVENT_* are ready.
+    // Sockets must already be non-blocking.
+    virtual void add_socket(SOCKET socket, std::shared_ptr<EventHandler> handler,
+                            std::uint32_t events = EVENT_READ) = 0;
+    virtual void modify_socket(SOCKET socket, std::uint32_t events) = 0;
+    virtual void remove_socket(SOCKET socket) = 0;
+    
+    // Invokes the callback with every accepted client socket, which is
+    // non-blocking and close-on-exec.
+    virtual void add_listener(SOCKET listen_socket, AcceptCallback callback) = 0;
+    
+    const AcceptStats& accept_stats() const noexcept { return accept_stats_; }
+    
+    // Completion interface, only available when completion_io() is true.
+    // Received data goes to EventHandler::on_receive. Sent data must stay
+    // valid until the send callback runs.
+    virtual bool completion_io() const noexcept { return false; }
+    virtual void start_receive(SOCKET socket, std::shared_ptr<EventHandler> handler);
+    virtual void submit_send(SOCKET socket, const char* data, size_t len,
+                             SendCallback callback, bool close_after = false);
+    
+    virtual void run_once(int timeout_ms = -1) = 0;
+    
+    // Thread-safe: queues a task to run on the loop thread and wakes it up.
+    void post(Task task);
+    
+    // Loop thread only. run_after allocates a one-shot node; long-lived
+    // owners should embed a Timer and re-arm it with schedule().
+    void run_after(std::uint32_t delay_ms, Task task);
+    void schedule(Timer& timer, std::uint32_t delay_ms);
+
+protected:
+    using Clock = std::chrono::steady_clock;
+    
+    virtual void wakeup() = 0;
+    
+    void run_posted_tasks();
+    void run_expired_timers();
+    int next_timeout(int timeout_ms) const;
+    void clear_tasks();
+    
+    // Called when accept fails with EMFILE/ENFILE: accepts and closes the
+    // pending connections so clients see a reset instead of a stalled backlog.
+    void shed_pending_connections(SOCKET listen_socket);
+    
+    // Handlers removed while a batch of events is being dispatched may still
+    // be referenced by later events of that batch; keep them alive until
+    // release_retired() runs at the end of the batch.
+    void retire(std::shared_ptr<EventHandler> handler);
+    void release_retired() noexcept { retired_.clear(); }
+    
+    AcceptStats accept_stats_;
+
+private:
+    mutable std::mutex posted_mutex_;
+    std::vector<Task> posted_tasks_;
+    static std::uint64_t now_ms() noexcept;
+    
+    TimerWheel timers_;
+    std::vector<std::shared_ptr<EventHandler>> retired_;
+    int reserve_fd_;
+};
+
+class EpollEventLoop : public EventLoop {
+public:
+    EpollEventLoop();
+    ~EpollEventLoop() override;
+    
+    const char* name() const noexcept override { return "epoll"; }
+    
+    void add_socket(SOCKET socket, std::shared_ptr<EventHandler> handler,
+                    std::uint32_t events = EVENT_READ) override;
+    void modify_socket(SOCKET socket, std::uint32_t events) override;
+    void remove_socket(SOCKET socket) override;
+    void add_listener(SOCKET listen_socket, AcceptCallback callback) override;
+    void run_once(int timeout_ms = -1) override;
 
-    void add_socket(SOCKET socket, EventCallback callback);
-    void remove_socket(SOCKET socket);
-    void run_once(int timeout_ms = -1);
+protected:
+    void wakeup() override;
 
 private:
+    class Listener;
+    
     void cleanup();
 
 #ifdef _WIN32
     // Simplified Windows implementation
-    std::map<SOCKET, EventCallback> callbacks_;
+    std::map<SOCKET, std::shared_ptr<EventHandler>> handlers_;
+    std::map<SOCKET, std::uint32_t> interests_;
 #else
     int epoll_fd_;
-    std::map<SOCKET, EventCallback> callbacks_;
+    int wakeup_fd_;
+    FdSlab<std::shared_ptr<EventHandler>> handlers_;
     static constexpr int MAX_EVENTS = 64;
 #endif
 };
 
 } // namespace https_server
 
-#endif // HTTPS_SERVER_EVENT_LOOP_HPP
\ No newline at end of file
+#endif // HTTPS_SERVER_EVENT_LOOP_HPP
@@ -0,0 +1,39 @@
+#ifndef HTTPS_SERVER_FD_SLAB_HPP
+#define HTTPS_SERVER_FD_SLAB_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace https_server {
+
+// Dense table of per-descriptor slots indexed directly by fd. POSIX hands
+// out the lowest free descriptor, so the table stays compact and a lookup
+// is a bounds check plus an index, with no per-insert allocation once the
+// table has grown to the working set.
+template <typename Slot>
+class FdSlab {
+public:
+    Slot& operator[](int fd) {
+        const size_t index = static_cast<size_t>(fd);
+        if (index >= slots_.size()) {
+            size_t size = slots_.empty() ? 64 : slots_.size();
+            while (size <= index) size *= 2;
+            slots_.resize(size);
+        }
+        return slots_[index];
+    }
+    
+    Slot* find(int fd) noexcept {
+        const size_t index = static_cast<size_t>(fd);
+        return fd >= 0 && index < slots_.size() ? &slots_[index] : nullptr;
+    }
+    
+    void clear() noexcept { slots_.clear(); }
+
+private:
+    std::vector<Slot> slots_;
+};
+
+} // namespace https_server
+
+#endif // HTTPS_SERVER_FD_SLAB_HPP
@@ -0,0 +1,601 @@
+#ifdef __linux__
+
+#include "core/io_uring_loop.hpp"
+#include "utils/logger.hpp"
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+namespace https_server {
+
+static int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                          unsigned flags, const void* arg, size_t arg_size) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete,
+                                    flags, arg, arg_size));
+}
+
+static int io_uring_register(int ring_fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+bool IoUringEventLoop::is_supported() {
+    static const bool supported = [] {
+        // Multishot recv with provided buffer rings needs 6.0 or newer.
+        utsname name{};
+        int major = 0;
+        int minor = 0;
+        if (uname(&name) != 0 || std::sscanf(name.release, "%d.%d", &major, &minor) != 2) {
+            return false;
+        }
+        if (major < 6) {
+            return false;
+        }
+        
+        io_uring_params params{};
+        const int ring_fd = io_uring_setup(4, &params);
+        if (ring_fd < 0) {
+            return false;
+        }
+        close(ring_fd);
+        return (params.features & IORING_FEAT_EXT_ARG) != 0;
+    }();
+    return supported;
+}
+
+IoUringEventLoop::IoUringEventLoop()
+    : ring_fd_(-1),
+      next_generation_(0),
+      sq_ring_(MAP_FAILED),
+      sq_ring_size_(0),
+      cq_ring_(MAP_FAILED),
+      cq_ring_size_(0),
+      sqes_(nullptr),
+      sqes_size_(0),
+      sq_head_(nullptr),
+      sq_tail_(nullptr),
+      sq_array_(nullptr),
+      sq_mask_(0),
+      sq_entries_(0),
+      sq_local_tail_(0),
+      cq_head_(nullptr),
+      cq_tail_(nullptr),
+      cq_mask_(0),
+      cqes_(nullptr),
+      buffer_ring_(nullptr),
+      buffer_ring_size_(0),
+      buffers_(nullptr),
+      buffer_tail_(0),
+      wakeup_fd_(-1),
+      next_send_id_(1)
+{
+    try {
+        setup_ring();
+        setup_buffer_ring();
+        
+        wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeup_fd_ == -1) {
+            throw std::system_error(errno, std::generic_category(), "Failed to create wakeup eventfd");
+        }
+        
+        arm_wakeup();
+    } catch (...) {
+        cleanup();
+        throw;
+    }
+    
+    LOG_DEBUG("Linux io_uring event loop initialized");
+}
+
+IoUringEventLoop::~IoUringEventLoop() {
+    cleanup();
+}
+
+void IoUringEventLoop::setup_ring() {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_COOP_TASKRUN;
+    ring_fd_ = io_uring_setup(RING_ENTRIES, &params);
+    if (ring_fd_ < 0 && errno == EINVAL) {
+        params = io_uring_params{};
+        ring_fd_ = io_uring_setup(RING_ENTRIES, &params);
+    }
+    if (ring_fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "io_uring_setup failed");
+    }
+    
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        throw std::runtime_error("io_uring lacks IORING_FEAT_EXT_ARG");
+    }
+    
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = (std::max)(sq_ring_size_, cq_ring_size_);
+    }
+    
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), "Failed to map io_uring SQ ring");
+    }
+    
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "Failed to map io_uring CQ ring");
+        }
+    }
+    
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), "Failed to map io_uring SQEs");
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+    
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_entries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sq_local_tail_ = *sq_tail_;
+    
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+void IoUringEventLoop::setup_buffer_ring() {
+    buffer_ring_size_ = BUFFER_COUNT * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, buffer_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ring == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), "Failed to allocate buffer ring");
+    }
+    buffer_ring_ = static_cast<io_uring_buf_ring*>(ring);
+    
+    void* buffers = mmap(nullptr, static_cast<size_t>(BUFFER_COUNT) * BUFFER_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (buffers == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), "Failed to allocate receive buffers");
+    }
+    buffers_ = static_cast<char*>(buffers);
+    
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<std::uint64_t>(ring);
+    reg.ring_entries = BUFFER_COUNT;
+    reg.bgid = BUFFER_GROUP;
+    if (io_uring_register(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        throw std::system_error(errno, std::generic_category(), "Failed to register provided buffer ring");
+    }
+    
+    for (unsigned i = 0; i < BUFFER_COUNT; ++i) {
+        recycle_buffer(static_cast<std::uint16_t>(i));
+    }
+}
+
+void IoUringEventLoop::cleanup() {
+    registrations_.clear();
+    sends_.clear();
+    release_retired();
+    clear_tasks();
+    
+    if (wakeup_fd_ != -1) {
+        close(wakeup_fd_);
+        wakeup_fd_ = -1;
+    }
+    if (ring_fd_ != -1) {
+        close(ring_fd_);
+        ring_fd_ = -1;
+    }
+    if (buffers_) {
+        munmap(buffers_, static_cast<size_t>(BUFFER_COUNT) * BUFFER_SIZE);
+        buffers_ = nullptr;
+    }
+    if (buffer_ring_) {
+        munmap(buffer_ring_, buffer_ring_size_);
+        buffer_ring_ = nullptr;
+    }
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+        sqes_ = nullptr;
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    cq_ring_ = MAP_FAILED;
+    if (sq_ring_ != MAP_FAILED) {
+        munmap(sq_ring_, sq_ring_size_);
+        sq_ring_ = MAP_FAILED;
+    }
+}
+
+std::uint64_t IoUringEventLoop::encode(Op op, std::uint32_t generation, SOCKET socket) noexcept {
+    return (static_cast<std::uint64_t>(op) << 56) |
+           (static_cast<std::uint64_t>(generation & 0xFFFFFFu) << 32) |
+           static_cast<std::uint32_t>(socket);
+}
+
+io_uring_sqe* IoUringEventLoop::get_sqe() {
+    if (sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+        submit(0, 0);
+        if (sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+            throw std::runtime_error("io_uring submission queue is full");
+        }
+    }
+    
+    const unsigned index = sq_local_tail_ & sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    ++sq_local_tail_;
+    return sqe;
+}
+
+int IoUringEventLoop::submit(unsigned wait_nr, int timeout_ms) {
+    __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+    const unsigned to_submit = sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (to_submit == 0 && wait_nr == 0) {
+        return 0;
+    }
+    
+    io_uring_getevents_arg arg{};
+    __kernel_timespec ts{};
+    unsigned flags = 0;
+    if (wait_nr > 0) {
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        arg.sigmask_sz = _NSIG / 8;
+        if (timeout_ms >= 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+            arg.ts = reinterpret_cast<std::uint64_t>(&ts);
+        }
+    }
+    
+    const int result = io_uring_enter(ring_fd_, to_submit, wait_nr, flags,
+                                      wait_nr > 0 ? &arg : nullptr, wait_nr > 0 ? sizeof(arg) : 0);
+    if (result < 0 && errno != ETIME && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+        LOG_ERROR("io_uring_enter failed: " + std::string(strerror(errno)));
+    }
+    return result;
+}
+
+void IoUringEventLoop::recycle_buffer(std::uint16_t buffer_id) {
+    // The ring is indexed as a flat io_uring_buf array: in C++ the header's
+    // flexible-array wrapper shifts 'bufs', and the shared tail lives in the
+    // 'resv' field of the first entry.
+    io_uring_buf* entries = reinterpret_cast<io_uring_buf*>(buffer_ring_);
+    io_uring_buf& entry = entries[buffer_tail_ & (BUFFER_COUNT - 1)];
+    entry.addr = reinterpret_cast<std::uint64_t>(buffers_ + static_cast<size_t>(buffer_id) * BUFFER_SIZE);
+    entry.len = BUFFER_SIZE;
+    entry.bid = buffer_id;
+    ++buffer_tail_;
+    __atomic_store_n(&entries[0].resv, buffer_tail_, __ATOMIC_RELEASE);
+}
+
+IoUringEventLoop::Registration& IoUringEventLoop::register_socket(SOCKET socket, Op op) {
+    Registration& registration = registrations_[socket];
+    retire(std::move(registration.handler));
+    registration = Registration{};
+    registration.generation = ++next_generation_ & 0xFFFFFFu;
+    registration.op = op;
+    return registration;
+}
+
+IoUringEventLoop::Registration* IoUringEventLoop::find_registration(SOCKET socket, std::uint32_t generation) noexcept {
+    Registration* registration = registrations_.find(socket);
+    if (!registration || registration->op == Op::None || registration->generation != generation) {
+        return nullptr;
+    }
+    return registration;
+}
+
+void IoUringEventLoop::arm_poll(SOCKET socket, const Registration& registration) {
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = socket;
+    std::uint32_t poll_events = 0;
+    if (registration.events & EVENT_READ) poll_events |= POLLIN;
+    if (registration.events & EVENT_WRITE) poll_events |= POLLOUT;
+    sqe->poll32_events = poll_events;
+    sqe->user_data = encode(Op::Poll, registration.generation, socket);
+}
+
+void IoUringEventLoop::arm_accept(SOCKET socket, const Registration& registration) {
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = socket;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = encode(Op::Accept, registration.generation, socket);
+}
+
+void IoUringEventLoop::arm_receive(SOCKET socket, const Registration& registration) {
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = socket;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = encode(Op::Receive, registration.generation, socket);
+}
+
+void IoUringEventLoop::arm_wakeup() {
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = wakeup_fd_;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = encode(Op::Wakeup, 0, wakeup_fd_);
+}
+
+void IoUringEventLoop::cancel(std::uint64_t user_data) {
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+    sqe->user_data = encode(Op::Cancel, 0, 0);
+}
+
+void IoUringEventLoop::add_socket(SOCKET socket, std::shared_ptr<EventHandler> handler, std::uint32_t events) {
+    Registration& registration = register_socket(socket, Op::Poll);
+    registration.handler = std::move(handler);
+    registration.events = events;
+    arm_poll(socket, registration);
+}
+
+void IoUringEventLoop::modify_socket(SOCKET socket, std::uint32_t events) {
+    Registration* registration = registrations_.find(socket);
+    if (!registration || registration->op != Op::Poll) {
+        return;
+    }
+    
+    cancel(encode(Op::Poll, registration->generation, socket));
+    registration->generation = ++next_generation_ & 0xFFFFFFu;
+    registration->events = events;
+    arm_poll(socket, *registration);
+}
+
+void IoUringEventLoop::remove_socket(SOCKET socket) {
+    Registration* registration = registrations_.find(socket);
+    if (!registration || registration->op == Op::None) {
+        return;
+    }
+    
+    cancel(encode(registration->op, registration->generation, socket));
+    retire(std::move(registration->handler));
+    *registration = Registration{};
+}
+
+void IoUringEventLoop::add_listener(SOCKET listen_socket, AcceptCallback callback) {
+    Registration& registration = register_socket(listen_socket, Op::Accept);
+    registration.on_accept = std::move(callback);
+    arm_accept(listen_socket, registration);
+}
+
+void IoUringEventLoop::start_receive(SOCKET socket, std::shared_ptr<EventHandler> handler) {
+    Registration& registration = register_socket(socket, Op::Receive);
+    registration.handler = std::move(handler);
+    arm_receive(socket, registration);
+}
+
+void IoUringEventLoop::submit_send(SOCKET socket, const char* data, size_t len,
+                                   SendCallback callback, bool close_after) {
+    if (sq_entries_ - (sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE)) < 2) {
+        submit(0, 0);
+    }
+    
+    const std::uint64_t send_id = next_send_id_++ & ((1ull << 56) - 1);
+    sends_[send_id] = std::move(callback);
+    
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = socket;
+    sqe->addr = reinterpret_cast<std::uint64_t>(data);
+    sqe->len = static_cast<std::uint32_t>(len);
+    sqe->msg_flags = MSG_NOSIGNAL | (close_after ? MSG_WAITALL : 0);
+    sqe->user_data = (static_cast<std::uint64_t>(Op::Send) << 56) | send_id;
+    
+    if (close_after) {
+        sqe->flags |= IOSQE_IO_LINK;
+        
+        io_uring_sqe* close_sqe = get_sqe();
+        close_sqe->opcode = IORING_OP_CLOSE;
+        close_sqe->fd = socket;
+        close_sqe->user_data = encode(Op::Close, 0, socket);
+    }
+}
+
+void IoUringEventLoop::wakeup() {
+    const std::uint64_t one = 1;
+    if (write(wakeup_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        LOG_WARNING("Failed to wake up event loop: " + std::string(strerror(errno)));
+    }
+}
+
+void IoUringEventLoop::handle_completion(std::uint64_t user_data, int result, std::uint32_t flags) {
+    const Op op = static_cast<Op>(user_data >> 56);
+    const std::uint32_t generation = static_cast<std::uint32_t>(user_data >> 32) & 0xFFFFFFu;
+    const SOCKET socket = static_cast<SOCKET>(user_data & 0xFFFFFFFFu);
+    
+    switch (op) {
+        case Op::Send: {
+            auto it = sends_.find(user_data & ((1ull << 56) - 1));
+            if (it == sends_.end()) {
+                return;
+            }
+            SendCallback callback = std::move(it->second);
+            sends_.erase(it);
+            if (callback) {
+                callback(result);
+            }
+            return;
+        }
+        
+        case Op::Close:
+            if (result < 0) {
+                // The linked send failed, so the close was cancelled.
+                close(socket);
+            }
+            return;
+        
+        case Op::Cancel:
+            return;
+        
+        case Op::Wakeup: {
+            if (result == -ECANCELED) {
+                return;
+            }
+            std::uint64_t counter;
+            while (read(wakeup_fd_, &counter, sizeof(counter)) > 0) {}
+            arm_wakeup();
+            return;
+        }
+        
+        case Op::Receive: {
+            const bool has_buffer = (flags & IORING_CQE_F_BUFFER) != 0;
+            const auto buffer_id = static_cast<std::uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+            
+            Registration* registration = find_registration(socket, generation);
+            if (!registration) {
+                if (has_buffer) recycle_buffer(buffer_id);
+                return;
+            }
+            
+            if (result == -ENOBUFS) {
+                arm_receive(socket, *registration);
+                return;
+            }
+            
+            // The slab may grow during the call; the handler itself stays put.
+            EventHandler* handler = registration->handler.get();
+            if (result > 0 && has_buffer) {
+                handler->on_receive(buffers_ + static_cast<size_t>(buffer_id) * BUFFER_SIZE, result);
+                recycle_buffer(buffer_id);
+            } else {
+                if (has_buffer) recycle_buffer(buffer_id);
+                if (result != -ECANCELED) {
+                    handler->on_receive(nullptr, result);
+                }
+                return;
+            }
+            
+            if (!(flags & IORING_CQE_F_MORE)) {
+                if ((registration = find_registration(socket, generation))) {
+                    arm_receive(socket, *registration);
+                }
+            }
+            return;
+        }
+        
+        case Op::Accept: {
+            Registration* registration = find_registration(socket, generation);
+            if (!registration) {
+                if (result >= 0) close(result);
+                return;
+            }
+            
+            if (result >= 0) {
+                accept_stats_.accepted.fetch_add(1, std::memory_order_relaxed);
+                const AcceptCallback callback = registration->on_accept;
+                callback(static_cast<SOCKET>(result));
+            } else if (result == -EMFILE || result == -ENFILE) {
+                // io_uring reserves the descriptor before looking at the
+                // backlog, so re-arming right away would spin until an fd is
+                // released.
+                shed_pending_connections(socket);
+                run_after(ACCEPT_RETRY_MS, [this, socket, generation] {
+                    if (Registration* retry = find_registration(socket, generation)) {
+                        arm_accept(socket, *retry);
+                    }
+                });
+                return;
+            } else if (result != -ECANCELED) {
+                LOG_WARNING("io_uring accept failed: " + std::string(strerror(-result)));
+            }
+            
+            if (!(flags & IORING_CQE_F_MORE) && result != -ECANCELED) {
+                if ((registration = find_registration(socket, generation))) {
+                    arm_accept(socket, *registration);
+                }
+            }
+            return;
+        }
+        
+        case Op::Poll: {
+            Registration* registration = find_registration(socket, generation);
+            if (!registration || result == -ECANCELED) {
+                return;
+            }
+            
+            std::uint32_t events = 0;
+            if (result < 0) {
+                events = EVENT_ERROR;
+            } else {
+                const auto revents = static_cast<std::uint32_t>(result);
+                if (revents & POLLIN) events |= EVENT_READ;
+                if (revents & POLLOUT) events |= EVENT_WRITE;
+                if (revents & (POLLERR | POLLHUP | POLLNVAL)) events |= EVENT_ERROR;
+            }
+            
+            registration->handler->on_event(events);
+            
+            if ((registration = find_registration(socket, generation))) {
+                arm_poll(socket, *registration);
+            }
+            return;
+        }
+        
+        case Op::None:
+            return;
+    }
+}
+
+void IoUringEventLoop::run_once(int timeout_ms) {
+    const int wait_ms = next_timeout(timeout_ms);
+    submit(wait_ms == 0 ? 0 : 1, wait_ms);
+    
+    unsigned head = *cq_head_;
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+        const std::uint64_t user_data = cqe.user_data;
+        const int result = cqe.res;
+        const std::uint32_t flags = cqe.flags;
+        
+        ++head;
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        
+        handle_completion(user_data, result, flags);
+    }
+    release_retired();
+    
+    run_posted_tasks();
+    run_expired_timers();
+    release_retired();
+}
+
+} // namespace https_server
+
+#endif // __linux__
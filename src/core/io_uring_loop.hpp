@@ -0,0 +1,129 @@
+#ifndef HTTPS_SERVER_IO_URING_LOOP_HPP
+#define HTTPS_SERVER_IO_URING_LOOP_HPP
+
+#ifdef __linux__
+
+#include "core/event_loop.hpp"
+#include <cstdint>
+#include <unordered_map>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+namespace https_server {
+
+// io_uring backend: multishot accept, multishot recv into a registered
+// provided-buffer ring and send linked to close. Readiness registrations
+// (add_socket) are served with one-shot IORING_OP_POLL_ADD re-armed after
+// every event.
+class IoUringEventLoop : public EventLoop {
+public:
+    static bool is_supported();
+    
+    IoUringEventLoop();
+    ~IoUringEventLoop() override;
+    
+    const char* name() const noexcept override { return "io_uring"; }
+    
+    void add_socket(SOCKET socket, std::shared_ptr<EventHandler> handler,
+                    std::uint32_t events = EVENT_READ) override;
+    void modify_socket(SOCKET socket, std::uint32_t events) override;
+    void remove_socket(SOCKET socket) override;
+    void add_listener(SOCKET listen_socket, AcceptCallback callback) override;
+    
+    bool completion_io() const noexcept override { return true; }
+    void start_receive(SOCKET socket, std::shared_ptr<EventHandler> handler) override;
+    void submit_send(SOCKET socket, const char* data, size_t len,
+                     SendCallback callback, bool close_after = false) override;
+    
+    void run_once(int timeout_ms = -1) override;
+
+protected:
+    void wakeup() override;
+
+private:
+    enum class Op : std::uint8_t {
+        None = 0,
+        Poll,
+        Accept,
+        Receive,
+        Send,
+        Close,
+        Cancel,
+        Wakeup
+    };
+    
+    // One slot per descriptor; op is the multishot/poll request currently
+    // armed for it, or None when the slot is free.
+    struct Registration {
+        std::shared_ptr<EventHandler> handler;
+        AcceptCallback on_accept;
+        std::uint32_t generation = 0;
+        std::uint32_t events = 0;
+        Op op = Op::None;
+    };
+    
+    static constexpr unsigned RING_ENTRIES = 1024;
+    static constexpr unsigned BUFFER_COUNT = 512;
+    static constexpr unsigned BUFFER_SIZE = 4096;
+    static constexpr std::uint16_t BUFFER_GROUP = 0;
+    static constexpr std::uint32_t ACCEPT_RETRY_MS = 100;
+    
+    static std::uint64_t encode(Op op, std::uint32_t generation, SOCKET socket) noexcept;
+    
+    void setup_ring();
+    void setup_buffer_ring();
+    void cleanup();
+    
+    io_uring_sqe* get_sqe();
+    int submit(unsigned wait_nr, int timeout_ms);
+    void handle_completion(std::uint64_t user_data, int result, std::uint32_t flags);
+    void recycle_buffer(std::uint16_t buffer_id);
+    
+    Registration& register_socket(SOCKET socket, Op op);
+    Registration* find_registration(SOCKET socket, std::uint32_t generation) noexcept;
+    void arm_poll(SOCKET socket, const Registration& registration);
+    void arm_accept(SOCKET socket, const Registration& registration);
+    void arm_receive(SOCKET socket, const Registration& registration);
+    void arm_wakeup();
+    void cancel(std::uint64_t user_data);
+    
+    int ring_fd_;
+    std::uint32_t next_generation_;
+    
+    void* sq_ring_;
+    size_t sq_ring_size_;
+    void* cq_ring_;
+    size_t cq_ring_size_;
+    io_uring_sqe* sqes_;
+    size_t sqes_size_;
+    
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned* sq_array_;
+    unsigned sq_mask_;
+    unsigned sq_entries_;
+    unsigned sq_local_tail_;
+    
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned cq_mask_;
+    io_uring_cqe* cqes_;
+    
+    io_uring_buf_ring* buffer_ring_;
+    size_t buffer_ring_size_;
+    char* buffers_;
+    std::uint16_t buffer_tail_;
+    
+    int wakeup_fd_;
+    FdSlab<Registration> registrations_;
+    std::unordered_map<std::uint64_t, SendCallback> sends_;
+    std::uint64_t next_send_id_;
+};
+
+} // namespace https_server
+
+#endif // __linux__
+
+#endif // HTTPS_SERVER_IO_URING_LOOP_HPP
@@ -4,8 +4,8 @@
 #endif
 
 #include "core/server.hpp"
+#include "core/connection.hpp"
 #include "utils/logger.hpp"
-#include "utils/buffer.hpp"
 #include "utils/fast_memory.hpp"
 #include "utils/http_accelerated.hpp"
 #include "utils/compression_suite.hpp"
@@ -30,6 +30,9 @@ static BOOL WINAPI console_ctrl_handler(DWORD ctrl_type);
 static https_server::Server* g_server_instance = nullptr;
 #else
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <signal.h>
@@ -45,21 +48,37 @@ void close_socket(SOCKET s);
 #else
 void close_socket(SOCKET s);
 #endif
-http::HttpRequest parse_request(const Buffer& buffer);
 
 extern "C" int OSSL_provider_init(const OSSL_CORE_HANDLE *handle, 
                                   const OSSL_DISPATCH *in, 
                                   const OSSL_DISPATCH **out, 
                                   void **provctx);
 
+// ALPN picks in the server's order of preference: h2 when both sides
+// offer it. A client offering neither is served HTTP/1.1 without ALPN.
+static int select_alpn_protocol(SSL*, const unsigned char** out, unsigned char* out_length,
+                                const unsigned char* in, unsigned int in_length, void* arg) {
+    static constexpr unsigned char PROTOCOLS[] = "\x02h2\x08http/1.1";
+    const bool http2 = *static_cast<const bool*>(arg);
+    const unsigned char* protocols = http2 ? PROTOCOLS : PROTOCOLS + 3;
+    const auto length = static_cast<unsigned int>(sizeof(PROTOCOLS) - 1 - (http2 ? 0 : 3));
+    
+    unsigned char* selected = nullptr;
+    if (SSL_select_next_proto(&selected, out_length, protocols, length, in, in_length) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
 Server::Server(const ServerConfig& config) 
     : config_(config),
-      server_socket_(static_cast<SOCKET>(-1)), 
+      admission_(config, config.threads == 0 ? std::thread::hardware_concurrency() : config.threads),
       pool_(config.threads == 0 ? std::thread::hardware_concurrency() : config.threads),
-      ssl_ctx_(nullptr),
       default_provider_(nullptr),
       custom_provider_(nullptr),
-      running_(true)
+      running_(true),
+      reload_requested_(false)
 {
 #ifdef _WIN32
     if (WSAStartup(MAKEWORD(2, 2), &wsa_data_) != 0) {
@@ -105,15 +124,22 @@ Server::Server(const ServerConfig& config)
     init_openssl();
     setup_providers();
     load_openssl_config();
-    create_ssl_context();
+    ssl_ctx_ = create_ssl_context();
     setup_signal_handlers();
-    
-    event_loop_ = std::make_unique<EventLoop>();
 }
 
 Server::~Server() {
     shutdown();
     
+    for (auto& reactor : reactors_) {
+        reactor->loop.reset();
+        if (reactor->listen_socket != static_cast<SOCKET>(-1)) {
+            close_socket(reactor->listen_socket);
+        }
+    }
+    reactors_.clear();
+    std::atomic_store(&ssl_ctx_, std::shared_ptr<SSL_CTX>());
+    
     if (custom_provider_) {
         OSSL_PROVIDER_unload(custom_provider_);
     }
@@ -122,15 +148,7 @@ Server::~Server() {
         OSSL_PROVIDER_unload(default_provider_);
     }
     
-    if (ssl_ctx_) {
-        SSL_CTX_free(ssl_ctx_);
-    }
-    
     cleanup_openssl();
-
-    if (server_socket_ != static_cast<SOCKET>(-1)) {
-        close_socket(server_socket_);
-    }
     
 #ifdef _WIN32
     WSACleanup();
@@ -190,20 +208,20 @@ void Server::cleanup_openssl() {
     EVP_cleanup();
 }
 
-void Server::create_ssl_context() {
+std::shared_ptr<SSL_CTX> Server::create_ssl_context() const {
     const SSL_METHOD *method = TLS_server_method();
-    ssl_ctx_ = SSL_CTX_new(method);
-    if (!ssl_ctx_) {
+    std::shared_ptr<SSL_CTX> ctx(SSL_CTX_new(method), SSL_CTX_free);
+    if (!ctx) {
         log_openssl_errors();
         throw std::runtime_error("Unable to create SSL context");
     }
 
-    if (SSL_CTX_use_certificate_file(ssl_ctx_, config_.cert_file.c_str(), SSL_FILETYPE_PEM) <= 0) {
+    if (SSL_CTX_use_certificate_file(ctx.get(), config_.cert_file.c_str(), SSL_FILETYPE_PEM) <= 0) {
         log_openssl_errors();
         throw std::runtime_error("Failed to load certificate file: " + config_.cert_file);
     }
 
-    if (SSL_CTX_use_PrivateKey_file(ssl_ctx_, config_.key_file.c_str(), SSL_FILETYPE_PEM) <= 0) {
+    if (SSL_CTX_use_PrivateKey_file(ctx.get(), config_.key_file.c_str(), SSL_FILETYPE_PEM) <= 0) {
         log_openssl_errors();
         throw std::runtime_error("Failed to load private key file: " + config_.key_file);
     }
@@ -211,19 +229,33 @@ void Server::create_ssl_context() {
     if (!config_.client_ca_file.empty()) {
         LOG_INFO("Configuring mutual TLS authentication");
         
-        if (SSL_CTX_load_verify_locations(ssl_ctx_, config_.client_ca_file.c_str(), nullptr) != 1) {
+        if (SSL_CTX_load_verify_locations(ctx.get(), config_.client_ca_file.c_str(), nullptr) != 1) {
             log_openssl_errors();
             throw std::runtime_error("Failed to load client CA file: " + config_.client_ca_file);
         }
         
-        SSL_CTX_set_verify(ssl_ctx_, 
+        SSL_CTX_set_verify(ctx.get(), 
                           SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, 
                           nullptr);
         
         LOG_INFO("Mutual TLS authentication enabled");
     }
     
+    SSL_CTX_set_mode(ctx.get(), SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    if (config_.ktls) {
+        // OpenSSL only moves a connection into the kernel when it runs over
+        // a socket BIO and the kernel supports the negotiated cipher;
+        // otherwise it stays in userspace.
+        if (config_.io_backend == IoBackend::IoUring) {
+            LOG_WARNING("Kernel TLS is not available with the io_uring backend, TLS stays in userspace");
+        } else {
+            SSL_CTX_set_options(ctx.get(), SSL_OP_ENABLE_KTLS);
+        }
+    }
+    SSL_CTX_set_alpn_select_cb(ctx.get(), select_alpn_protocol, const_cast<bool*>(&config_.http2));
+    
     LOG_INFO("SSL context created with cert: " + config_.cert_file + ", key: " + config_.key_file);
+    return ctx;
 }
 
 void Server::setup_signal_handlers() {
@@ -240,6 +272,10 @@ void Server::setup_signal_handlers() {
     sigaction(SIGINT, &sa, nullptr);
     sigaction(SIGTERM, &sa, nullptr);
     sigaction(SIGHUP, &sa, nullptr);
+    
+    // A peer resetting the connection mid-write must surface as EPIPE, not
+    // terminate the process.
+    signal(SIGPIPE, SIG_IGN);
 #endif
     
     LOG_DEBUG("Signal handlers configured");
@@ -251,81 +287,68 @@ void Server::handle_shutdown_signal() {
 }
 
 void Server::handle_reload_signal() {
+    reload_requested_ = true;
+}
+
+void Server::reload_ssl_context() {
     LOG_INFO("Received reload signal, reloading SSL certificates");
     try {
-        reload_ssl_context();
+        // Connections that already called SSL_new keep their own reference
+        // to the previous context, so it is freed once the last one closes.
+        std::atomic_store(&ssl_ctx_, create_ssl_context());
         LOG_INFO("SSL certificates reloaded successfully");
     } catch (const std::exception& e) {
         LOG_ERROR("Failed to reload SSL certificates: " + std::string(e.what()));
     }
 }
 
-void Server::reload_ssl_context() {
-    std::lock_guard<std::mutex> lock(ssl_context_mutex_);
-    
-    SSL_CTX* new_ctx = SSL_CTX_new(TLS_server_method());
-    if (!new_ctx) {
-        throw std::runtime_error("Failed to create new SSL context");
-    }
-    
-    if (SSL_CTX_use_certificate_file(new_ctx, config_.cert_file.c_str(), SSL_FILETYPE_PEM) <= 0) {
-        SSL_CTX_free(new_ctx);
-        throw std::runtime_error("Failed to load new certificate file");
-    }
-    
-    if (SSL_CTX_use_PrivateKey_file(new_ctx, config_.key_file.c_str(), SSL_FILETYPE_PEM) <= 0) {
-        SSL_CTX_free(new_ctx);
-        throw std::runtime_error("Failed to load new private key file");
-    }
-    
-    if (!config_.client_ca_file.empty()) {
-        if (SSL_CTX_load_verify_locations(new_ctx, config_.client_ca_file.c_str(), nullptr) != 1) {
-            SSL_CTX_free(new_ctx);
-            throw std::runtime_error("Failed to load new client CA file");
-        }
-        SSL_CTX_set_verify(new_ctx, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, nullptr);
-    }
-    
-    SSL_CTX* old_ctx = ssl_ctx_;
-    ssl_ctx_ = new_ctx;
-    SSL_CTX_free(old_ctx);
-}
-
-void Server::setup_socket() {
-    server_socket_ = socket(AF_INET, SOCK_STREAM, 0);
+SOCKET Server::setup_socket(bool reuse_port) {
+    const SOCKET listen_socket = socket(AF_INET, SOCK_STREAM, 0);
 #ifdef _WIN32
-    if (server_socket_ == INVALID_SOCKET) {
+    if (listen_socket == INVALID_SOCKET) {
         const int error = WSAGetLastError();
         throw std::runtime_error("Failed to create socket. Error: " + std::to_string(error));
     }
 #else
-    if (server_socket_ < 0) {
+    if (listen_socket < 0) {
         throw std::system_error(errno, std::generic_category(), "Failed to create socket");
     }
 #endif
 
     const int opt = 1;
 #ifdef _WIN32
-    if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt)) == SOCKET_ERROR) {
+    if (setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt)) == SOCKET_ERROR) {
         const int error = WSAGetLastError();
-        close_socket(server_socket_);
+        close_socket(listen_socket);
         throw std::runtime_error("Failed to set socket options. Error: " + std::to_string(error));
     }
 #else
-    if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt)) < 0) {
-        throw std::system_error(errno, std::generic_category(), "Failed to set socket options");
+    if (setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt)) < 0) {
+        const int error = errno;
+        close_socket(listen_socket);
+        throw std::system_error(error, std::generic_category(), "Failed to set socket options");
     }
 #endif
 
+#ifdef SO_REUSEPORT
+    if (reuse_port && setsockopt(listen_socket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        const int error = errno;
+        close_socket(listen_socket);
+        throw std::system_error(error, std::generic_category(), "Failed to set SO_REUSEPORT");
+    }
+#else
+    (void)reuse_port;
+#endif
+
     sockaddr_in server_addr{};
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
     server_addr.sin_port = htons(config_.port);
 
 #ifdef _WIN32
-    if (bind(server_socket_, reinterpret_cast<const sockaddr*>(&server_addr), sizeof(server_addr)) == SOCKET_ERROR) {
+    if (bind(listen_socket, reinterpret_cast<const sockaddr*>(&server_addr), sizeof(server_addr)) == SOCKET_ERROR) {
         const int error = WSAGetLastError();
-        close_socket(server_socket_);
+        close_socket(listen_socket);
         
         std::string error_msg = "Failed to bind socket. Error: " + std::to_string(error);
         if (error == WSAEADDRINUSE) {
@@ -335,109 +358,146 @@ void Server::setup_socket() {
         throw std::runtime_error(error_msg);
     }
 #else
-    if (bind(server_socket_, reinterpret_cast<const sockaddr*>(&server_addr), sizeof(server_addr)) < 0) {
-        throw std::system_error(errno, std::generic_category(), "Failed to bind socket");
+    if (bind(listen_socket, reinterpret_cast<const sockaddr*>(&server_addr), sizeof(server_addr)) < 0) {
+        const int error = errno;
+        close_socket(listen_socket);
+        throw std::system_error(error, std::generic_category(), "Failed to bind socket");
     }
 #endif
 
+    const int backlog = static_cast<int>((std::min)(config_.listen_backlog, static_cast<std::uint32_t>(INT32_MAX)));
 #ifdef _WIN32
-    if (listen(server_socket_, 32) == SOCKET_ERROR) {
+    if (listen(listen_socket, backlog) == SOCKET_ERROR) {
         const int error = WSAGetLastError();
-        close_socket(server_socket_);
+        close_socket(listen_socket);
         throw std::runtime_error("Failed to listen on socket. Error: " + std::to_string(error));
     }
 #else
-    if (listen(server_socket_, 32) < 0) {
-        throw std::system_error(errno, std::generic_category(), "Failed to listen on socket");
+    if (listen(listen_socket, backlog) < 0) {
+        const int error = errno;
+        close_socket(listen_socket);
+        throw std::system_error(error, std::generic_category(), "Failed to listen on socket");
+    }
+    
+    const int flags = fcntl(listen_socket, F_GETFL, 0);
+    if (flags == -1 || fcntl(listen_socket, F_SETFL, flags | O_NONBLOCK) == -1) {
+        const int error = errno;
+        close_socket(listen_socket);
+        throw std::system_error(error, std::generic_category(), "Failed to set listening socket non-blocking");
     }
 #endif
+    
+    return listen_socket;
 }
 
-void Server::handle_new_connection(SOCKET server_socket) {
-    sockaddr_in client_addr{};
-    socklen_t client_len = sizeof(client_addr);
-    const SOCKET client_socket = accept(server_socket, reinterpret_cast<sockaddr*>(&client_addr), &client_len);
-
-#ifdef _WIN32
-    if (client_socket == INVALID_SOCKET) {
-#else
-    if (client_socket < 0) {
-#endif
+void Server::handle_new_connection(Reactor& reactor, SOCKET client_socket) {
+    if (!admission_.try_open_connection()) {
+        close_socket(client_socket);
         return;
     }
-
-    event_loop_->add_socket(client_socket, [this](SOCKET sock) {
-        handle_client_data(sock);
-    });
-}
-
-void Server::handle_client_data(SOCKET client_socket) {
-    pool_.enqueue([this, client_socket] {
-        handle_connection(client_socket);
-    });
-}
-
-void Server::handle_connection(SOCKET client_socket) {
-    std::lock_guard<std::mutex> lock(ssl_context_mutex_);
     
-    SSL* ssl = SSL_new(ssl_ctx_);
+    const std::shared_ptr<SSL_CTX> ssl_ctx = std::atomic_load(&ssl_ctx_);
+    SSL* ssl = SSL_new(ssl_ctx.get());
     if (!ssl) {
+        log_openssl_errors();
         close_socket(client_socket);
+        admission_.close_connection();
         return;
     }
     
-    SSL_set_fd(ssl, static_cast<int>(client_socket));
-
-    if (SSL_accept(ssl) <= 0) {
-        LOG_WARNING("SSL handshake failed");
-        log_openssl_errors();
-    } else {
-        Buffer buffer;
-        
-        while (true) {
-            const int bytes_read = SSL_read(ssl, buffer.write_ptr(), 
-                                          static_cast<int>(buffer.writable_bytes()));
-            if (bytes_read <= 0) break;
-            
-            buffer.has_written(static_cast<size_t>(bytes_read));
-            
-            size_t header_end_pos;
-            if (http_accelerated::HttpOps::instance().find_header_end(
-                buffer.readable_view().data(), buffer.readable_view().size(), &header_end_pos)) {
-                break;
-            }
-            
-            buffer.ensure_capacity(4096);
-        }
+    auto connection = std::make_shared<Connection>(client_socket, ssl, *reactor.loop, pool_, admission_, tls_stats_,
+                                                   router_, config_);
+    
+    try {
+        connection->start();
+    } catch (const std::exception& e) {
+        LOG_WARNING("Failed to register client socket: " + std::string(e.what()));
+    }
+}
 
-        if (buffer.readable_bytes() > 0) {
-            const http::HttpRequest request = parse_request(buffer);
-            LOG_DEBUG("Request: " + request.method + " " + request.uri);
+size_t Server::reactor_count() const {
+#if defined(_WIN32) || !defined(SO_REUSEPORT)
+    return 1;
+#else
+    if (config_.event_loops != 0) {
+        return config_.event_loops;
+    }
+    const unsigned int cores = std::thread::hardware_concurrency();
+    return cores == 0 ? 1 : cores;
+#endif
+}
 
-            const http::HttpResponse response = router_.route_request(request);
-            const std::string response_str = response.to_string();
-            SSL_write(ssl, response_str.c_str(), static_cast<int>(response_str.length()));
+void Server::run() {
+    const size_t loop_count = reactor_count();
+    const size_t thread_count = config_.threads == 0 ? std::thread::hardware_concurrency() : config_.threads;
+    
+    reactors_.reserve(loop_count);
+    for (size_t i = 0; i < loop_count; ++i) {
+        auto reactor = std::make_unique<Reactor>();
+        reactor->loop = EventLoop::create(config_.io_backend);
+        reactor->listen_socket = setup_socket(loop_count > 1);
+        
+        Reactor& owner = *reactor;
+        owner.loop->add_listener(owner.listen_socket, [this, &owner](SOCKET client_socket) {
+            handle_new_connection(owner, client_socket);
+        });
+        reactors_.push_back(std::move(reactor));
+    }
+    
+    LOG_INFO("Server listening on port " + std::to_string(config_.port) + " with " + std::to_string(loop_count) + " " + reactors_[0]->loop->name() + " event loops and " + std::to_string(thread_count) + " threads");
+    
+    for (size_t i = 1; i < reactors_.size(); ++i) {
+        reactors_[i]->thread = std::thread([this, i] {
+            run_reactor(*reactors_[i], i);
+        });
+    }
+    
+    run_reactor(*reactors_[0], 0);
+    
+    std::uint64_t accepted = 0;
+    std::uint64_t dropped = 0;
+    std::uint64_t emfile = 0;
+    for (auto& reactor : reactors_) {
+        if (reactor->thread.joinable()) {
+            reactor->thread.join();
         }
+        
+        const AcceptStats& stats = reactor->loop->accept_stats();
+        accepted += stats.accepted.load(std::memory_order_relaxed);
+        dropped += stats.dropped.load(std::memory_order_relaxed);
+        emfile += stats.emfile.load(std::memory_order_relaxed);
     }
     
-    SSL_shutdown(ssl);
-    SSL_free(ssl);
-    close_socket(client_socket);
+    LOG_INFO("Accepted " + std::to_string(accepted) + " connections (" + std::to_string(dropped) + " dropped, " + std::to_string(emfile) + " EMFILE events)");
+    
+    const AdmissionStats& admission = admission_.stats();
+    LOG_INFO("Admitted " + std::to_string(admission.admitted.load(std::memory_order_relaxed)) + " requests (" +
+             std::to_string(admission.shed.load(std::memory_order_relaxed)) + " shed, " +
+             std::to_string(admission.rejected_connections.load(std::memory_order_relaxed)) + " connections rejected, final limit " +
+             std::to_string(admission_.limit()) + ")");
+    LOG_INFO("Main event loop exited");
 }
 
-void Server::run() {
-    setup_socket();
-    LOG_INFO("Server listening on port " + std::to_string(config_.port) + " with " + std::to_string(config_.threads == 0 ? std::thread::hardware_concurrency() : config_.threads) + " threads");
-
-    event_loop_->add_socket(server_socket_, [this](SOCKET sock) {
-        handle_new_connection(sock);
-    });
+void Server::run_reactor(Reactor& reactor, size_t index) {
+#ifdef __linux__
+    const unsigned int cores = std::thread::hardware_concurrency();
+    if (reactors_.size() > 1 && cores > 0) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(index % cores, &cpu_set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+            LOG_DEBUG("Failed to pin event loop " + std::to_string(index) + " to a core");
+        }
+    }
+#endif
     
     while (running_) {
-        event_loop_->run_once(100);
+        reactor.loop->run_once(100);
+        
+        if (index == 0 && reload_requested_.exchange(false)) {
+            reload_ssl_context();
+        }
     }
-    
-    LOG_INFO("Main event loop exited");
 }
 
 void Server::shutdown() {
@@ -463,70 +523,6 @@ void close_socket(const SOCKET s) { closesocket(s); }
 void close_socket(const SOCKET s) { close(s); }
 #endif
 
-http::HttpRequest parse_request(const Buffer& buffer) {
-    http::HttpRequest request;
-    const auto view = buffer.readable_view();
-    
-    auto parse_result = http_accelerated::HttpOps::instance().parse_method_uri(
-        view.data(), view.size());
-    
-    if (parse_result.valid) {
-        request.method = std::string(view.data(), parse_result.method_len);
-        request.uri = std::string(view.data() + parse_result.uri_start, parse_result.uri_len);
-        request.http_version = "HTTP/1.1";
-    }
-    
-    std::string raw_request(view);
-    std::istringstream request_stream(raw_request);
-    std::string line;
-
-    if (parse_result.valid) {
-        std::getline(request_stream, line);
-    } else {
-        if (std::getline(request_stream, line)) {
-            if (!line.empty() && line.back() == '\r') {
-                line.pop_back();
-            }
-            std::istringstream request_line_stream(line);
-            request_line_stream >> request.method >> request.uri >> request.http_version;
-        }
-    }
-
-    size_t content_length = 0;
-
-    while (std::getline(request_stream, line) && !line.empty() && line != "\r") {
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
-        }
-        const size_t colon_pos = line.find(':');
-        if (colon_pos != std::string::npos) {
-            const std::string key = line.substr(0, colon_pos);
-            const std::string value = line.substr(colon_pos + 2);
-            request.headers[key] = value;
-            
-            if (key == "Content-Length") {
-                content_length = std::stoul(value);
-            }
-        }
-    }
-
-    if (content_length > 0) {
-        const std::string header_delimiter = "\r\n\r\n";
-        const size_t headers_end_pos = raw_request.find(header_delimiter);
-        
-        if (headers_end_pos != std::string::npos) {
-            const size_t body_start = headers_end_pos + header_delimiter.length();
-            if (body_start < raw_request.size()) {
-                const size_t body_available = raw_request.size() - body_start;
-                const size_t body_size = (std::min)(content_length, body_available);
-                request.body = raw_request.substr(body_start, body_size);
-            }
-        }
-    }
-
-    return request;
-}
-
 } // namespace https_server
 
 #ifdef _WIN32
@@ -1,14 +1,17 @@
 #ifndef HTTPS_SERVER_SERVER_HPP
 #define HTTPS_SERVER_SERVER_HPP
 
+#include "core/admission.hpp"
 #include "core/thread_pool.hpp"
 #include "core/config.hpp"
+#include "core/connection.hpp"
 #include "core/event_loop.hpp"
 #include "http/router.hpp"
 #include <cstdint>
 #include <atomic>
-#include <mutex>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -24,6 +27,12 @@ using OSSL_PROVIDER = struct ossl_provider_st;
 
 namespace https_server {
 
+struct Reactor {
+    std::unique_ptr<EventLoop> loop;
+    SOCKET listen_socket = static_cast<SOCKET>(-1);
+    std::thread thread;
+};
+
 class Server {
 public:
     explicit Server(const ServerConfig& config);
@@ -37,6 +46,8 @@ public:
     void run();
     void shutdown();
     Router& get_router() { return router_; }
+    const AdmissionController& admission() const { return admission_; }
+    const TlsStats& tls_stats() const { return tls_stats_; }
     
     void handle_shutdown_signal();
     void handle_reload_signal();
@@ -46,29 +57,30 @@ private:
     void cleanup_openssl();
     void setup_providers();
     void load_openssl_config();
-    void create_ssl_context();
-    void setup_socket();
-    void handle_connection(SOCKET client_socket);
+    std::shared_ptr<SSL_CTX> create_ssl_context() const;
+    SOCKET setup_socket(bool reuse_port);
+    size_t reactor_count() const;
+    void run_reactor(Reactor& reactor, size_t index);
     
     void setup_signal_handlers();
     void reload_ssl_context();
     
-    void handle_new_connection(SOCKET server_socket);
-    void handle_client_data(SOCKET client_socket);
+    void handle_new_connection(Reactor& reactor, SOCKET client_socket);
 
     const ServerConfig config_;
-    SOCKET server_socket_;
+    AdmissionController admission_;
+    TlsStats tls_stats_;
     ThreadPool pool_;
-    SSL_CTX* ssl_ctx_;
+    std::shared_ptr<SSL_CTX> ssl_ctx_;
     Router router_;
     
     OSSL_PROVIDER* default_provider_;
     OSSL_PROVIDER* custom_provider_;
     
     std::atomic<bool> running_;
-    std::mutex ssl_context_mutex_;
+    std::atomic<bool> reload_requested_;
     
-    std::unique_ptr<EventLoop> event_loop_;
+    std::vector<std::unique_ptr<Reactor>> reactors_;
 
 #ifdef _WIN32
     WSADATA wsa_data_;
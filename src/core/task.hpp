@@ -0,0 +1,118 @@
+#ifndef HTTPS_SERVER_TASK_HPP
+#define HTTPS_SERVER_TASK_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace https_server {
+
+// Move-only type-erased callable for the thread pool. Callables of up to
+// INLINE_SIZE bytes (a shared_ptr plus a few scalars) live inside the task
+// itself, so enqueueing them never touches the heap; larger or throwing-move
+// callables fall back to a single allocation. The whole task is one cache line.
+class Task {
+public:
+    static constexpr size_t INLINE_SIZE = 56;
+    
+    Task() noexcept = default;
+    
+    template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Task>::value>>
+    Task(F&& callable) {
+        using Callable = std::decay_t<F>;
+        if constexpr (fits_inline<Callable>()) {
+            ::new (static_cast<void*>(storage_)) Callable(std::forward<F>(callable));
+            ops_ = &Inline<Callable>::ops;
+        } else {
+            ::new (static_cast<void*>(storage_)) Callable*(new Callable(std::forward<F>(callable)));
+            ops_ = &Heap<Callable>::ops;
+        }
+    }
+    
+    Task(Task&& other) noexcept {
+        take(other);
+    }
+    
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+    
+    ~Task() { reset(); }
+    
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    
+    void operator()() { ops_->invoke(storage_); }
+    
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+    
+    void reset() noexcept {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* to, void* from) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+    
+    template <typename Callable>
+    static constexpr bool fits_inline() {
+        return sizeof(Callable) <= INLINE_SIZE &&
+               alignof(Callable) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<Callable>::value;
+    }
+    
+    template <typename Callable>
+    struct Inline {
+        static void invoke(void* storage) {
+            (*static_cast<Callable*>(storage))();
+        }
+        static void move(void* to, void* from) noexcept {
+            ::new (to) Callable(std::move(*static_cast<Callable*>(from)));
+            static_cast<Callable*>(from)->~Callable();
+        }
+        static void destroy(void* storage) noexcept {
+            static_cast<Callable*>(storage)->~Callable();
+        }
+        static constexpr Ops ops{&invoke, &move, &destroy};
+    };
+    
+    template <typename Callable>
+    struct Heap {
+        static void invoke(void* storage) {
+            (**static_cast<Callable**>(storage))();
+        }
+        static void move(void* to, void* from) noexcept {
+            ::new (to) Callable*(*static_cast<Callable**>(from));
+        }
+        static void destroy(void* storage) noexcept {
+            delete *static_cast<Callable**>(storage);
+        }
+        static constexpr Ops ops{&invoke, &move, &destroy};
+    };
+    
+    void take(Task& other) noexcept {
+        if (other.ops_) {
+            other.ops_->move(storage_, other.storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+    
+    alignas(std::max_align_t) unsigned char storage_[INLINE_SIZE];
+    const Ops* ops_ = nullptr;
+};
+
+} // namespace https_server
+
+#endif // HTTPS_SERVER_TASK_HPP
@@ -0,0 +1,225 @@
+#include "core/thread_pool.hpp"
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define HTTPS_SERVER_CPU_RELAX() _mm_pause()
+#else
+#define HTTPS_SERVER_CPU_RELAX() std::this_thread::yield()
+#endif
+
+namespace https_server {
+
+namespace {
+
+std::atomic<std::uint64_t> next_pool_id{1};
+
+// The calling thread's deque for the pool it last submitted to.
+thread_local std::uint64_t local_pool_id = 0;
+thread_local void* local_pool_queue = nullptr;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t num_threads)
+    : id_(next_pool_id.fetch_add(1, std::memory_order_relaxed)),
+      max_queues_(num_threads + MAX_SUBMITTERS),
+      queues_(std::make_unique<std::unique_ptr<Queue>[]>(max_queues_)),
+      owners_(std::make_unique<std::thread::id[]>(max_queues_)),
+      queue_count_(0),
+      overflow_size_(0),
+      wake_epoch_(0),
+      sleepers_(0),
+      stop_(false)
+{
+    for (size_t i = 0; i < num_threads; ++i) {
+        queues_[i] = std::make_unique<Queue>();
+    }
+    queue_count_.store(num_threads, std::memory_order_release);
+    
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers_.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    shutdown();
+}
+
+void ThreadPool::enqueue(Task task) {
+    if (stop_.load(std::memory_order_acquire)) {
+        throw std::runtime_error("enqueue on stopped ThreadPool");
+    }
+    
+    Queue* queue = local_queue();
+    if (!queue || !queue->push(std::move(task))) {
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        overflow_.push_back(std::move(task));
+        overflow_size_.store(overflow_.size(), std::memory_order_relaxed);
+    }
+    
+    notify();
+}
+
+void ThreadPool::shutdown(const std::chrono::milliseconds& timeout) {
+    {
+        std::lock_guard<std::mutex> lock(park_mutex_);
+        stop_.store(true, std::memory_order_release);
+        ++wake_epoch_;
+    }
+    park_condition_.notify_all();
+    
+    const auto start_time = std::chrono::steady_clock::now();
+    for (std::thread &worker : workers_) {
+        if (worker.joinable()) {
+            const auto elapsed = std::chrono::steady_clock::now() - start_time;
+            if (elapsed < timeout) {
+                worker.join();
+            } else {
+                worker.detach();
+            }
+        }
+    }
+    workers_.clear();
+}
+
+size_t ThreadPool::pending_tasks() const {
+    size_t pending = overflow_size_.load(std::memory_order_relaxed);
+    const size_t count = queue_count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        pending += queues_[i]->size();
+    }
+    return pending;
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    Queue* own = queues_[index].get();
+    local_pool_id = id_;
+    local_pool_queue = own;
+    
+    size_t victim = index + 1;
+    while (true) {
+        Task task;
+        if (!spin_for_task(own, victim, task)) {
+            if (!stop_.load(std::memory_order_acquire)) {
+                park();
+                continue;
+            }
+            // Drain whatever was queued before shutdown, then exit.
+            if (!find_task(own, victim, task)) {
+                return;
+            }
+        }
+        task();
+    }
+}
+
+bool ThreadPool::find_task(Queue* own, size_t& victim, Task& task) {
+    if (own && own->pop(task)) {
+        return true;
+    }
+    
+    if (overflow_size_.load(std::memory_order_relaxed) != 0) {
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        if (!overflow_.empty()) {
+            task = std::move(overflow_.front());
+            overflow_.pop_front();
+            overflow_size_.store(overflow_.size(), std::memory_order_relaxed);
+            return true;
+        }
+    }
+    
+    // Start from the last victim that had work, so a busy producer keeps
+    // being drained by the same worker.
+    const size_t count = queue_count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        const size_t index = (victim + i) % count;
+        Queue* queue = queues_[index].get();
+        if (queue == own) {
+            continue;
+        }
+        while (!queue->empty()) {
+            if (queue->steal(task)) {
+                victim = index;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::spin_for_task(Queue* own, size_t& victim, Task& task) {
+    for (int round = 0; round < SPIN_ROUNDS; ++round) {
+        if (find_task(own, victim, task)) {
+            return true;
+        }
+        HTTPS_SERVER_CPU_RELAX();
+    }
+    return false;
+}
+
+bool ThreadPool::has_work() const {
+    return pending_tasks() != 0;
+}
+
+ThreadPool::Queue* ThreadPool::local_queue() {
+    if (local_pool_id == id_) {
+        return static_cast<Queue*>(local_pool_queue);
+    }
+    
+    // First submission from this thread: reuse the deque of an earlier thread
+    // with the same id (it has exited), or register a new one.
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    const std::thread::id self = std::this_thread::get_id();
+    const size_t count = queue_count_.load(std::memory_order_relaxed);
+    
+    Queue* queue = nullptr;
+    for (size_t i = 0; i < count; ++i) {
+        if (owners_[i] == self) {
+            queue = queues_[i].get();
+            break;
+        }
+    }
+    if (!queue && count < max_queues_) {
+        queues_[count] = std::make_unique<Queue>();
+        owners_[count] = self;
+        queue = queues_[count].get();
+        queue_count_.store(count + 1, std::memory_order_release);
+    }
+    
+    // Without a deque, submissions from this thread go to the overflow queue.
+    local_pool_id = id_;
+    local_pool_queue = queue;
+    return queue;
+}
+
+void ThreadPool::notify() {
+    // Pairs with the fence in park(): either a parking worker sees the new
+    // task, or this thread sees the worker in sleepers_.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(park_mutex_);
+        ++wake_epoch_;
+    }
+    park_condition_.notify_one();
+}
+
+void ThreadPool::park() {
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    sleepers_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    
+    if (!stop_.load(std::memory_order_relaxed) && !has_work()) {
+        const std::uint64_t epoch = wake_epoch_;
+        park_condition_.wait(lock, [this, epoch] {
+            return wake_epoch_ != epoch || stop_.load(std::memory_order_relaxed);
+        });
+    }
+    
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+} // namespace https_server
@@ -1,95 +1,84 @@
 #ifndef HTTPS_SERVER_THREAD_POOL_HPP
 #define HTTPS_SERVER_THREAD_POOL_HPP
 
-#include <vector>
-#include <queue>
-#include <thread>
-#include <mutex>
-#include <condition_variable>
-#include <functional>
+#include "core/task.hpp"
+#include "core/work_stealing_deque.hpp"
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace https_server {
 
+// Work-stealing pool. Every worker owns a Chase-Lev deque, and so does every
+// other thread that submits work (the event loops): enqueue() pushes onto the
+// caller's own deque without taking a lock, and idle workers steal from the
+// top of the others. A shared mutex-protected queue only takes the overflow
+// from full deques. Workers that run out of work spin briefly before parking.
 class ThreadPool {
 public:
-    explicit ThreadPool(size_t num_threads) : stop_(false) {
-        for (size_t i = 0; i < num_threads; ++i) {
-            workers_.emplace_back([this] {
-                while (true) {
-                    std::function<void()> task;
-                    {
-                        std::unique_lock<std::mutex> lock(this->queue_mutex_);
-                        this->condition_.wait(lock, [this] { return this->stop_ || !this->tasks_.empty(); });
-                        if (this->stop_ && this->tasks_.empty()) {
-                            return;
-                        }
-                        task = std::move(this->tasks_.front());
-                        this->tasks_.pop();
-                    }
-                    task();
-                }
-            });
-        }
-    }
-
-    ~ThreadPool() {
-        shutdown();
-    }
+    explicit ThreadPool(size_t num_threads);
+    ~ThreadPool();
 
     ThreadPool(const ThreadPool&) = delete;
     ThreadPool& operator=(const ThreadPool&) = delete;
 
-    void enqueue(std::function<void()> task) {
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            if (stop_) {
-                throw std::runtime_error("enqueue on stopped ThreadPool");
-            }
-            tasks_.emplace(std::move(task));
-        }
-        condition_.notify_one();
-    }
+    void enqueue(Task task);
 
-    void shutdown(const std::chrono::milliseconds& timeout = std::chrono::milliseconds(5000)) {
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            stop_ = true;
-        }
-        condition_.notify_all();
-        
-        const auto start_time = std::chrono::steady_clock::now();
-        for (std::thread &worker : workers_) {
-            if (worker.joinable()) {
-                const auto elapsed = std::chrono::steady_clock::now() - start_time;
-                if (elapsed < timeout) {
-                    worker.join();
-                } else {
-                    worker.detach();
-                }
-            }
-        }
-        workers_.clear();
-    }
+    void shutdown(const std::chrono::milliseconds& timeout = std::chrono::milliseconds(5000));
 
-    size_t pending_tasks() const {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        return tasks_.size();
-    }
+    size_t pending_tasks() const;
 
     bool is_stopped() const {
-        return stop_;
+        return stop_.load(std::memory_order_acquire);
     }
 
 private:
+    static constexpr size_t QUEUE_CAPACITY = 256;
+    // Deques for threads outside the pool, such as the event loops. Further
+    // submitters share the overflow queue.
+    static constexpr size_t MAX_SUBMITTERS = 64;
+    static constexpr int SPIN_ROUNDS = 64;
+    
+    using Queue = WorkStealingDeque<Task, QUEUE_CAPACITY>;
+    
+    void worker_loop(size_t index);
+    bool find_task(Queue* own, size_t& victim, Task& task);
+    bool spin_for_task(Queue* own, size_t& victim, Task& task);
+    bool has_work() const;
+    Queue* local_queue();
+    void notify();
+    void park();
+    
+    const std::uint64_t id_;
     std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
-    mutable std::mutex queue_mutex_;
-    std::condition_variable condition_;
+    
+    // One slot per worker plus MAX_SUBMITTERS, allocated up front so that
+    // stealers never see the arrays move. Slots [0, queue_count_) are
+    // published with a release store and never removed; the first
+    // workers_.size() belong to the workers.
+    const size_t max_queues_;
+    std::unique_ptr<std::unique_ptr<Queue>[]> queues_;
+    std::unique_ptr<std::thread::id[]> owners_;
+    std::atomic<size_t> queue_count_;
+    std::mutex registry_mutex_;
+    
+    std::deque<Task> overflow_;
+    std::atomic<size_t> overflow_size_;
+    mutable std::mutex overflow_mutex_;
+    
+    std::mutex park_mutex_;
+    std::condition_variable park_condition_;
+    std::uint64_t wake_epoch_;
+    std::atomic<int> sleepers_;
     std::atomic<bool> stop_;
 };
 
 } // namespace https_server
 
-#endif // HTTPS_SERVER_THREAD_POOL_HPP
\ No newline at end of file
+#endif // HTTPS_SERVER_THREAD_POOL_HPP
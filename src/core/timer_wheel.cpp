@@ -0,0 +1,133 @@
+#include "core/timer_wheel.hpp"
+
+namespace https_server {
+
+TimerWheel::~TimerWheel() {
+    for (auto& level : slots_) {
+        for (Timer*& head : level) {
+            while (Timer* timer = head) {
+                unlink(*timer);
+                if (timer->owned_) {
+                    delete timer;
+                }
+            }
+        }
+    }
+}
+
+void TimerWheel::schedule(Timer& timer, std::uint64_t delay) {
+    if (timer.wheel_) {
+        timer.wheel_->unlink(timer);
+    }
+    
+    if (delay == 0) delay = 1;
+    if (delay > MAX_DELAY) delay = MAX_DELAY;
+    
+    timer.expires_ = current_ + delay;
+    link(timer);
+}
+
+void TimerWheel::schedule_once(std::uint64_t delay, Timer::Callback callback) {
+    Timer* timer = new Timer(std::move(callback));
+    timer->owned_ = true;
+    schedule(*timer, delay);
+}
+
+void TimerWheel::link(Timer& timer) {
+    const std::uint64_t delta = timer.expires_ > current_ ? timer.expires_ - current_ : 0;
+    
+    unsigned level = 0;
+    while (level + 1 < LEVELS && delta >= (1ull << (LEVEL_BITS * (level + 1)))) {
+        ++level;
+    }
+    
+    // Already-due timers go in the current slot so the running tick fires them.
+    const std::uint64_t expires = delta == 0 ? current_ : timer.expires_;
+    Timer*& head = slots_[level][(expires >> (LEVEL_BITS * level)) & (SLOTS - 1)];
+    
+    timer.prev_ = nullptr;
+    timer.next_ = head;
+    if (head) {
+        head->prev_ = &timer;
+    }
+    head = &timer;
+    timer.slot_ = &head;
+    timer.wheel_ = this;
+    ++count_;
+}
+
+void TimerWheel::unlink(Timer& timer) noexcept {
+    if (timer.prev_) {
+        timer.prev_->next_ = timer.next_;
+    } else {
+        *timer.slot_ = timer.next_;
+    }
+    if (timer.next_) {
+        timer.next_->prev_ = timer.prev_;
+    }
+    
+    timer.prev_ = nullptr;
+    timer.next_ = nullptr;
+    timer.slot_ = nullptr;
+    timer.wheel_ = nullptr;
+    --count_;
+}
+
+void TimerWheel::cascade(unsigned level) {
+    Timer*& head = slots_[level][(current_ >> (LEVEL_BITS * level)) & (SLOTS - 1)];
+    while (Timer* timer = head) {
+        unlink(*timer);
+        link(*timer);
+    }
+}
+
+void TimerWheel::advance(std::uint64_t now) {
+    while (current_ < now) {
+        if (count_ == 0) {
+            current_ = now;
+            return;
+        }
+        
+        ++current_;
+        
+        // At a level boundary, redistribute the upper slot that now covers
+        // the current range, highest level first.
+        unsigned top = 0;
+        while (top + 1 < LEVELS && (current_ & ((1ull << (LEVEL_BITS * (top + 1))) - 1)) == 0) {
+            ++top;
+        }
+        for (unsigned level = top; level > 0; --level) {
+            cascade(level);
+        }
+        
+        Timer*& head = slots_[0][current_ & (SLOTS - 1)];
+        while (Timer* timer = head) {
+            unlink(*timer);
+            if (timer->owned_) {
+                const Timer::Callback callback = std::move(timer->callback_);
+                delete timer;
+                callback();
+            } else {
+                // The callback may destroy the timer's owner.
+                const Timer::Callback callback = timer->callback_;
+                callback();
+            }
+        }
+    }
+}
+
+std::int64_t TimerWheel::next_event() const noexcept {
+    if (count_ == 0) {
+        return -1;
+    }
+    
+    for (std::uint64_t ticks = 1; ticks < SLOTS; ++ticks) {
+        if (slots_[0][(current_ + ticks) & (SLOTS - 1)]) {
+            return static_cast<std::int64_t>(ticks);
+        }
+    }
+    
+    return static_cast<std::int64_t>(SLOTS - (current_ & (SLOTS - 1)));
+}
+
+} // namespace https_server
@@ -0,0 +1,95 @@
+#ifndef HTTPS_SERVER_TIMER_WHEEL_HPP
+#define HTTPS_SERVER_TIMER_WHEEL_HPP
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+namespace https_server {
+
+class TimerWheel;
+
+// Intrusive timer node. The owner embeds it (one per connection) and
+// re-arms it freely: scheduling only relinks pointers, never allocates.
+// Destroying an armed timer cancels it.
+class Timer {
+public:
+    using Callback = std::function<void()>;
+    
+    Timer() = default;
+    explicit Timer(Callback callback) : callback_(std::move(callback)) {}
+    ~Timer() { cancel(); }
+    
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+    
+    void set_callback(Callback callback) { callback_ = std::move(callback); }
+    void cancel() noexcept;
+    bool armed() const noexcept { return wheel_ != nullptr; }
+
+private:
+    friend class TimerWheel;
+    
+    Timer* prev_ = nullptr;
+    Timer* next_ = nullptr;
+    Timer** slot_ = nullptr;
+    TimerWheel* wheel_ = nullptr;
+    std::uint64_t expires_ = 0;
+    bool owned_ = false;
+    Callback callback_;
+};
+
+// Hierarchical hashed timer wheel with 1 ms ticks: four levels of 64 slots
+// cover ~4.6 hours, longer delays are clamped. Insert and cancel are O(1);
+// timers in upper levels cascade down once per 64^level ticks.
+class TimerWheel {
+public:
+    static constexpr unsigned LEVEL_BITS = 6;
+    static constexpr unsigned SLOTS = 1u << LEVEL_BITS;
+    static constexpr unsigned LEVELS = 4;
+    static constexpr std::uint64_t MAX_DELAY = (1ull << (LEVEL_BITS * LEVELS)) - 1;
+    
+    explicit TimerWheel(std::uint64_t now = 0) noexcept : current_(now) {}
+    ~TimerWheel();
+    
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+    
+    // (Re)arms the timer to fire 'delay' ticks from now; 0 fires on the next tick.
+    void schedule(Timer& timer, std::uint64_t delay);
+    
+    // One-shot timer whose node is owned and freed by the wheel.
+    void schedule_once(std::uint64_t delay, Timer::Callback callback);
+    
+    // Fires every timer that expires at or before 'now'.
+    void advance(std::uint64_t now);
+    
+    // Ticks until the next wheel event (an expiry or a cascade), or -1 if
+    // no timer is armed. Never later than the earliest expiry.
+    std::int64_t next_event() const noexcept;
+    
+    std::uint64_t now() const noexcept { return current_; }
+    size_t size() const noexcept { return count_; }
+    bool empty() const noexcept { return count_ == 0; }
+
+private:
+    friend class Timer;
+    
+    void link(Timer& timer);
+    void unlink(Timer& timer) noexcept;
+    void cascade(unsigned level);
+    
+    std::array<std::array<Timer*, SLOTS>, LEVELS> slots_{};
+    std::uint64_t current_;
+    size_t count_ = 0;
+};
+
+inline void Timer::cancel() noexcept {
+    if (wheel_) {
+        wheel_->unlink(*this);
+    }
+}
+
+} // namespace https_server
+
+#endif // HTTPS_SERVER_TIMER_WHEEL_HPP
@@ -0,0 +1,120 @@
+#ifndef HTTPS_SERVER_WORK_STEALING_DEQUE_HPP
+#define HTTPS_SERVER_WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace https_server {
+
+// Bounded Chase-Lev deque, using the memory orderings from Le et al.,
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (2013).
+// Only the owning thread may push and pop, at the bottom. Any thread may
+// steal from the top, so thieves take the oldest work first.
+//
+// Elements are moved in and out of their cells rather than copied through
+// pointers. A thief only moves its element out after winning the race on
+// top_, so each cell also carries a flag that the thief clears when it is
+// done. The owner treats a cell that is still occupied as "full" and never
+// overwrites it. push() fails when the deque is full; it does not grow.
+template <typename T, size_t Capacity>
+class WorkStealingDeque {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    WorkStealingDeque() : cells_(new Cell[Capacity]) {}
+    
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+    
+    // Owner only. Leaves 'value' untouched and returns false when full.
+    bool push(T&& value) {
+        const std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        Cell& cell = cells_[static_cast<size_t>(bottom) & MASK];
+        if (cell.occupied.load(std::memory_order_acquire)) {
+            return false;
+        }
+        
+        cell.value = std::move(value);
+        cell.occupied.store(true, std::memory_order_relaxed);
+        bottom_.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Owner only. Takes the most recently pushed element.
+    bool pop(T& out) {
+        const std::int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t top = top_.load(std::memory_order_relaxed);
+        
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+        
+        if (top == bottom) {
+            // Last element: race the thieves for it.
+            const bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                          std::memory_order_relaxed);
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            if (!won) {
+                return false;
+            }
+        }
+        
+        take(cells_[static_cast<size_t>(bottom) & MASK], out);
+        return true;
+    }
+    
+    // Any thread. May fail spuriously when another thread wins the race for
+    // the same element; callers retry while !empty().
+    bool steal(T& out) {
+        std::int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t bottom = bottom_.load(std::memory_order_acquire);
+        
+        if (top >= bottom) {
+            return false;
+        }
+        
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return false;
+        }
+        
+        take(cells_[static_cast<size_t>(top) & MASK], out);
+        return true;
+    }
+    
+    size_t size() const noexcept {
+        const std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        const std::int64_t top = top_.load(std::memory_order_relaxed);
+        return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+    }
+    
+    bool empty() const noexcept { return size() == 0; }
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+    
+    struct Cell {
+        std::atomic<bool> occupied{false};
+        T value{};
+    };
+    
+    static void take(Cell& cell, T& out) {
+        out = std::move(cell.value);
+        cell.occupied.store(false, std::memory_order_release);
+    }
+    
+    alignas(64) std::atomic<std::int64_t> top_{0};
+    alignas(64) std::atomic<std::int64_t> bottom_{0};
+    std::unique_ptr<Cell[]> cells_;
+};
+
+} // namespace https_server
+
+#endif // HTTPS_SERVER_WORK_STEALING_DEQUE_HPP
@@ -0,0 +1,104 @@
+#include "http/body.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace https_server::http {
+
+#ifndef _WIN32
+static std::int64_t stat_modified_ns(const struct stat& info) noexcept {
+#ifdef __APPLE__
+    const struct timespec& modified = info.st_mtimespec;
+#else
+    const struct timespec& modified = info.st_mtim;
+#endif
+    return static_cast<std::int64_t>(modified.tv_sec) * 1000000000 + modified.tv_nsec;
+}
+#endif
+
+std::int64_t modified_ns(const std::string& path) noexcept {
+#ifndef _WIN32
+    struct stat info;
+    return ::stat(path.c_str(), &info) == 0 ? stat_modified_ns(info) : -1;
+#else
+    struct _stat64 info;
+    return _stat64(path.c_str(), &info) == 0 ? static_cast<std::int64_t>(info.st_mtime) * 1000000000 : -1;
+#endif
+}
+
+std::shared_ptr<const FileDescriptor> FileDescriptor::open(const std::string& path) {
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        return nullptr;
+    }
+    return std::shared_ptr<const FileDescriptor>(new FileDescriptor(fd, static_cast<std::uint64_t>(info.st_size),
+                                                                    stat_modified_ns(info),
+                                                                    static_cast<std::uint64_t>(info.st_ino)));
+#else
+    static_cast<void>(path);
+    return nullptr;
+#endif
+}
+
+FileDescriptor::~FileDescriptor() {
+#ifndef _WIN32
+    ::close(fd_);
+#endif
+}
+
+void FileRegionReader::reset(const FileRegion& region) noexcept {
+    region_ = &region;
+    sent_ = 0;
+#if !defined(_WIN32) && !defined(__APPLE__)
+    // Doubles the readahead window, so the pieces read below mostly come
+    // from the page cache.
+    posix_fadvise(region.file->get(), static_cast<off_t>(region.offset), static_cast<off_t>(region.length),
+                  POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+size_t FileRegionReader::produce(char* out, size_t capacity, bool& done) {
+#ifndef _WIN32
+    const size_t length = static_cast<size_t>(std::min<std::uint64_t>(capacity, region_->length - sent_));
+    size_t filled = 0;
+    while (filled < length) {
+        const ssize_t result = pread(region_->file->get(), out + filled, length - filled,
+                                     static_cast<off_t>(region_->offset + sent_ + filled));
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("File read failed: " + std::string(std::strerror(errno)));
+        }
+        if (result == 0) {
+            throw std::runtime_error("File ended before the response body did");
+        }
+        filled += static_cast<size_t>(result);
+    }
+    sent_ += filled;
+    done = sent_ == region_->length;
+    return filled;
+#else
+    static_cast<void>(out);
+    static_cast<void>(capacity);
+    done = true;
+    return 0;
+#endif
+}
+
+} // namespace https_server::http
@@ -0,0 +1,101 @@
+#ifndef HTTPS_SERVER_BODY_HPP
+#define HTTPS_SERVER_BODY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace https_server::http {
+
+// Generates a response body piece by piece, so its size does not decide how
+// much memory the response takes or how late its first byte leaves. produce
+// runs on the connection's event loop each time the socket has taken the
+// previous piece, so it should only do bounded, non-blocking work.
+class BodyProducer {
+public:
+    virtual ~BodyProducer() = default;
+    
+    // Writes up to 'capacity' bytes of body to 'out' and returns how many.
+    // Sets 'done' along with the last bytes, or with none. Returning 0
+    // without 'done' is treated as a failure and closes the connection.
+    virtual size_t produce(char* out, size_t capacity, bool& done) = 0;
+};
+
+// Immutable bytes shared by every response that sends them, such as a
+// cached file.
+using SharedBuffer = std::shared_ptr<const std::string>;
+
+// A file opened for reading, closed with its last reference.
+class FileDescriptor {
+public:
+    // Returns nullptr when 'path' is not a regular file or cannot be opened.
+    static std::shared_ptr<const FileDescriptor> open(const std::string& path);
+    ~FileDescriptor();
+    
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+    
+    int get() const noexcept { return fd_; }
+    // As of when it was opened: the size, the modification time in
+    // nanoseconds since the epoch, and the inode, which together tell
+    // versions of the file apart without reading it.
+    std::uint64_t size() const noexcept { return size_; }
+    std::int64_t modified_ns() const noexcept { return modified_ns_; }
+    std::uint64_t inode() const noexcept { return inode_; }
+
+private:
+    FileDescriptor(int fd, std::uint64_t size, std::int64_t modified_ns, std::uint64_t inode) noexcept
+        : fd_(fd), size_(size), modified_ns_(modified_ns), inode_(inode) {}
+    
+    int fd_;
+    std::uint64_t size_;
+    std::int64_t modified_ns_;
+    std::uint64_t inode_;
+};
+
+// The modification time of 'path' in nanoseconds since the epoch, from the
+// same field FileDescriptor::modified_ns() reads, or -1 when it has none.
+std::int64_t modified_ns(const std::string& path) noexcept;
+
+// 'length' bytes of a file from 'offset', read as they are sent, so neither
+// the file's size nor the number of responses sending it decides how much
+// memory they take.
+struct FileRegion {
+    std::shared_ptr<const FileDescriptor> file;
+    std::uint64_t offset = 0;
+    std::uint64_t length = 0;
+};
+
+// Where a response body lives when the response does not own it. The
+// monostate stands for the response's own 'body' string.
+using BodySource = std::variant<std::monostate, SharedBuffer, FileRegion>;
+
+// Sends a FileRegion as a producer: each piece is read with pread into the
+// buffer being sent from, so at most a piece of the file is in memory per
+// response. Connections and streams keep one and reset it per response.
+class FileRegionReader final : public BodyProducer {
+public:
+    // Starts on 'region', which must outlive the reader's use of it, and
+    // hints the kernel to read ahead of it sequentially.
+    void reset(const FileRegion& region) noexcept;
+    
+    size_t produce(char* out, size_t capacity, bool& done) override;
+    
+    // For sending the rest of the region some other way, such as with
+    // SSL_sendfile: the descriptor, the file offset of the next unsent byte,
+    // and how to account for bytes sent from it.
+    int fd() const noexcept { return region_->file->get(); }
+    std::uint64_t position() const noexcept { return region_->offset + sent_; }
+    void advance(std::uint64_t sent) noexcept { sent_ += sent; }
+
+private:
+    const FileRegion* region_ = nullptr;
+    std::uint64_t sent_ = 0;
+};
+
+} // namespace https_server::http
+
+#endif // HTTPS_SERVER_BODY_HPP
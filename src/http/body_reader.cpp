@@ -0,0 +1,189 @@
+#include "http/body_reader.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace https_server::http {
+
+static int hex_value(char c) noexcept {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// tchar (RFC 9110 5.6.2), as in field names.
+static bool is_tchar(unsigned char c) noexcept {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+           (c != '\0' && std::strchr("!#$%&'*+-.^_`|~", c) != nullptr);
+}
+
+// field-vchar, SP and HTAB (RFC 9110 5.5).
+static bool is_value_char(unsigned char c) noexcept {
+    return (c > 0x20 && c != 0x7F) || c == ' ' || c == '\t';
+}
+
+void BodyReader::start_length(size_t content_length) noexcept {
+    state_ = State::Length;
+    status_ = content_length == 0 ? BodyStatus::Complete : BodyStatus::Incomplete;
+    error_ = BodyError::None;
+    max_size_ = 0;
+    remaining_ = content_length;
+    body_size_ = 0;
+}
+
+void BodyReader::start_chunked(size_t max_size) noexcept {
+    state_ = State::ChunkSize;
+    status_ = BodyStatus::Incomplete;
+    error_ = BodyError::None;
+    max_size_ = max_size;
+    remaining_ = 0;
+    body_size_ = 0;
+    line_bytes_ = 0;
+    digits_ = 0;
+}
+
+BodyStatus BodyReader::fail(BodyError error) noexcept {
+    error_ = error;
+    status_ = BodyStatus::Error;
+    return status_;
+}
+
+BodyStatus BodyReader::decode(const char* in, size_t len, char* out, size_t& consumed, size_t& produced) noexcept {
+    consumed = 0;
+    produced = 0;
+    
+    while (status_ == BodyStatus::Incomplete && consumed < len) {
+        if (state_ == State::Length || state_ == State::ChunkData) {
+            const size_t count = std::min(remaining_, len - consumed);
+            if (out + produced != in + consumed) {
+                std::memmove(out + produced, in + consumed, count);
+            }
+            consumed += count;
+            produced += count;
+            body_size_ += count;
+            remaining_ -= count;
+            
+            if (remaining_ == 0) {
+                if (state_ == State::Length) {
+                    status_ = BodyStatus::Complete;
+                } else {
+                    state_ = State::ChunkDataCR;
+                }
+            }
+            continue;
+        }
+        
+        const char c = in[consumed++];
+        switch (state_) {
+            case State::ChunkSize: {
+                const int digit = hex_value(c);
+                if (digit >= 0) {
+                    // Leading zeros are fine; more than 16 significant digits are not.
+                    if (remaining_ > (SIZE_MAX >> 4)) {
+                        return fail(BodyError::InvalidChunk);
+                    }
+                    remaining_ = (remaining_ << 4) | static_cast<size_t>(digit);
+                    ++digits_;
+                } else if (digits_ == 0) {
+                    return fail(BodyError::InvalidChunk);
+                } else if (c == ';' || c == ' ' || c == '\t') {
+                    state_ = State::ChunkExtension;
+                } else if (c == '\r') {
+                    state_ = State::ChunkSizeLF;
+                } else {
+                    return fail(BodyError::InvalidChunk);
+                }
+                break;
+            }
+            case State::ChunkExtension:
+                if (c == '\r') {
+                    state_ = State::ChunkSizeLF;
+                } else if (c == '\n') {
+                    return fail(BodyError::InvalidChunk);
+                }
+                break;
+            case State::ChunkSizeLF:
+                if (c != '\n') {
+                    return fail(BodyError::InvalidChunk);
+                }
+                if (remaining_ == 0) {
+                    state_ = State::TrailerStart;
+                    line_bytes_ = 0;
+                    break;
+                }
+                if (max_size_ != 0 && remaining_ > max_size_ - body_size_) {
+                    return fail(BodyError::TooLarge);
+                }
+                state_ = State::ChunkData;
+                break;
+            case State::ChunkDataCR:
+                if (c != '\r') {
+                    return fail(BodyError::InvalidChunk);
+                }
+                state_ = State::ChunkDataLF;
+                break;
+            case State::ChunkDataLF:
+                if (c != '\n') {
+                    return fail(BodyError::InvalidChunk);
+                }
+                state_ = State::ChunkSize;
+                line_bytes_ = 0;
+                digits_ = 0;
+                break;
+            case State::TrailerStart:
+                if (c == '\r') {
+                    state_ = State::FinalLF;
+                } else if (is_tchar(static_cast<unsigned char>(c))) {
+                    state_ = State::TrailerName;
+                } else {
+                    return fail(BodyError::InvalidChunk);
+                }
+                break;
+            case State::TrailerName:
+                if (c == ':') {
+                    state_ = State::TrailerValue;
+                } else if (!is_tchar(static_cast<unsigned char>(c))) {
+                    return fail(BodyError::InvalidChunk);
+                }
+                break;
+            case State::TrailerValue:
+                if (c == '\r') {
+                    state_ = State::TrailerLF;
+                } else if (!is_value_char(static_cast<unsigned char>(c))) {
+                    return fail(BodyError::InvalidChunk);
+                }
+                break;
+            case State::TrailerLF:
+                if (c != '\n') {
+                    return fail(BodyError::InvalidChunk);
+                }
+                state_ = State::TrailerStart;
+                break;
+            case State::FinalLF:
+                if (c != '\n') {
+                    return fail(BodyError::InvalidChunk);
+                }
+                status_ = BodyStatus::Complete;
+                break;
+            case State::Length:
+            case State::ChunkData:
+                break;
+        }
+        
+        // Bounds the framing a client can make us walk through per chunk.
+        if (state_ == State::ChunkSize || state_ == State::ChunkExtension) {
+            if (++line_bytes_ > MAX_CHUNK_LINE) {
+                return fail(BodyError::InvalidChunk);
+            }
+        } else if (state_ == State::TrailerName || state_ == State::TrailerValue ||
+                   state_ == State::TrailerLF || state_ == State::FinalLF) {
+            if (++line_bytes_ > MAX_TRAILER_BYTES) {
+                return fail(BodyError::InvalidChunk);
+            }
+        }
+    }
+    
+    return status_;
+}
+
+} // namespace https_server::http
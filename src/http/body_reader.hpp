@@ -0,0 +1,79 @@
+#ifndef HTTPS_SERVER_BODY_READER_HPP
+#define HTTPS_SERVER_BODY_READER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace https_server {
+namespace http {
+
+enum class BodyStatus {
+    Incomplete,
+    Complete,
+    Error
+};
+
+enum class BodyError {
+    None,
+    TooLarge,
+    InvalidChunk
+};
+
+// Incremental request body decoder for Content-Length and chunked framing
+// (RFC 9112 6, 7.1). Framed bytes are fed as they arrive and the body bytes
+// come out with the framing stripped. Chunk extensions are only checked
+// for line endings. Trailer fields must be field-name ":" field-value, with
+// no obs-fold, and are then discarded.
+class BodyReader {
+public:
+    // Chunk-size line including extensions, and the whole trailer section.
+    static constexpr size_t MAX_CHUNK_LINE = 1024;
+    static constexpr size_t MAX_TRAILER_BYTES = 8192;
+    
+    // A 'max_size' of 0 leaves the body unbounded.
+    void start_length(size_t content_length) noexcept;
+    void start_chunked(size_t max_size) noexcept;
+    
+    // Decodes framed bytes from 'in' and writes body bytes to 'out', which
+    // may alias 'in' as long as it does not start past it, so a buffer can
+    // be decoded in place. Stops right after the end of the body; bytes past
+    // 'consumed' belong to the next request.
+    BodyStatus decode(const char* in, size_t len, char* out, size_t& consumed, size_t& produced) noexcept;
+    
+    BodyStatus status() const noexcept { return status_; }
+    BodyError error() const noexcept { return error_; }
+    // Body bytes produced so far.
+    size_t body_size() const noexcept { return body_size_; }
+
+private:
+    enum class State {
+        Length,
+        ChunkSize,
+        ChunkExtension,
+        ChunkSizeLF,
+        ChunkData,
+        ChunkDataCR,
+        ChunkDataLF,
+        TrailerStart,
+        TrailerName,
+        TrailerValue,
+        TrailerLF,
+        FinalLF
+    };
+    
+    BodyStatus fail(BodyError error) noexcept;
+    
+    State state_ = State::Length;
+    BodyStatus status_ = BodyStatus::Complete;
+    BodyError error_ = BodyError::None;
+    size_t max_size_ = 0;
+    size_t remaining_ = 0;
+    size_t body_size_ = 0;
+    size_t line_bytes_ = 0;
+    size_t digits_ = 0;
+};
+
+} // namespace http
+} // namespace https_server
+
+#endif // HTTPS_SERVER_BODY_READER_HPP
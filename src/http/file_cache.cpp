@@ -0,0 +1,333 @@
+#include "http/file_cache.hpp"
+#include "http/body.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <system_error>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace https_server {
+
+namespace {
+
+std::int64_t now_ticks() noexcept {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+constexpr std::int64_t REVALIDATE_TICKS =
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(FileCache::REVALIDATE_INTERVAL).count();
+
+#ifdef __linux__
+// Whatever can make a cached copy stale. Creation only matters for
+// directories, which need watches of their own.
+constexpr std::uint32_t WATCH_MASK = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE |
+                                     IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+#endif
+
+} // namespace
+
+FileCache::FileCache(std::string root, size_t capacity, size_t max_file_size)
+    : root_(std::move(root)),
+      capacity_(capacity),
+      max_file_size_(std::min(max_file_size, capacity)),
+      bytes_(0),
+      epoch_(0),
+      next_version_(1),
+      watching_(false),
+      inotify_fd_(-1),
+      stop_fd_(-1) {
+    if (capacity_ > 0) {
+        start_watching();
+    }
+}
+
+FileCache::~FileCache() {
+#ifdef __linux__
+    if (watcher_.joinable()) {
+        const std::uint64_t stop = 1;
+        if (write(stop_fd_, &stop, sizeof(stop)) < 0) {
+            LOG_ERROR("Failed to stop the file cache watcher: " + std::string(std::strerror(errno)));
+        }
+        watcher_.join();
+    }
+    if (inotify_fd_ >= 0) {
+        close(inotify_fd_);
+    }
+    if (stop_fd_ >= 0) {
+        close(stop_fd_);
+    }
+#endif
+}
+
+std::shared_ptr<const FileCache::File> FileCache::get(const std::string& path) {
+    if (capacity_ == 0) {
+        return nullptr;
+    }
+    
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        const auto it = entries_.find(path);
+        if (it != entries_.end()) {
+            Entry& entry = it->second;
+            entry.referenced.store(true, std::memory_order_relaxed);
+            if (watching()) {
+                return entry.file;
+            }
+            const std::int64_t now = now_ticks();
+            if (now - entry.validated.load(std::memory_order_relaxed) < REVALIDATE_TICKS ||
+                revalidate(path, *entry.file)) {
+                entry.validated.store(now, std::memory_order_relaxed);
+                return entry.file;
+            }
+        }
+    }
+    
+    const std::uint64_t epoch = epoch_.load(std::memory_order_acquire);
+    std::shared_ptr<const File> file = load(path);
+    if (file) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (epoch_.load(std::memory_order_relaxed) == epoch) {
+            insert(path, file);
+        }
+    }
+    return file;
+}
+
+size_t FileCache::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return entries_.size();
+}
+
+size_t FileCache::bytes() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return bytes_;
+}
+
+std::shared_ptr<const FileCache::File> FileCache::load(const std::string& path) {
+    const std::string full_path = root_ + path;
+    
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(full_path, error)) {
+        return nullptr;
+    }
+    const auto modified = std::filesystem::last_write_time(full_path, error);
+    const auto size = std::filesystem::file_size(full_path, error);
+    // Validators take the time from stat, as those of streamed files do, so
+    // a file's Last-Modified is the same whether or not it is cached.
+    const std::int64_t mtime_ns = http::modified_ns(full_path);
+    if (error || size > max_file_size_ || mtime_ns < 0) {
+        return nullptr;
+    }
+    
+    std::ifstream in(full_path, std::ios::binary);
+    if (!in.is_open()) {
+        return nullptr;
+    }
+    
+    auto file = std::make_shared<File>();
+    file->content.resize(static_cast<size_t>(size));
+    in.read(file->content.data(), static_cast<std::streamsize>(file->content.size()));
+    file->content.resize(static_cast<size_t>(in.gcount()));
+    file->version = next_version_.fetch_add(1, std::memory_order_relaxed);
+    file->modified = modified;
+    file->validators.etag = http::make_etag(file->content);
+    file->validators.modified = mtime_ns / 1000000000;
+    file->validators.last_modified = http::format_http_date(file->validators.modified);
+    
+    LOG_DEBUG("Loaded file: " + full_path + " (" + std::to_string(file->content.size()) + " bytes)");
+    return file;
+}
+
+bool FileCache::revalidate(const std::string& path, const File& file) const {
+    const std::string full_path = root_ + path;
+    std::error_code error;
+    const auto modified = std::filesystem::last_write_time(full_path, error);
+    const auto size = std::filesystem::file_size(full_path, error);
+    return !error && modified == file.modified && size == file.content.size();
+}
+
+void FileCache::insert(const std::string& path, const std::shared_ptr<const File>& file) {
+    const auto existing = entries_.find(path);
+    if (existing != entries_.end()) {
+        bytes_ -= existing->second.file->content.size();
+        entries_.erase(existing);
+    }
+    
+    const size_t size = file->content.size();
+    evict(size);
+    
+    Entry& entry = entries_[path];
+    entry.file = file;
+    entry.validated.store(now_ticks(), std::memory_order_relaxed);
+    bytes_ += size;
+}
+
+void FileCache::evict(size_t needed) {
+    // The first pass spares entries hit since the last eviction and clears
+    // their mark; the second takes whatever it reaches.
+    for (int pass = 0; pass < 2 && bytes_ + needed > capacity_; ++pass) {
+        for (auto it = entries_.begin(); it != entries_.end() && bytes_ + needed > capacity_;) {
+            if (it->second.referenced.exchange(false, std::memory_order_relaxed)) {
+                ++it;
+                continue;
+            }
+            bytes_ -= it->second.file->content.size();
+            it = entries_.erase(it);
+        }
+    }
+}
+
+void FileCache::invalidate(const std::string& path) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    epoch_.fetch_add(1, std::memory_order_release);
+    const auto it = entries_.find(path);
+    if (it != entries_.end()) {
+        bytes_ -= it->second.file->content.size();
+        entries_.erase(it);
+    }
+}
+
+void FileCache::invalidate_tree(const std::string& directory) {
+    const std::string prefix = directory + "/";
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    epoch_.fetch_add(1, std::memory_order_release);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0) {
+            bytes_ -= it->second.file->content.size();
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void FileCache::start_watching() {
+#ifdef __linux__
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotify_fd_ < 0 || stop_fd_ < 0) {
+        LOG_WARNING("inotify unavailable, checking cached files' mtime instead: " +
+                    std::string(std::strerror(errno)));
+        return;
+    }
+    
+    watching_.store(true, std::memory_order_relaxed);
+    watch_tree("");
+    watcher_ = std::thread(&FileCache::watch_events, this);
+#else
+    LOG_INFO("No inotify on this platform, checking cached files' mtime instead");
+#endif
+}
+
+void FileCache::watch_tree(const std::string& directory) {
+#ifdef __linux__
+    const auto watch = [this](const std::string& relative) {
+        const int wd = inotify_add_watch(inotify_fd_, (root_ + relative).c_str(), WATCH_MASK);
+        if (wd < 0) {
+            // Most likely fs.inotify.max_user_watches. Entries already cached
+            // under unwatched directories get checked from now on too.
+            if (watching_.exchange(false, std::memory_order_relaxed)) {
+                LOG_WARNING("Cannot watch " + root_ + relative + ", checking cached files' mtime instead: " +
+                            std::string(std::strerror(errno)));
+            }
+            return false;
+        }
+        watches_[wd] = relative;
+        return true;
+    };
+    
+    if (watch(directory)) {
+        std::error_code error;
+        std::filesystem::recursive_directory_iterator it(root_ + directory, error);
+        for (; !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+            if (it->is_directory(error) && !it->is_symlink(error)) {
+                const std::string relative = directory + "/" +
+                    it->path().lexically_relative(root_ + directory).generic_string();
+                if (!watch(relative)) {
+                    break;
+                }
+            }
+        }
+    }
+    
+    // Files under a directory that appeared since the last event may have
+    // been cached before it was watched.
+    invalidate_tree(directory);
+#else
+    static_cast<void>(directory);
+#endif
+}
+
+void FileCache::watch_events() {
+#ifdef __linux__
+    alignas(inotify_event) char buffer[16 * 1024];
+    pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+    
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("File cache watcher failed: " + std::string(std::strerror(errno)));
+            watching_.store(false, std::memory_order_relaxed);
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+        
+        ssize_t length;
+        while ((length = read(inotify_fd_, buffer, sizeof(buffer))) > 0) {
+            for (const char* p = buffer; p < buffer + length;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(p);
+                p += sizeof(inotify_event) + event->len;
+                
+                if (event->mask & IN_Q_OVERFLOW) {
+                    invalidate_tree("");
+                    continue;
+                }
+                const auto watch = watches_.find(event->wd);
+                if (watch == watches_.end()) {
+                    continue;
+                }
+                if (event->mask & IN_IGNORED) {
+                    watches_.erase(watch);
+                    continue;
+                }
+                if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    // Subdirectories are taken care of through their parent's
+                    // events, where a moved one is watched under its new path
+                    // (inotify keeps its watch descriptor).
+                    if (watch->second.empty()) {
+                        invalidate_tree("");
+                    }
+                    continue;
+                }
+                if (event->len == 0) {
+                    continue;
+                }
+                
+                const std::string path = watch->second + "/" + event->name;
+                if (!(event->mask & IN_ISDIR)) {
+                    invalidate(path);
+                } else if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    watch_tree(path);
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    invalidate_tree(path);
+                }
+            }
+        }
+    }
+#endif
+}
+
+} // namespace https_server
@@ -0,0 +1,101 @@
+#ifndef HTTPS_SERVER_FILE_CACHE_HPP
+#define HTTPS_SERVER_FILE_CACHE_HPP
+
+#include "http/validators.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace https_server {
+
+// Contents of the files under a directory, kept in memory up to a byte
+// budget and shared by every response that sends them. Entries are dropped
+// as inotify reports changes to their files, so a hit is a hash lookup
+// under a shared lock and makes no system calls. Without inotify (another
+// platform, or the watch limit reached) an entry is checked against the
+// file's mtime and size once it is REVALIDATE_INTERVAL old instead.
+class FileCache {
+public:
+    struct File {
+        std::string content;
+        // Tells reloads of the same path apart, for caches of what is
+        // derived from the contents.
+        std::uint64_t version;
+        std::filesystem::file_time_type modified;
+        // Computed with the contents, so a conditional request that matches
+        // needs neither them nor the file.
+        http::Validators validators;
+    };
+    
+    static constexpr std::chrono::seconds REVALIDATE_INTERVAL{1};
+    
+    // Files larger than 'max_file_size' are left for the caller to stream
+    // from disk. A 'capacity' of 0 disables caching.
+    FileCache(std::string root, size_t capacity, size_t max_file_size);
+    ~FileCache();
+    
+    FileCache(const FileCache&) = delete;
+    FileCache& operator=(const FileCache&) = delete;
+    
+    // 'path' is relative to the root, normalized and beginning with '/'.
+    // Returns nullptr when the file cannot be read, is too large to cache,
+    // or caching is disabled.
+    std::shared_ptr<const File> get(const std::string& path);
+    
+    // Whether entries are invalidated through inotify rather than checked.
+    bool watching() const noexcept { return watching_.load(std::memory_order_relaxed); }
+    size_t size() const;
+    size_t bytes() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const File> file;
+        // Set on each hit and cleared as eviction passes over the entry, so
+        // eviction takes entries that have not been used since its last pass.
+        std::atomic<bool> referenced{true};
+        // steady_clock ticks of the last mtime check.
+        std::atomic<std::int64_t> validated{0};
+    };
+    
+    std::shared_ptr<const File> load(const std::string& path);
+    bool revalidate(const std::string& path, const File& file) const;
+    void insert(const std::string& path, const std::shared_ptr<const File>& file);
+    void evict(size_t needed);
+    void invalidate(const std::string& path);
+    // Drops the entries under 'directory' ("" for all of them).
+    void invalidate_tree(const std::string& directory);
+    
+    void start_watching();
+    void watch_tree(const std::string& directory);
+    void watch_events();
+    
+    const std::string root_;
+    const size_t capacity_;
+    const size_t max_file_size_;
+    
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    size_t bytes_;
+    // Bumped by every invalidation. A load that saw it change while it was
+    // reading may have read a file that was being replaced, and is not kept.
+    std::atomic<std::uint64_t> epoch_;
+    std::atomic<std::uint64_t> next_version_;
+    std::atomic<bool> watching_;
+    
+    // inotify descriptor and watched directories, relative to the root,
+    // by watch descriptor. Only the watcher thread uses the map.
+    int inotify_fd_;
+    int stop_fd_;
+    std::unordered_map<int, std::string> watches_;
+    std::thread watcher_;
+};
+
+} // namespace https_server
+
+#endif // HTTPS_SERVER_FILE_CACHE_HPP
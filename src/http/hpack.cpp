@@ -0,0 +1,551 @@
+#include "http/hpack.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+namespace https_server::http2::hpack {
+
+namespace {
+
+struct StaticEntry {
+    std::string_view name;
+    std::string_view value;
+};
+
+// RFC 7541 Appendix A. Index 1 is STATIC_TABLE[0]; entries with the same
+// name are adjacent.
+constexpr StaticEntry STATIC_TABLE[] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+constexpr size_t STATIC_COUNT = sizeof(STATIC_TABLE) / sizeof(STATIC_TABLE[0]);
+
+constexpr size_t ENTRY_OVERHEAD = 32;
+
+// Code lengths of RFC 7541 Appendix B by symbol, 256 being EOS. The code is
+// canonical: codes of one length are consecutive in symbol order and follow
+// on from the last code of the length before, so the lengths define it.
+constexpr std::uint8_t HUFFMAN_LENGTHS[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+constexpr unsigned MAX_CODE_LENGTH = 30;
+constexpr unsigned SHORT_CODE_LENGTH = 8;
+
+struct HuffmanTables {
+    std::uint32_t codes[257];
+    // Symbols in code order, and for each length its first code and where
+    // its symbols start.
+    std::uint16_t symbols[257];
+    std::uint32_t first_code[MAX_CODE_LENGTH + 1];
+    std::uint16_t first_symbol[MAX_CODE_LENGTH + 1];
+    std::uint16_t count[MAX_CODE_LENGTH + 1];
+    // Indexed by the next 8 bits: the symbol whose code they start with,
+    // when that code is 8 bits or shorter (length 0 otherwise). These are
+    // the letters, digits and common punctuation, so most symbols take one
+    // lookup.
+    struct Short {
+        std::uint8_t symbol;
+        std::uint8_t length;
+    } short_codes[1 << SHORT_CODE_LENGTH];
+};
+
+HuffmanTables build_huffman() {
+    HuffmanTables tables{};
+    std::uint16_t next = 0;
+    std::uint32_t code = 0;
+    for (unsigned length = 1; length <= MAX_CODE_LENGTH; ++length) {
+        tables.first_code[length] = code;
+        tables.first_symbol[length] = next;
+        for (std::uint16_t symbol = 0; symbol < 257; ++symbol) {
+            if (HUFFMAN_LENGTHS[symbol] != length) {
+                continue;
+            }
+            tables.symbols[next++] = symbol;
+            tables.codes[symbol] = code++;
+            ++tables.count[length];
+            
+            if (length <= SHORT_CODE_LENGTH) {
+                const unsigned spare = SHORT_CODE_LENGTH - length;
+                const std::uint32_t base = tables.codes[symbol] << spare;
+                for (std::uint32_t suffix = 0; suffix < (1u << spare); ++suffix) {
+                    tables.short_codes[base | suffix] = {static_cast<std::uint8_t>(symbol),
+                                                         static_cast<std::uint8_t>(length)};
+                }
+            }
+        }
+        code <<= 1;
+    }
+    return tables;
+}
+
+const HuffmanTables& huffman() {
+    static const HuffmanTables tables = build_huffman();
+    return tables;
+}
+
+void encode_integer(std::uint64_t value, unsigned prefix_bits, std::uint8_t flags, std::string& out) {
+    const std::uint64_t max = (1u << prefix_bits) - 1;
+    if (value < max) {
+        out.push_back(static_cast<char>(flags | value));
+        return;
+    }
+    
+    out.push_back(static_cast<char>(flags | max));
+    value -= max;
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(0x80 | (value & 0x7f)));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+// Nothing HPACK encodes comes near 2^32, so longer integers are rejected
+// rather than risking overflow.
+bool decode_integer(const unsigned char*& p, const unsigned char* end, unsigned prefix_bits, std::uint64_t& value) {
+    const std::uint64_t max = (1u << prefix_bits) - 1;
+    value = *p++ & max;
+    if (value < max) {
+        return true;
+    }
+    
+    for (unsigned shift = 0; p != end && shift <= 28; shift += 7) {
+        const unsigned char byte = *p++;
+        value += static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void encode_string(std::string_view text, std::string& out) {
+    const size_t huffman_size = huffman_encoded_size(text);
+    if (huffman_size < text.size()) {
+        encode_integer(huffman_size, 7, 0x80, out);
+        huffman_encode(text, out);
+    } else {
+        encode_integer(text.size(), 7, 0x00, out);
+        out.append(text);
+    }
+}
+
+bool decode_string(const unsigned char*& p, const unsigned char* end, std::string& out) {
+    if (p == end) {
+        return false;
+    }
+    
+    const bool huffman_coded = *p & 0x80;
+    std::uint64_t length;
+    if (!decode_integer(p, end, 7, length) || length > static_cast<std::uint64_t>(end - p)) {
+        return false;
+    }
+    
+    const std::string_view raw(reinterpret_cast<const char*>(p), static_cast<size_t>(length));
+    p += length;
+    if (huffman_coded) {
+        return huffman_decode(raw, out);
+    }
+    out.append(raw);
+    return true;
+}
+
+// The first static index with 'name', or 0.
+size_t static_name_index(std::string_view name) {
+    static const std::unordered_map<std::string_view, std::uint8_t> names = [] {
+        std::unordered_map<std::string_view, std::uint8_t> map;
+        for (size_t i = 0; i < STATIC_COUNT; ++i) {
+            map.emplace(STATIC_TABLE[i].name, static_cast<std::uint8_t>(i + 1));
+        }
+        return map;
+    }();
+    
+    const auto it = names.find(name);
+    return it == names.end() ? 0 : it->second;
+}
+
+} // namespace
+
+size_t huffman_encoded_size(std::string_view text) noexcept {
+    size_t bits = 0;
+    for (const char c : text) {
+        bits += HUFFMAN_LENGTHS[static_cast<unsigned char>(c)];
+    }
+    return (bits + 7) / 8;
+}
+
+void huffman_encode(std::string_view text, std::string& out) {
+    const HuffmanTables& tables = huffman();
+    std::uint64_t bits = 0;
+    unsigned count = 0;
+    for (const char c : text) {
+        const auto symbol = static_cast<unsigned char>(c);
+        bits = (bits << HUFFMAN_LENGTHS[symbol]) | tables.codes[symbol];
+        count += HUFFMAN_LENGTHS[symbol];
+        while (count >= 8) {
+            count -= 8;
+            out.push_back(static_cast<char>(bits >> count));
+        }
+    }
+    
+    // Padded with the most significant bits of EOS, which are all ones.
+    if (count > 0) {
+        out.push_back(static_cast<char>((bits << (8 - count)) | (0xffu >> count)));
+    }
+}
+
+bool huffman_decode(std::string_view encoded, std::string& out) {
+    const HuffmanTables& tables = huffman();
+    const auto* p = reinterpret_cast<const unsigned char*>(encoded.data());
+    const auto* const end = p + encoded.size();
+    
+    // Unread bits, most significant first.
+    std::uint64_t bits = 0;
+    unsigned count = 0;
+    while (true) {
+        while (count <= 56 && p != end) {
+            bits |= static_cast<std::uint64_t>(*p++) << (56 - count);
+            count += 8;
+        }
+        if (count == 0) {
+            return true;
+        }
+        
+        const HuffmanTables::Short entry = tables.short_codes[bits >> (64 - SHORT_CODE_LENGTH)];
+        unsigned length = entry.length;
+        unsigned symbol = entry.symbol;
+        if (length == 0) {
+            for (length = SHORT_CODE_LENGTH + 1; length <= MAX_CODE_LENGTH; ++length) {
+                const auto code = static_cast<std::uint32_t>(bits >> (64 - length));
+                if (code - tables.first_code[length] < tables.count[length]) {
+                    symbol = tables.symbols[tables.first_symbol[length] + code - tables.first_code[length]];
+                    break;
+                }
+            }
+        }
+        
+        if (length > count) {
+            // Only the end of the input is left: it must be padding.
+            return count <= 7 && (bits >> (64 - count)) == (1u << count) - 1;
+        }
+        if (length > MAX_CODE_LENGTH || symbol == 256) {
+            return false;
+        }
+        
+        out.push_back(static_cast<char>(symbol));
+        bits <<= length;
+        count -= length;
+    }
+}
+
+void HeaderList::clear() noexcept {
+    text_.clear();
+    fields_.clear();
+}
+
+std::string_view HeaderList::name(size_t index) const noexcept {
+    const Field& field = fields_[index];
+    return std::string_view(text_.data() + field.offset, field.name_size);
+}
+
+std::string_view HeaderList::value(size_t index) const noexcept {
+    const Field& field = fields_[index];
+    return std::string_view(text_.data() + field.offset + field.name_size, field.value_size);
+}
+
+DynamicTable::DynamicTable(size_t max_size)
+    : oldest_(0),
+      count_(0),
+      size_(0),
+      max_size_(max_size)
+{
+}
+
+void DynamicTable::set_max_size(size_t max_size) {
+    max_size_ = max_size;
+    while (size_ > max_size_) {
+        evict_oldest();
+    }
+}
+
+void DynamicTable::insert(std::string_view name, std::string_view value) {
+    const size_t entry_size = name.size() + value.size() + ENTRY_OVERHEAD;
+    while (count_ > 0 && size_ + entry_size > max_size_) {
+        evict_oldest();
+    }
+    // An entry larger than the whole table just empties it.
+    if (entry_size > max_size_) {
+        return;
+    }
+    
+    if (count_ == ring_.size()) {
+        std::vector<Entry> grown(std::max<size_t>(16, ring_.size() * 2));
+        for (size_t i = 0; i < count_; ++i) {
+            grown[i] = std::move(ring_[(oldest_ + i) % ring_.size()]);
+        }
+        ring_ = std::move(grown);
+        oldest_ = 0;
+    }
+    
+    Entry& slot = ring_[(oldest_ + count_) % ring_.size()];
+    slot.name.assign(name);
+    slot.value.assign(value);
+    ++count_;
+    size_ += entry_size;
+}
+
+void DynamicTable::evict_oldest() noexcept {
+    const Entry& entry = ring_[oldest_];
+    size_ -= entry.name.size() + entry.value.size() + ENTRY_OVERHEAD;
+    oldest_ = (oldest_ + 1) % ring_.size();
+    --count_;
+}
+
+Decoder::Decoder(size_t max_table_size, size_t max_list_size)
+    : table_(max_table_size),
+      max_table_size_(max_table_size),
+      max_list_size_(max_list_size)
+{
+}
+
+Decoder::Status Decoder::decode(std::string_view block, HeaderList& headers) {
+    headers.clear();
+    std::string& text = headers.text_;
+    const auto* p = reinterpret_cast<const unsigned char*>(block.data());
+    const auto* const end = p + block.size();
+    
+    // Appends the name, and optionally the value, of a table entry.
+    const auto append_entry = [this, &text](std::uint64_t index, bool with_value, size_t& name_size) {
+        std::string_view name;
+        std::string_view value;
+        if (index >= 1 && index <= STATIC_COUNT) {
+            name = STATIC_TABLE[index - 1].name;
+            value = STATIC_TABLE[index - 1].value;
+        } else if (index > STATIC_COUNT && index - STATIC_COUNT - 1 < table_.count()) {
+            name = table_.name(static_cast<size_t>(index - STATIC_COUNT - 1));
+            value = table_.value(static_cast<size_t>(index - STATIC_COUNT - 1));
+        } else {
+            return false;
+        }
+        text.append(name);
+        name_size = name.size();
+        if (with_value) {
+            text.append(value);
+        }
+        return true;
+    };
+    
+    size_t list_size = 0;
+    bool seen_field = false;
+    while (p != end) {
+        const unsigned char first = *p;
+        std::uint64_t index;
+        
+        // Table size updates may only open the block.
+        if ((first & 0xe0) == 0x20) {
+            if (seen_field || !decode_integer(p, end, 5, index) || index > max_table_size_) {
+                return Status::Error;
+            }
+            table_.set_max_size(static_cast<size_t>(index));
+            continue;
+        }
+        seen_field = true;
+        
+        const bool indexed = first & 0x80;
+        const bool incremental = (first & 0xc0) == 0x40;
+        if (!decode_integer(p, end, indexed ? 7 : incremental ? 6 : 4, index)) {
+            return Status::Error;
+        }
+        
+        const size_t mark = text.size();
+        size_t name_size = 0;
+        if (indexed) {
+            if (!append_entry(index, true, name_size)) {
+                return Status::Error;
+            }
+        } else {
+            if (index != 0 ? !append_entry(index, false, name_size) : !decode_string(p, end, text)) {
+                return Status::Error;
+            }
+            if (index == 0) {
+                name_size = text.size() - mark;
+            }
+            if (!decode_string(p, end, text)) {
+                return Status::Error;
+            }
+        }
+        
+        const size_t value_size = text.size() - mark - name_size;
+        if (incremental) {
+            table_.insert(std::string_view(text.data() + mark, name_size),
+                          std::string_view(text.data() + mark + name_size, value_size));
+        }
+        
+        list_size += name_size + value_size + ENTRY_OVERHEAD;
+        if (list_size > max_list_size_) {
+            text.resize(mark);
+            continue;
+        }
+        headers.fields_.push_back(HeaderList::Field{static_cast<std::uint32_t>(mark),
+                                                    static_cast<std::uint32_t>(name_size),
+                                                    static_cast<std::uint32_t>(value_size)});
+    }
+    
+    return list_size > max_list_size_ ? Status::TooLarge : Status::Ok;
+}
+
+Encoder::Encoder(size_t max_table_size)
+    : table_(max_table_size),
+      max_table_size_(max_table_size),
+      smallest_update_(max_table_size),
+      update_pending_(false)
+{
+}
+
+void Encoder::set_max_table_size(size_t max_size) {
+    // A larger table than the default is allowed but not used.
+    max_size = std::min(max_size, max_table_size_);
+    if (max_size == table_.max_size()) {
+        return;
+    }
+    
+    smallest_update_ = std::min(smallest_update_, max_size);
+    table_.set_max_size(max_size);
+    update_pending_ = true;
+}
+
+void Encoder::begin_block(std::string& out) {
+    if (!update_pending_) {
+        return;
+    }
+    
+    // After several changes the decoder must see the smallest of them too.
+    if (smallest_update_ < table_.max_size()) {
+        encode_integer(smallest_update_, 5, 0x20, out);
+    }
+    encode_integer(table_.max_size(), 5, 0x20, out);
+    smallest_update_ = table_.max_size();
+    update_pending_ = false;
+}
+
+void Encoder::encode(std::string_view name, std::string_view value, Indexing indexing, std::string& out) {
+    size_t name_index = static_name_index(name);
+    if (name_index != 0) {
+        for (size_t i = name_index; i <= STATIC_COUNT && STATIC_TABLE[i - 1].name == name; ++i) {
+            if (STATIC_TABLE[i - 1].value == value) {
+                encode_integer(i, 7, 0x80, out);
+                return;
+            }
+        }
+    }
+    
+    if (indexing != Indexing::Never) {
+        for (size_t i = 0; i < table_.count(); ++i) {
+            if (table_.name(i) != name) {
+                continue;
+            }
+            if (table_.value(i) == value) {
+                encode_integer(STATIC_COUNT + 1 + i, 7, 0x80, out);
+                return;
+            }
+            if (name_index == 0) {
+                name_index = STATIC_COUNT + 1 + i;
+            }
+        }
+    }
+    
+    switch (indexing) {
+        case Indexing::Incremental:
+            encode_integer(name_index, 6, 0x40, out);
+            break;
+        case Indexing::None:
+            encode_integer(name_index, 4, 0x00, out);
+            break;
+        case Indexing::Never:
+            encode_integer(name_index, 4, 0x10, out);
+            break;
+    }
+    if (name_index == 0) {
+        encode_string(name, out);
+    }
+    encode_string(value, out);
+    
+    if (indexing == Indexing::Incremental) {
+        table_.insert(name, value);
+    }
+}
+
+} // namespace https_server::http2::hpack
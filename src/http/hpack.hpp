@@ -0,0 +1,136 @@
+#ifndef HTTPS_SERVER_HPACK_HPP
+#define HTTPS_SERVER_HPACK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace https_server::http2::hpack {
+
+// The static Huffman code of RFC 7541 Appendix B.
+size_t huffman_encoded_size(std::string_view text) noexcept;
+void huffman_encode(std::string_view text, std::string& out);
+// Appends the decoded text to 'out'. Returns false on the EOS symbol and on
+// padding that is longer than 7 bits or not all ones.
+bool huffman_decode(std::string_view encoded, std::string& out);
+
+// A decoded header block. Names and values are stored back to back in one
+// string, so a block costs the same few allocations however many fields it
+// has, and the buffers are reused by the next block decoded into it.
+class HeaderList {
+public:
+    void clear() noexcept;
+    
+    std::string_view name(size_t index) const noexcept;
+    std::string_view value(size_t index) const noexcept;
+    size_t size() const noexcept { return fields_.size(); }
+    bool empty() const noexcept { return fields_.empty(); }
+
+private:
+    friend class Decoder;
+    
+    struct Field {
+        std::uint32_t offset;
+        std::uint32_t name_size;
+        std::uint32_t value_size;
+    };
+    
+    std::string text_;
+    std::vector<Field> fields_;
+};
+
+// Entries are counted at name + value + 32 bytes, newest first. Evicted
+// slots are reused in place so a steady stream of insertions stops
+// allocating once the strings have grown to size.
+class DynamicTable {
+public:
+    explicit DynamicTable(size_t max_size);
+    
+    // Evicts down to the new limit.
+    void set_max_size(size_t max_size);
+    // 'name' and 'value' must not view an entry of this table: inserting
+    // may evict it first.
+    void insert(std::string_view name, std::string_view value);
+    
+    std::string_view name(size_t index) const noexcept { return at(index).name; }
+    std::string_view value(size_t index) const noexcept { return at(index).value; }
+    size_t count() const noexcept { return count_; }
+    size_t max_size() const noexcept { return max_size_; }
+
+private:
+    struct Entry {
+        std::string name;
+        std::string value;
+    };
+    
+    const Entry& at(size_t index) const noexcept {
+        return ring_[(oldest_ + count_ - 1 - index) % ring_.size()];
+    }
+    void evict_oldest() noexcept;
+    
+    std::vector<Entry> ring_;
+    size_t oldest_;
+    size_t count_;
+    size_t size_;
+    size_t max_size_;
+};
+
+class Decoder {
+public:
+    enum class Status {
+        Ok,
+        // The block decodes to more than the list limit. Its fields are
+        // dropped, but the dynamic table is kept in step with the peer.
+        TooLarge,
+        // A compression error; the connection cannot continue.
+        Error
+    };
+    
+    // 'max_table_size' is the SETTINGS_HEADER_TABLE_SIZE advertised to the
+    // peer, 'max_list_size' bounds a block at name + value + 32 per field.
+    Decoder(size_t max_table_size, size_t max_list_size);
+    
+    // Decodes one complete header block into 'headers'.
+    Status decode(std::string_view block, HeaderList& headers);
+
+private:
+    DynamicTable table_;
+    size_t max_table_size_;
+    size_t max_list_size_;
+};
+
+class Encoder {
+public:
+    enum class Indexing {
+        // Added to the dynamic table, so it is one byte the next time.
+        Incremental,
+        // For values that change from one response to the next.
+        None,
+        // Sensitive values that intermediaries must not index either.
+        Never
+    };
+    
+    explicit Encoder(size_t max_table_size = 4096);
+    
+    // The peer's SETTINGS_HEADER_TABLE_SIZE. The change is signalled at
+    // the start of the next block.
+    void set_max_table_size(size_t max_size);
+    
+    // Starts a header block in 'out'.
+    void begin_block(std::string& out);
+    // Appends one field; 'name' must be lowercase. A field that is in the
+    // static table, or was indexed earlier, takes a single index.
+    void encode(std::string_view name, std::string_view value, Indexing indexing, std::string& out);
+
+private:
+    DynamicTable table_;
+    size_t max_table_size_;
+    size_t smallest_update_;
+    bool update_pending_;
+};
+
+} // namespace https_server::http2::hpack
+
+#endif // HTTPS_SERVER_HPACK_HPP
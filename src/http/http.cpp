@@ -1,37 +1,295 @@
 #include "http/http.hpp"
 #include "core/config.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
 
 namespace https_server::http {
 
-void HttpResponse::apply_security_headers() {
-    if (!security_config) return;
+static bool iequals(std::string_view a, std::string_view b) noexcept {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void HttpHeaders::add(std::string_view name, std::string_view value) {
+    if (count_ < INLINE_CAPACITY) {
+        inline_[count_++] = HttpHeader{name, value};
+        return;
+    }
     
-    if (security_config->enable_hsts) {
-        std::string hsts_value = "max-age=" + security_config->hsts_max_age;
-        if (security_config->hsts_include_subdomains) {
-            hsts_value += "; includeSubDomains";
+    if (overflow_.empty()) {
+        overflow_.reserve(INLINE_CAPACITY * 2);
+        overflow_.assign(inline_.begin(), inline_.end());
+    }
+    overflow_.push_back(HttpHeader{name, value});
+    ++count_;
+}
+
+void HttpHeaders::clear() noexcept {
+    overflow_.clear();
+    count_ = 0;
+}
+
+const std::string_view* HttpHeaders::find(std::string_view name) const noexcept {
+    for (const HttpHeader& header : *this) {
+        if (iequals(header.name, name)) {
+            return &header.value;
         }
-        if (security_config->hsts_preload) {
-            hsts_value += "; preload";
+    }
+    return nullptr;
+}
+
+const std::string_view* HttpRequest::find_header(std::string_view name) const noexcept {
+    return headers.find(name);
+}
+
+bool HttpRequest::keep_alive() const noexcept {
+    const std::string_view* connection = find_header("Connection");
+    if (connection) {
+        if (iequals(*connection, "close")) return false;
+        if (iequals(*connection, "keep-alive")) return true;
+    }
+    return http_version != "HTTP/1.0";
+}
+
+OwnedHttpRequest::OwnedHttpRequest(const HttpRequest& request) {
+    assign(request);
+}
+
+OwnedHttpRequest::OwnedHttpRequest(const OwnedHttpRequest& other) {
+    assign(other.request_);
+}
+
+OwnedHttpRequest& OwnedHttpRequest::operator=(const OwnedHttpRequest& other) {
+    if (this != &other) {
+        assign(other.request_);
+    }
+    return *this;
+}
+
+void OwnedHttpRequest::assign(const HttpRequest& request) {
+    size_t total = request.method.size() + request.uri.size() + request.http_version.size() + request.body.size();
+    for (const HttpHeader& header : request.headers) {
+        total += header.name.size() + header.value.size();
+    }
+    
+    std::string storage;
+    storage.reserve(total);
+    
+    // Offsets first: the views can only be taken once storage stops growing.
+    struct Span { size_t offset; size_t size; };
+    const auto append = [&storage](std::string_view value) {
+        const Span span{storage.size(), value.size()};
+        storage.append(value);
+        return span;
+    };
+    
+    const Span method = append(request.method);
+    const Span uri = append(request.uri);
+    const Span version = append(request.http_version);
+    const Span body = append(request.body);
+    std::vector<std::pair<Span, Span>> headers;
+    headers.reserve(request.headers.size());
+    for (const HttpHeader& header : request.headers) {
+        const Span name = append(header.name);
+        headers.emplace_back(name, append(header.value));
+    }
+    
+    storage_ = std::move(storage);
+    const auto view = [this](Span span) { return std::string_view(storage_).substr(span.offset, span.size); };
+    
+    request_ = HttpRequest{};
+    request_.method = view(method);
+    request_.uri = view(uri);
+    request_.http_version = view(version);
+    request_.body = view(body);
+    request_.content_length = request.content_length;
+    request_.chunked = request.chunked;
+    for (const auto& [name, value] : headers) {
+        request_.headers.add(view(name), view(value));
+    }
+    // Parameter values are slices of the URI; their names belong to the
+    // router and outlive any request.
+    for (const PathParam& param : request.params) {
+        const size_t offset = static_cast<size_t>(param.value.data() - request.uri.data());
+        request_.params.push_back(param.name, request_.uri.substr(offset, param.value.size()));
+    }
+}
+
+bool assign_request(const http_accelerated::RequestParser& parser, std::string_view raw, HttpRequest& request) {
+    const char* data = raw.data();
+    request.method = parser.method().in(data);
+    request.uri = parser.uri().in(data);
+    request.http_version = parser.version().in(data);
+    request.headers.clear();
+    request.params.clear();
+    request.body = {};
+    request.content_length = 0;
+    request.chunked = false;
+    
+    bool has_content_length = false;
+    for (const auto* header = parser.headers_begin(); header != parser.headers_end(); ++header) {
+        const std::string_view name = header->name.in(data);
+        const std::string_view value = header->value.in(data);
+        request.headers.add(name, value);
+        
+        if (iequals(name, "Content-Length")) {
+            size_t length = 0;
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), length);
+            if (value.empty() || error != std::errc() || end != value.data() + value.size()) {
+                return false;
+            }
+            // Differing duplicates are a request smuggling vector (RFC 9112 6.3).
+            if (has_content_length && length != request.content_length) {
+                return false;
+            }
+            has_content_length = true;
+            request.content_length = length;
+        } else if (iequals(name, "Transfer-Encoding")) {
+            if (!iequals(value, "chunked")) {
+                return false;
+            }
+            request.chunked = true;
         }
-        headers["Strict-Transport-Security"] = hsts_value;
     }
     
-    if (security_config->enable_csp) {
-        headers["Content-Security-Policy"] = security_config->csp_policy;
+    if (request.chunked) {
+        return !has_content_length;
+    }
+    request.body = raw.substr(parser.header_length(), request.content_length);
+    return true;
+}
+
+void parse_request(std::string_view raw, HttpRequest& request) {
+    http_accelerated::RequestParser parser;
+    switch (parser.parse(raw.data(), raw.size())) {
+        case http_accelerated::ParseStatus::Incomplete:
+            throw std::runtime_error("Incomplete request headers");
+        case http_accelerated::ParseStatus::Error:
+            throw std::runtime_error(std::string("Malformed request: ") + http_accelerated::to_string(parser.error()));
+        case http_accelerated::ParseStatus::Complete:
+            break;
     }
     
-    if (security_config->enable_xcto) {
-        headers["X-Content-Type-Options"] = "nosniff";
+    if (!assign_request(parser, raw, request)) {
+        throw std::runtime_error("Invalid Content-Length");
     }
+}
+
+std::string_view date_header() {
+    static constexpr char DAYS[7][4] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    static constexpr char MONTHS[12][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                           "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    thread_local std::time_t cached_second = -1;
+    thread_local char line[48];
+    thread_local size_t line_length = 0;
     
-    if (security_config->enable_xfo) {
-        headers["X-Frame-Options"] = "DENY";
+    const std::time_t now = std::time(nullptr);
+    if (now != cached_second) {
+        std::tm utc{};
+#ifdef _WIN32
+        gmtime_s(&utc, &now);
+#else
+        gmtime_r(&now, &utc);
+#endif
+        const int written = std::snprintf(line, sizeof(line), "Date: %s, %02d %s %04d %02d:%02d:%02d GMT\r\n",
+                                          DAYS[utc.tm_wday], utc.tm_mday, MONTHS[utc.tm_mon], utc.tm_year + 1900,
+                                          utc.tm_hour, utc.tm_min, utc.tm_sec);
+        line_length = written > 0 ? static_cast<size_t>(written) : 0;
+        cached_second = now;
     }
+    return std::string_view(line, line_length);
+}
+
+void HttpResponse::write_head(Buffer& out) const {
+    const auto append = [&out](std::string_view text) {
+        out.append(text.data(), text.size());
+    };
+    const auto append_number = [&out](auto value) {
+        char digits[24];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, static_cast<size_t>(result.ptr - digits));
+    };
     
-    headers["X-XSS-Protection"] = "1; mode=block";
-    headers["Referrer-Policy"] = "strict-origin-when-cross-origin";
-    headers["Permissions-Policy"] = "geolocation=(), microphone=(), camera=()";
+    append("HTTP/1.1 ");
+    append_number(status_code);
+    append(" ");
+    append(status_text);
+    append("\r\n");
+    
+    if (chunked()) {
+        append("Transfer-Encoding: chunked\r\n");
+    } else if (!bodiless() && headers.find("Content-Length") == headers.end()) {
+        append("Content-Length: ");
+        append_number(body_size());
+        append("\r\n");
+    }
+    if (!bodiless() && headers.find("Content-Type") == headers.end()) {
+        append("Content-Type: text/html; charset=utf-8\r\n");
+    }
+    if (headers.find("Connection") == headers.end()) {
+        append("Connection: close\r\n");
+    }
+    if (headers.find("Date") == headers.end()) {
+        append(date_header());
+    }
+    if (security_config) {
+        append(security_config->header_block);
+    }
+    
+    for (const auto& [key, value] : headers) {
+        append(key);
+        append(": ");
+        append(value);
+        append("\r\n");
+    }
+    append("\r\n");
+}
+
+bool HttpResponse::closes_connection() const noexcept {
+    const auto connection = headers.find("Connection");
+    return connection != headers.end() && iequals(connection->second, "close");
+}
+
+std::string_view HttpResponse::payload() const noexcept {
+    if (const SharedBuffer* shared = std::get_if<SharedBuffer>(&body_source)) {
+        return *shared ? std::string_view(**shared) : std::string_view();
+    }
+    if (file_region()) {
+        return std::string_view();
+    }
+    return std::string_view(body);
+}
+
+std::uint64_t HttpResponse::body_size() const noexcept {
+    const FileRegion* region = file_region();
+    return region ? region->length : payload().size();
+}
+
+void HttpResponse::buffer_body() {
+    if (!producer) {
+        return;
+    }
+    
+    bool done = false;
+    while (!done) {
+        const size_t size = body.size();
+        body.resize(size + 16384);
+        const size_t produced = producer->produce(body.data() + size, 16384, done);
+        body.resize(size + std::min<size_t>(produced, 16384));
+        if (produced == 0 && !done) {
+            throw std::runtime_error("Response body producer stalled");
+        }
+    }
+    producer.reset();
 }
 
-} // namespace https_server::http
\ No newline at end of file
+} // namespace https_server::http
@@ -1,59 +1,213 @@
 #ifndef HTTPS_SERVER_HTTP_HPP
 #define HTTPS_SERVER_HTTP_HPP
 
+#include "http/body.hpp"
+#include "utils/arena.hpp"
+#include "utils/buffer.hpp"
+#include "utils/http_accelerated.hpp"
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
-#include <sstream>
 
 namespace https_server {
     struct SecurityConfig;
 
 namespace http {
 
-struct HttpRequest {
-    std::string method;
-    std::string uri;
-    std::string http_version;
-    std::map<std::string, std::string> headers;
-    std::string body;
+struct HttpHeader {
+    std::string_view name;
+    std::string_view value;
 };
 
-struct HttpResponse {
-    int status_code = 200;
-    std::string status_text = "OK";
-    std::map<std::string, std::string> headers;
-    std::string body;
-    const SecurityConfig* security_config = nullptr;
+// Flat header list in arrival order. The first INLINE_CAPACITY headers are
+// stored inline; only unusually large requests spill to the heap.
+class HttpHeaders {
+public:
+    static constexpr size_t INLINE_CAPACITY = 24;
+    
+    void add(std::string_view name, std::string_view value);
+    void clear() noexcept;
+    
+    // Case-insensitive; the first match wins.
+    const std::string_view* find(std::string_view name) const noexcept;
+    
+    const HttpHeader* begin() const noexcept { return overflow_.empty() ? inline_.data() : overflow_.data(); }
+    const HttpHeader* end() const noexcept { return begin() + count_; }
+    size_t size() const noexcept { return count_; }
+    bool empty() const noexcept { return count_ == 0; }
 
-    void apply_security_headers();
+private:
+    std::array<HttpHeader, INLINE_CAPACITY> inline_{};
+    std::vector<HttpHeader> overflow_;
+    size_t count_ = 0;
+};
 
-    std::string to_string() const {
-        std::stringstream ss;
-        ss << "HTTP/1.1 " << status_code << " " << status_text << "\r\n";
-        
-        const_cast<HttpResponse*>(this)->apply_security_headers();
-        
-        if (headers.find("Content-Length") == headers.end()) {
-             ss << "Content-Length: " << body.length() << "\r\n";
-        }
-        if (headers.find("Content-Type") == headers.end()) {
-             ss << "Content-Type: text/html; charset=utf-8\r\n";
-        }
-        if (headers.find("Connection") == headers.end()) {
-             ss << "Connection: close\r\n";
-        }
+struct PathParam {
+    std::string_view name;
+    std::string_view value;
+};
 
-        for (const auto& [key, value] : headers) {
-            ss << key << ": " << value << "\r\n";
+// Captures of the matched route's ':name' and '*name' segments, in pattern
+// order. Names view the router's patterns, values the request URI.
+class PathParams {
+public:
+    static constexpr size_t CAPACITY = 8;
+    
+    void push_back(std::string_view name, std::string_view value) noexcept {
+        params_[count_++] = PathParam{name, value};
+    }
+    void pop_back() noexcept { --count_; }
+    void clear() noexcept { count_ = 0; }
+    
+    const std::string_view* find(std::string_view name) const noexcept {
+        for (const PathParam& param : *this) {
+            if (param.name == name) {
+                return &param.value;
+            }
         }
+        return nullptr;
+    }
+    
+    const PathParam* begin() const noexcept { return params_.data(); }
+    const PathParam* end() const noexcept { return params_.data() + count_; }
+    size_t size() const noexcept { return count_; }
+    bool empty() const noexcept { return count_ == 0; }
+
+private:
+    std::array<PathParam, CAPACITY> params_{};
+    size_t count_ = 0;
+};
+
+// A parsed request. Every field is a view into the connection's receive
+// buffer and is only valid while the handler runs; use OwnedHttpRequest to
+// keep a request beyond that.
+struct HttpRequest {
+    std::string_view method;
+    std::string_view uri;
+    std::string_view http_version;
+    HttpHeaders headers;
+    std::string_view body;
+    size_t content_length = 0;
+    bool chunked = false;
+    // Filled in by the router.
+    PathParams params;
 
-        ss << "\r\n";
-        ss << body;
-        return ss.str();
+    const std::string_view* find_header(std::string_view name) const noexcept;
+    const std::string_view* find_param(std::string_view name) const noexcept { return params.find(name); }
+    bool keep_alive() const noexcept;
+};
+
+// Self-contained copy of a request: one string holds the bytes and the
+// request's views point into it.
+class OwnedHttpRequest {
+public:
+    explicit OwnedHttpRequest(const HttpRequest& request);
+    OwnedHttpRequest(const OwnedHttpRequest& other);
+    OwnedHttpRequest& operator=(const OwnedHttpRequest& other);
+    
+    const HttpRequest& request() const noexcept { return request_; }
+
+private:
+    void assign(const HttpRequest& request);
+    
+    std::string storage_;
+    HttpRequest request_;
+};
+
+// Fills 'request' with views of the head 'parser' completed over 'raw'.
+// The body view covers whatever part of a Content-Length body 'raw' already
+// holds; chunked bodies are left to BodyReader. Returns false on framing
+// that cannot be read safely: an invalid or conflicting Content-Length, a
+// transfer coding other than chunked, or both headers together.
+bool assign_request(const http_accelerated::RequestParser& parser, std::string_view raw, HttpRequest& request);
+
+// Parses the request line, headers and, if Content-Length is present, the
+// body out of 'raw' without copying. 'raw' must contain the complete header
+// block. Throws std::runtime_error on malformed input.
+void parse_request(std::string_view raw, HttpRequest& request);
+
+// Orders header names without regard to case, as HTTP compares them, so a
+// field is found, and replaced, whatever case a handler wrote it in.
+struct HeaderNameLess {
+    using is_transparent = void;
+    
+    bool operator()(std::string_view a, std::string_view b) const noexcept {
+        const size_t length = std::min(a.size(), b.size());
+        for (size_t i = 0; i < length; ++i) {
+            const char x = lower(a[i]);
+            const char y = lower(b[i]);
+            if (x != y) {
+                return static_cast<unsigned char>(x) < static_cast<unsigned char>(y);
+            }
+        }
+        return a.size() < b.size();
     }
+
+private:
+    static char lower(char c) noexcept { return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c; }
 };
 
+// The strings and header nodes are taken from request_resource() when the
+// response is built: the connection's arena while a handler runs, so a
+// steady stream of requests costs no trips to the global allocator. Moving
+// a response keeps its resource; assigning one to a response built
+// elsewhere copies it.
+struct HttpResponse {
+    using Headers = std::pmr::map<std::pmr::string, std::pmr::string, HeaderNameLess>;
+    
+    int status_code = 200;
+    std::pmr::string status_text{"OK", request_resource()};
+    Headers headers{request_resource()};
+    std::pmr::string body{request_resource()};
+    // Set instead of 'body' to send bytes the response does not own: a
+    // shared buffer, or a region of an open file that is read as it is
+    // sent. The response keeps them alive until it is sent.
+    BodySource body_source;
+    // Set instead of 'body' to stream it. The body is sent with the
+    // Content-Length from 'headers' when the handler set one, and with the
+    // chunked coding otherwise.
+    std::unique_ptr<BodyProducer> producer;
+    // Set for a response to HEAD: the head describes the body a GET would
+    // get, Content-Length included, but the body itself is not sent.
+    bool omit_body = false;
+    // When set, the configured security headers are appended from
+    // 'security_config->header_block'; handlers should not add them to
+    // 'headers' themselves.
+    const SecurityConfig* security_config = nullptr;
+
+    // Appends the status line and header section to 'out', including the
+    // security headers and a Date unless 'headers' has one. The body is not
+    // copied: the connection sends it straight from where it lives.
+    void write_head(Buffer& out) const;
+    
+    bool chunked() const noexcept { return producer && headers.find("Content-Length") == headers.end(); }
+    // A 204 or 304 has no body, so no defaults describing one are added.
+    bool bodiless() const noexcept { return status_code == 204 || status_code == 304; }
+    // Whether the handler asked for the connection to be closed after it.
+    bool closes_connection() const noexcept;
+    
+    // The body's bytes when they are in memory, from 'body_source' when it
+    // is set and 'body' otherwise; empty for a file region.
+    std::string_view payload() const noexcept;
+    // The body's size, whichever the source. Streamed bodies are not counted.
+    std::uint64_t body_size() const noexcept;
+    // The region to send when the body is read from a file.
+    const FileRegion* file_region() const noexcept { return std::get_if<FileRegion>(&body_source); }
+    
+    // Runs 'producer' to the end into 'body', for clients that cannot take
+    // the chunked coding.
+    void buffer_body();
+};
+
+// "Date: <IMF-fixdate>\r\n" for the current second, formatted at most once
+// per second per thread.
+std::string_view date_header();
+
 } // namespace http
 } // namespace https_server
 
@@ -0,0 +1,938 @@
+#include "http/http2.hpp"
+#include "core/config.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+namespace https_server::http2 {
+
+namespace {
+
+constexpr std::uint8_t FRAME_DATA = 0x0;
+constexpr std::uint8_t FRAME_HEADERS = 0x1;
+constexpr std::uint8_t FRAME_PRIORITY = 0x2;
+constexpr std::uint8_t FRAME_RST_STREAM = 0x3;
+constexpr std::uint8_t FRAME_SETTINGS = 0x4;
+constexpr std::uint8_t FRAME_PUSH_PROMISE = 0x5;
+constexpr std::uint8_t FRAME_PING = 0x6;
+constexpr std::uint8_t FRAME_GOAWAY = 0x7;
+constexpr std::uint8_t FRAME_WINDOW_UPDATE = 0x8;
+constexpr std::uint8_t FRAME_CONTINUATION = 0x9;
+
+constexpr std::uint8_t FLAG_END_STREAM = 0x1;
+constexpr std::uint8_t FLAG_ACK = 0x1;
+constexpr std::uint8_t FLAG_END_HEADERS = 0x4;
+constexpr std::uint8_t FLAG_PADDED = 0x8;
+constexpr std::uint8_t FLAG_PRIORITY = 0x20;
+
+constexpr std::uint16_t SETTINGS_HEADER_TABLE_SIZE = 0x1;
+constexpr std::uint16_t SETTINGS_ENABLE_PUSH = 0x2;
+constexpr std::uint16_t SETTINGS_MAX_CONCURRENT_STREAMS = 0x3;
+constexpr std::uint16_t SETTINGS_INITIAL_WINDOW_SIZE = 0x4;
+constexpr std::uint16_t SETTINGS_MAX_FRAME_SIZE = 0x5;
+constexpr std::uint16_t SETTINGS_MAX_HEADER_LIST_SIZE = 0x6;
+
+constexpr size_t FRAME_HEADER_SIZE = 9;
+// The protocol minimum, which the server keeps for what it receives.
+constexpr std::uint32_t MAX_FRAME_SIZE = 16384;
+constexpr std::uint32_t LARGEST_FRAME_SIZE = 16777215;
+constexpr size_t HEADER_TABLE_SIZE = 4096;
+
+constexpr std::int64_t DEFAULT_WINDOW = 65535;
+constexpr std::int64_t MAX_WINDOW = 0x7fffffff;
+// Receive windows, reopened once half is used. Request bodies are capped
+// by max_body_size, so these only bound how far the client runs ahead.
+constexpr std::int64_t STREAM_WINDOW = 1 << 20;
+constexpr std::int64_t CONNECTION_WINDOW = 1 << 24;
+
+// A DATA frame and its header fill one TLS record.
+constexpr size_t DATA_FRAME_PAYLOAD = 16384 - FRAME_HEADER_SIZE;
+
+std::uint32_t read_u32(const char* data) noexcept {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    return static_cast<std::uint32_t>(bytes[0]) << 24 | static_cast<std::uint32_t>(bytes[1]) << 16 |
+           static_cast<std::uint32_t>(bytes[2]) << 8 | static_cast<std::uint32_t>(bytes[3]);
+}
+
+void write_u32(char* data, std::uint32_t value) noexcept {
+    data[0] = static_cast<char>(value >> 24);
+    data[1] = static_cast<char>(value >> 16);
+    data[2] = static_cast<char>(value >> 8);
+    data[3] = static_cast<char>(value);
+}
+
+void write_frame_header(char* data, size_t length, std::uint8_t type, std::uint8_t flags, std::uint32_t stream_id) noexcept {
+    data[0] = static_cast<char>(length >> 16);
+    data[1] = static_cast<char>(length >> 8);
+    data[2] = static_cast<char>(length);
+    data[3] = static_cast<char>(type);
+    data[4] = static_cast<char>(flags);
+    write_u32(data + 5, stream_id & 0x7fffffff);
+}
+
+void append_frame_header(Buffer& out, size_t length, std::uint8_t type, std::uint8_t flags, std::uint32_t stream_id) {
+    char header[FRAME_HEADER_SIZE];
+    write_frame_header(header, length, type, flags, stream_id);
+    out.append(header, sizeof(header));
+}
+
+void append_u32(Buffer& out, std::uint32_t value) {
+    char bytes[4];
+    write_u32(bytes, value);
+    out.append(bytes, sizeof(bytes));
+}
+
+void append_setting(Buffer& out, std::uint16_t id, std::uint32_t value) {
+    const char bytes[2] = {static_cast<char>(id >> 8), static_cast<char>(id)};
+    out.append(bytes, sizeof(bytes));
+    append_u32(out, value);
+}
+
+void append_rst_stream(Buffer& out, std::uint32_t stream_id, ErrorCode error) {
+    append_frame_header(out, 4, FRAME_RST_STREAM, 0, stream_id);
+    append_u32(out, static_cast<std::uint32_t>(error));
+}
+
+void append_window_update(Buffer& out, std::uint32_t stream_id, std::int64_t increment) {
+    append_frame_header(out, 4, FRAME_WINDOW_UPDATE, 0, stream_id);
+    append_u32(out, static_cast<std::uint32_t>(increment));
+}
+
+// Strips the pad length and padding of a PADDED frame.
+bool remove_padding(std::uint8_t flags, std::string_view& payload) noexcept {
+    if (!(flags & FLAG_PADDED)) {
+        return true;
+    }
+    if (payload.empty()) {
+        return false;
+    }
+    const auto padding = static_cast<unsigned char>(payload[0]);
+    payload.remove_prefix(1);
+    if (padding > payload.size()) {
+        return false;
+    }
+    payload.remove_suffix(padding);
+    return true;
+}
+
+// Headers that only mean something to one HTTP/1.1 hop; HTTP/2 forbids
+// them.
+bool connection_specific(std::string_view name) noexcept {
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+           name == "transfer-encoding" || name == "upgrade";
+}
+
+// Values that change from one response to the next would only churn the
+// dynamic table.
+hpack::Encoder::Indexing indexing_for(std::string_view name) noexcept {
+    if (name == "set-cookie") {
+        return hpack::Encoder::Indexing::Never;
+    }
+    if (name == "content-length" || name == "date" || name == "etag" || name == "last-modified" ||
+        name == "content-range") {
+        return hpack::Encoder::Indexing::None;
+    }
+    return hpack::Encoder::Indexing::Incremental;
+}
+
+} // namespace
+
+void Stream::clear() noexcept {
+    head.clear();
+    body.clear();
+    request = http::HttpRequest{};
+    handler.reset();
+    response.reset();
+    producer = nullptr;
+    phase = Phase::Receiving;
+    remote_closed = false;
+    reset = false;
+    queued = false;
+    headers_sent = false;
+    received = 0;
+    declared_length = UINT64_MAX;
+    remaining = 0;
+    send_window = 0;
+    receive_window = 0;
+}
+
+Session::Session(const Router& router, const Settings& settings)
+    : router_(router),
+      settings_(settings),
+      decoder_(HEADER_TABLE_SIZE, settings.max_header_list_size),
+      encoder_(HEADER_TABLE_SIZE),
+      streams_(&node_pool_),
+      handling_(0),
+      last_stream_id_(0),
+      accepted_(0),
+      continuation_stream_(0),
+      continuation_end_stream_(false),
+      connection_send_window_(DEFAULT_WINDOW),
+      connection_receive_window_(CONNECTION_WINDOW),
+      peer_initial_window_(DEFAULT_WINDOW),
+      peer_max_frame_size_(MAX_FRAME_SIZE),
+      preface_received_(false),
+      settings_received_(false),
+      goaway_sent_(false),
+      goaway_received_(false),
+      failed_(false)
+{
+}
+
+void Session::start(Buffer& out) {
+    append_frame_header(out, 18, FRAME_SETTINGS, 0, 0);
+    append_setting(out, SETTINGS_MAX_CONCURRENT_STREAMS, settings_.max_concurrent_streams);
+    append_setting(out, SETTINGS_INITIAL_WINDOW_SIZE, static_cast<std::uint32_t>(STREAM_WINDOW));
+    append_setting(out, SETTINGS_MAX_HEADER_LIST_SIZE, settings_.max_header_list_size);
+    // The connection window has no setting; it is opened up front instead.
+    append_window_update(out, 0, CONNECTION_WINDOW - DEFAULT_WINDOW);
+}
+
+bool Session::receive(Buffer& in, Buffer& out, std::vector<Stream*>& ready) {
+    if (failed_) {
+        in.clear();
+        return false;
+    }
+    
+    if (!preface_received_) {
+        const std::string_view view = in.readable_view();
+        const size_t length = std::min(view.size(), CLIENT_PREFACE.size());
+        if (view.substr(0, length) != CLIENT_PREFACE.substr(0, length)) {
+            return fail(ErrorCode::ProtocolError, out);
+        }
+        if (length < CLIENT_PREFACE.size()) {
+            return true;
+        }
+        in.consume(CLIENT_PREFACE.size());
+        preface_received_ = true;
+    }
+    
+    while (in.readable_bytes() >= FRAME_HEADER_SIZE) {
+        const char* header = in.read_ptr();
+        const size_t length = read_u32(header) >> 8;
+        if (length > MAX_FRAME_SIZE) {
+            return fail(ErrorCode::FrameSizeError, out);
+        }
+        if (in.readable_bytes() < FRAME_HEADER_SIZE + length) {
+            break;
+        }
+        
+        const bool handled = handle_frame(static_cast<std::uint8_t>(header[3]), static_cast<std::uint8_t>(header[4]),
+                                          read_u32(header + 5) & 0x7fffffff,
+                                          std::string_view(header + FRAME_HEADER_SIZE, length), out, ready);
+        in.consume(FRAME_HEADER_SIZE + length);
+        if (!handled) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Session::handle_frame(std::uint8_t type, std::uint8_t flags, std::uint32_t stream_id,
+                           std::string_view payload, Buffer& out, std::vector<Stream*>& ready) {
+    // A header block may not be interleaved with anything, and the client
+    // must open with its SETTINGS.
+    if (continuation_stream_ != 0 && (type != FRAME_CONTINUATION || stream_id != continuation_stream_)) {
+        return fail(ErrorCode::ProtocolError, out);
+    }
+    if (!settings_received_ && type != FRAME_SETTINGS) {
+        return fail(ErrorCode::ProtocolError, out);
+    }
+    
+    switch (type) {
+        case FRAME_DATA:
+            return on_data(flags, stream_id, payload, out, ready);
+        case FRAME_HEADERS:
+            return on_headers(flags, stream_id, payload, out, ready);
+        case FRAME_PRIORITY:
+            // Responses are interleaved evenly, so priorities are not used.
+            if (stream_id == 0) {
+                return fail(ErrorCode::ProtocolError, out);
+            }
+            if (payload.size() != 5) {
+                if (Stream* stream = find(stream_id)) {
+                    reset_stream(*stream, ErrorCode::FrameSizeError, out);
+                }
+            }
+            return true;
+        case FRAME_RST_STREAM:
+            if (stream_id == 0 || stream_id > last_stream_id_) {
+                return fail(ErrorCode::ProtocolError, out);
+            }
+            if (payload.size() != 4) {
+                return fail(ErrorCode::FrameSizeError, out);
+            }
+            if (Stream* stream = find(stream_id)) {
+                close_stream(*stream);
+            }
+            return true;
+        case FRAME_SETTINGS:
+            return on_settings(flags, stream_id, payload, out);
+        case FRAME_PUSH_PROMISE:
+            return fail(ErrorCode::ProtocolError, out);
+        case FRAME_PING:
+            if (stream_id != 0) {
+                return fail(ErrorCode::ProtocolError, out);
+            }
+            if (payload.size() != 8) {
+                return fail(ErrorCode::FrameSizeError, out);
+            }
+            if (!(flags & FLAG_ACK)) {
+                append_frame_header(out, 8, FRAME_PING, FLAG_ACK, 0);
+                out.append(payload.data(), payload.size());
+            }
+            return true;
+        case FRAME_GOAWAY:
+            if (stream_id != 0) {
+                return fail(ErrorCode::ProtocolError, out);
+            }
+            if (payload.size() < 8) {
+                return fail(ErrorCode::FrameSizeError, out);
+            }
+            goaway_received_ = true;
+            return true;
+        case FRAME_WINDOW_UPDATE:
+            return on_window_update(stream_id, payload, out);
+        case FRAME_CONTINUATION:
+            if (continuation_stream_ == 0) {
+                return fail(ErrorCode::ProtocolError, out);
+            }
+            header_block_.append(payload);
+            if (header_block_.size() > settings_.max_header_list_size) {
+                return fail(ErrorCode::EnhanceYourCalm, out);
+            }
+            if (!(flags & FLAG_END_HEADERS)) {
+                return true;
+            }
+            continuation_stream_ = 0;
+            return on_header_block(stream_id, continuation_end_stream_, out, ready);
+        default:
+            // Unknown frame types are ignored.
+            return true;
+    }
+}
+
+bool Session::on_headers(std::uint8_t flags, std::uint32_t stream_id, std::string_view payload,
+                         Buffer& out, std::vector<Stream*>& ready) {
+    if (stream_id == 0 || stream_id % 2 == 0) {
+        return fail(ErrorCode::ProtocolError, out);
+    }
+    if (!remove_padding(flags, payload)) {
+        return fail(ErrorCode::ProtocolError, out);
+    }
+    if (flags & FLAG_PRIORITY) {
+        if (payload.size() < 5) {
+            return fail(ErrorCode::ProtocolError, out);
+        }
+        payload.remove_prefix(5);
+    }
+    
+    header_block_.assign(payload.data(), payload.size());
+    if (!(flags & FLAG_END_HEADERS)) {
+        continuation_stream_ = stream_id;
+        continuation_end_stream_ = flags & FLAG_END_STREAM;
+        return true;
+    }
+    return on_header_block(stream_id, flags & FLAG_END_STREAM, out, ready);
+}
+
+bool Session::on_header_block(std::uint32_t stream_id, bool end_stream, Buffer& out, std::vector<Stream*>& ready) {
+    // Every block is decoded, whatever becomes of it, to keep the dynamic
+    // table in step with the client's.
+    if (stream_id <= last_stream_id_) {
+        if (decoder_.decode(header_block_, trailers_) == hpack::Decoder::Status::Error) {
+            return fail(ErrorCode::CompressionError, out);
+        }
+        
+        // Trailers, which are dropped, or a block for a stream that is
+        // closed already.
+        Stream* stream = find(stream_id);
+        if (!stream || stream->remote_closed) {
+            append_rst_stream(out, stream_id, ErrorCode::StreamClosed);
+            if (stream) {
+                close_stream(*stream);
+            }
+        } else if (!end_stream) {
+            reset_stream(*stream, ErrorCode::ProtocolError, out);
+        } else {
+            stream->remote_closed = true;
+            if (stream->phase == Stream::Phase::Receiving) {
+                complete_request(*stream, out, ready);
+            }
+        }
+        return true;
+    }
+    
+    last_stream_id_ = stream_id;
+    std::unique_ptr<Stream> owned = acquire_stream();
+    const hpack::Decoder::Status status = decoder_.decode(header_block_, owned->head);
+    if (status == hpack::Decoder::Status::Error) {
+        return fail(ErrorCode::CompressionError, out);
+    }
+    // Past a GOAWAY the client knows new streams are not processed.
+    if (goaway_sent_ || goaway_received_) {
+        release_stream(std::move(owned));
+        return true;
+    }
+    if (streams_.size() >= settings_.max_concurrent_streams) {
+        append_rst_stream(out, stream_id, ErrorCode::RefusedStream);
+        release_stream(std::move(owned));
+        return true;
+    }
+    
+    Stream& stream = *owned;
+    stream.id = stream_id;
+    stream.remote_closed = end_stream;
+    stream.send_window = peer_initial_window_;
+    stream.receive_window = STREAM_WINDOW;
+    streams_.emplace(stream_id, std::move(owned));
+    if (settings_.max_requests != 0 && ++accepted_ >= settings_.max_requests) {
+        send_goaway(ErrorCode::NoError, out);
+    }
+    
+    if (status == hpack::Decoder::Status::TooLarge) {
+        reject(stream, 431, "Request Header Fields Too Large");
+        return true;
+    }
+    if (!build_request(stream)) {
+        reset_stream(stream, ErrorCode::ProtocolError, out);
+        return true;
+    }
+    LOG_DEBUG("Request: " + std::string(stream.request.method) + " " + std::string(stream.request.uri));
+    
+    if (settings_.max_body_size != 0 && stream.declared_length != UINT64_MAX &&
+        stream.declared_length > settings_.max_body_size) {
+        reject(stream, 413, "Payload Too Large");
+        return true;
+    }
+    
+    if (const StreamingHandlerFactory* factory = router_.find_streaming_route(stream.request)) {
+        try {
+            stream.handler = (*factory)(stream.request);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Handler failed: " + std::string(e.what()));
+        }
+        if (!stream.handler) {
+            reject(stream, 500, "Internal Server Error");
+            return true;
+        }
+    }
+    
+    if (stream.remote_closed) {
+        complete_request(stream, out, ready);
+    }
+    return true;
+}
+
+bool Session::on_data(std::uint8_t flags, std::uint32_t stream_id, std::string_view payload,
+                      Buffer& out, std::vector<Stream*>& ready) {
+    if (stream_id == 0) {
+        return fail(ErrorCode::ProtocolError, out);
+    }
+    
+    // Padding counts against the windows too.
+    const auto flow = static_cast<std::int64_t>(payload.size());
+    if (!remove_padding(flags, payload)) {
+        return fail(ErrorCode::ProtocolError, out);
+    }
+    connection_receive_window_ -= flow;
+    if (connection_receive_window_ < 0) {
+        return fail(ErrorCode::FlowControlError, out);
+    }
+    if (CONNECTION_WINDOW - connection_receive_window_ >= CONNECTION_WINDOW / 2) {
+        append_window_update(out, 0, CONNECTION_WINDOW - connection_receive_window_);
+        connection_receive_window_ = CONNECTION_WINDOW;
+    }
+    
+    Stream* stream = find(stream_id);
+    if (!stream) {
+        // Closed streams may still have frames in flight.
+        return stream_id <= last_stream_id_ || fail(ErrorCode::ProtocolError, out);
+    }
+    if (stream->remote_closed) {
+        reset_stream(*stream, ErrorCode::StreamClosed, out);
+        return true;
+    }
+    stream->receive_window -= flow;
+    if (stream->receive_window < 0) {
+        reset_stream(*stream, ErrorCode::FlowControlError, out);
+        return true;
+    }
+    
+    // A stream already answered early drops the rest of its body.
+    if (stream->phase == Stream::Phase::Receiving) {
+        stream->received += payload.size();
+        if (stream->received > stream->declared_length) {
+            reset_stream(*stream, ErrorCode::ProtocolError, out);
+            return true;
+        }
+        if (settings_.max_body_size != 0 && stream->received > settings_.max_body_size) {
+            reject(*stream, 413, "Payload Too Large");
+        } else if (stream->handler) {
+            try {
+                stream->handler->on_body(payload);
+            } catch (const std::exception& e) {
+                LOG_ERROR("Handler failed: " + std::string(e.what()));
+                reject(*stream, 500, "Internal Server Error");
+            }
+        } else {
+            stream->body.append(payload);
+        }
+    }
+    
+    if (flags & FLAG_END_STREAM) {
+        stream->remote_closed = true;
+        if (stream->phase == Stream::Phase::Receiving) {
+            complete_request(*stream, out, ready);
+        }
+    } else if (STREAM_WINDOW - stream->receive_window >= STREAM_WINDOW / 2) {
+        append_window_update(out, stream_id, STREAM_WINDOW - stream->receive_window);
+        stream->receive_window = STREAM_WINDOW;
+    }
+    return true;
+}
+
+bool Session::on_settings(std::uint8_t flags, std::uint32_t stream_id, std::string_view payload, Buffer& out) {
+    if (stream_id != 0) {
+        return fail(ErrorCode::ProtocolError, out);
+    }
+    if (flags & FLAG_ACK) {
+        return payload.empty() || fail(ErrorCode::FrameSizeError, out);
+    }
+    if (payload.size() % 6 != 0) {
+        return fail(ErrorCode::FrameSizeError, out);
+    }
+    
+    for (size_t offset = 0; offset < payload.size(); offset += 6) {
+        const auto id = static_cast<std::uint16_t>(static_cast<unsigned char>(payload[offset]) << 8 |
+                                                   static_cast<unsigned char>(payload[offset + 1]));
+        const std::uint32_t value = read_u32(payload.data() + offset + 2);
+        switch (id) {
+            case SETTINGS_HEADER_TABLE_SIZE:
+                encoder_.set_max_table_size(value);
+                break;
+            case SETTINGS_ENABLE_PUSH:
+                if (value > 1) {
+                    return fail(ErrorCode::ProtocolError, out);
+                }
+                break;
+            case SETTINGS_INITIAL_WINDOW_SIZE: {
+                if (value > MAX_WINDOW) {
+                    return fail(ErrorCode::FlowControlError, out);
+                }
+                // Applies to the open streams too, as a delta.
+                const std::int64_t delta = static_cast<std::int64_t>(value) - peer_initial_window_;
+                peer_initial_window_ = value;
+                for (const auto& entry : streams_) {
+                    Stream& stream = *entry.second;
+                    stream.send_window += delta;
+                    if (stream.send_window > MAX_WINDOW) {
+                        return fail(ErrorCode::FlowControlError, out);
+                    }
+                    if (stream.send_window > 0) {
+                        enqueue(stream);
+                    }
+                }
+                break;
+            }
+            case SETTINGS_MAX_FRAME_SIZE:
+                if (value < MAX_FRAME_SIZE || value > LARGEST_FRAME_SIZE) {
+                    return fail(ErrorCode::ProtocolError, out);
+                }
+                peer_max_frame_size_ = value;
+                break;
+            default:
+                break;
+        }
+    }
+    
+    settings_received_ = true;
+    append_frame_header(out, 0, FRAME_SETTINGS, FLAG_ACK, 0);
+    return true;
+}
+
+bool Session::on_window_update(std::uint32_t stream_id, std::string_view payload, Buffer& out) {
+    if (payload.size() != 4) {
+        return fail(ErrorCode::FrameSizeError, out);
+    }
+    const std::int64_t increment = read_u32(payload.data()) & 0x7fffffff;
+    
+    if (stream_id == 0) {
+        if (increment == 0) {
+            return fail(ErrorCode::ProtocolError, out);
+        }
+        connection_send_window_ += increment;
+        return connection_send_window_ <= MAX_WINDOW || fail(ErrorCode::FlowControlError, out);
+    }
+    
+    Stream* stream = find(stream_id);
+    if (!stream) {
+        return stream_id <= last_stream_id_ || fail(ErrorCode::ProtocolError, out);
+    }
+    if (increment == 0) {
+        reset_stream(*stream, ErrorCode::ProtocolError, out);
+        return true;
+    }
+    stream->send_window += increment;
+    if (stream->send_window > MAX_WINDOW) {
+        reset_stream(*stream, ErrorCode::FlowControlError, out);
+        return true;
+    }
+    enqueue(*stream);
+    return true;
+}
+
+bool Session::build_request(Stream& stream) {
+    http::HttpRequest& request = stream.request;
+    std::string_view scheme;
+    std::string_view authority;
+    bool regular_seen = false;
+    
+    for (size_t i = 0; i < stream.head.size(); ++i) {
+        const std::string_view name = stream.head.name(i);
+        const std::string_view value = stream.head.value(i);
+        if (name.empty()) {
+            return false;
+        }
+        
+        // Pseudo-headers come first, once each.
+        if (name[0] == ':') {
+            std::string_view* field = name == ":method" ? &request.method
+                                    : name == ":path" ? &request.uri
+                                    : name == ":scheme" ? &scheme
+                                    : name == ":authority" ? &authority : nullptr;
+            if (regular_seen || !field || !field->empty()) {
+                return false;
+            }
+            *field = value;
+            continue;
+        }
+        regular_seen = true;
+        
+        const bool uppercase = std::any_of(name.begin(), name.end(), [](char c) { return c >= 'A' && c <= 'Z'; });
+        if (uppercase || connection_specific(name) || (name == "te" && value != "trailers")) {
+            return false;
+        }
+        request.headers.add(name, value);
+        
+        if (name == "content-length") {
+            std::uint64_t length = 0;
+            const auto result = std::from_chars(value.data(), value.data() + value.size(), length);
+            if (result.ec != std::errc() || result.ptr != value.data() + value.size() || value.empty() ||
+                (stream.declared_length != UINT64_MAX && stream.declared_length != length)) {
+                return false;
+            }
+            stream.declared_length = length;
+            request.content_length = static_cast<size_t>(length);
+        }
+    }
+    
+    if (request.method.empty() || request.uri.empty() || scheme.empty()) {
+        return false;
+    }
+    // Handlers look for Host as they would on HTTP/1.1.
+    if (!authority.empty() && !request.headers.find("host")) {
+        request.headers.add("host", authority);
+    }
+    request.http_version = "HTTP/2";
+    return true;
+}
+
+void Session::complete_request(Stream& stream, Buffer& out, std::vector<Stream*>& ready) {
+    if (stream.declared_length != UINT64_MAX && stream.received != stream.declared_length) {
+        reset_stream(stream, ErrorCode::ProtocolError, out);
+        return;
+    }
+    
+    stream.request.body = stream.body;
+    stream.phase = Stream::Phase::Handling;
+    ++handling_;
+    ready.push_back(&stream);
+}
+
+void Session::reject(Stream& stream, int status_code, const std::string& status_text) {
+    stream.handler.reset();
+    http::HttpResponse& response = stream.response.emplace();
+    response.status_code = status_code;
+    response.status_text = status_text;
+    response.body = "<h1>" + std::to_string(status_code) + " " + status_text + "</h1>";
+    respond(stream);
+}
+
+void Session::respond(Stream& stream) {
+    if (stream.phase == Stream::Phase::Handling) {
+        --handling_;
+    }
+    if (stream.reset) {
+        remove_stream(stream);
+        return;
+    }
+    
+    http::HttpResponse& response = *stream.response;
+    // A response to HEAD ends with its HEADERS, which keep the
+    // content-length a GET would get.
+    response.omit_body = response.omit_body || stream.request.method == "HEAD";
+    stream.remaining = response.omit_body ? 0 : response.body_size();
+    if (response.omit_body) {
+        stream.producer = nullptr;
+    } else if (const http::FileRegion* region = response.file_region()) {
+        stream.file_reader.reset(*region);
+        stream.producer = &stream.file_reader;
+    } else if (response.producer) {
+        stream.producer = response.producer.get();
+        stream.remaining = UINT64_MAX;
+        const auto length = response.headers.find("Content-Length");
+        if (length != response.headers.end()) {
+            const std::string_view value = length->second;
+            const auto result = std::from_chars(value.data(), value.data() + value.size(), stream.remaining);
+            if (result.ec != std::errc() || result.ptr != value.data() + value.size()) {
+                stream.remaining = 0;
+            }
+        }
+    }
+    
+    stream.phase = Stream::Phase::Sending;
+    enqueue(stream);
+}
+
+void Session::refuse(Stream& stream, Buffer& out) {
+    --handling_;
+    append_rst_stream(out, stream.id, ErrorCode::RefusedStream);
+    remove_stream(stream);
+}
+
+void Session::enqueue(Stream& stream) {
+    if (stream.phase == Stream::Phase::Sending && !stream.queued) {
+        stream.queued = true;
+        send_queue_.push_back(stream.id);
+    }
+}
+
+void Session::write(Buffer& out, size_t limit) {
+    // Each pass gives every queued stream one frame; passes stop once no
+    // stream could write, which leaves the blocked ones queued.
+    bool progress = true;
+    while (progress && out.readable_bytes() < limit) {
+        progress = false;
+        for (size_t count = send_queue_.size(); count > 0 && out.readable_bytes() < limit; --count) {
+            const std::uint32_t stream_id = send_queue_.front();
+            send_queue_.pop_front();
+            Stream* stream = find(stream_id);
+            if (!stream || !stream->queued) {
+                continue;
+            }
+            stream->queued = false;
+            progress |= write_stream(*stream, out);
+        }
+    }
+}
+
+bool Session::write_stream(Stream& stream, Buffer& out) {
+    if (!stream.headers_sent) {
+        write_headers(stream, out);
+        if (stream.remaining == 0) {
+            finish_stream(stream, out);
+        } else {
+            enqueue(stream);
+        }
+        return true;
+    }
+    
+    if (std::min(connection_send_window_, stream.send_window) <= 0) {
+        // A stream held back by its own window waits for a WINDOW_UPDATE
+        // for it; one held back by the connection's stays in line.
+        if (stream.send_window > 0) {
+            enqueue(stream);
+        }
+        return false;
+    }
+    
+    if (write_data(stream, out)) {
+        if (stream.remaining == 0) {
+            finish_stream(stream, out);
+        } else {
+            enqueue(stream);
+        }
+    }
+    return true;
+}
+
+void Session::write_headers(Stream& stream, Buffer& out) {
+    using Indexing = hpack::Encoder::Indexing;
+    const http::HttpResponse& response = *stream.response;
+    const auto has_header = [&response](const char* name) {
+        return response.headers.find(name) != response.headers.end();
+    };
+    char digits[24];
+    const auto number = [&digits](auto value) {
+        const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        return std::string_view(digits, static_cast<size_t>(result.ptr - digits));
+    };
+    
+    // The same defaults as HttpResponse::write_head, under lowercase names.
+    encoded_.clear();
+    encoder_.begin_block(encoded_);
+    encoder_.encode(":status", number(response.status_code), Indexing::Incremental, encoded_);
+    if (!response.producer && !response.bodiless() && !has_header("Content-Length")) {
+        encoder_.encode("content-length", number(response.body_size()), Indexing::None, encoded_);
+    }
+    if (!response.bodiless() && !has_header("Content-Type")) {
+        encoder_.encode("content-type", "text/html; charset=utf-8", Indexing::Incremental, encoded_);
+    }
+    if (!has_header("Date")) {
+        // date_header() is the whole "Date: ...\r\n" line.
+        const std::string_view date = http::date_header();
+        encoder_.encode("date", date.substr(6, date.size() - 8), Indexing::None, encoded_);
+    }
+    if (response.security_config) {
+        for (const auto& [name, value] : response.security_config->header_fields) {
+            encoder_.encode(name, value, Indexing::Incremental, encoded_);
+        }
+    }
+    for (const auto& [key, value] : response.headers) {
+        name_.resize(key.size());
+        std::transform(key.begin(), key.end(), name_.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (!connection_specific(name_)) {
+            encoder_.encode(name_, value, indexing_for(name_), encoded_);
+        }
+    }
+    
+    // Blocks larger than a frame continue in CONTINUATION frames.
+    std::string_view block = encoded_;
+    std::uint8_t type = FRAME_HEADERS;
+    do {
+        const size_t length = std::min<size_t>(block.size(), peer_max_frame_size_);
+        std::uint8_t flags = length == block.size() ? FLAG_END_HEADERS : 0;
+        if (type == FRAME_HEADERS && stream.remaining == 0) {
+            flags |= FLAG_END_STREAM;
+        }
+        append_frame_header(out, length, type, flags, stream.id);
+        out.append(block.data(), length);
+        block.remove_prefix(length);
+        type = FRAME_CONTINUATION;
+    } while (!block.empty());
+    stream.headers_sent = true;
+}
+
+bool Session::write_data(Stream& stream, Buffer& out) {
+    const size_t window = static_cast<size_t>(std::min(connection_send_window_, stream.send_window));
+    size_t length = std::min({window, static_cast<size_t>(peer_max_frame_size_), DATA_FRAME_PAYLOAD});
+    if (stream.remaining != UINT64_MAX) {
+        length = static_cast<size_t>(std::min<std::uint64_t>(length, stream.remaining));
+    }
+    http::HttpResponse& response = *stream.response;
+    
+    out.ensure_capacity(FRAME_HEADER_SIZE + length);
+    char* const frame = out.write_ptr();
+    bool done = false;
+    if (stream.producer) {
+        // Produced straight into the frame, on the loop thread.
+        size_t produced = 0;
+        try {
+            produced = std::min(stream.producer->produce(frame + FRAME_HEADER_SIZE, length, done), length);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Handler failed: " + std::string(e.what()));
+            reset_stream(stream, ErrorCode::InternalError, out);
+            return false;
+        }
+        if (produced == 0 && !done) {
+            LOG_ERROR("Response body producer stalled");
+            reset_stream(stream, ErrorCode::InternalError, out);
+            return false;
+        }
+        
+        if (stream.remaining != UINT64_MAX) {
+            stream.remaining -= produced;
+            if (done && stream.remaining > 0) {
+                LOG_ERROR("Response body shorter than its Content-Length");
+                reset_stream(stream, ErrorCode::InternalError, out);
+                return false;
+            }
+        } else if (done) {
+            stream.remaining = 0;
+        }
+        length = produced;
+    } else {
+        const std::string_view body = response.payload();
+        std::copy_n(body.data() + (body.size() - stream.remaining), length, frame + FRAME_HEADER_SIZE);
+        stream.remaining -= length;
+    }
+    
+    write_frame_header(frame, length, FRAME_DATA, stream.remaining == 0 ? FLAG_END_STREAM : 0, stream.id);
+    out.has_written(FRAME_HEADER_SIZE + length);
+    connection_send_window_ -= static_cast<std::int64_t>(length);
+    stream.send_window -= static_cast<std::int64_t>(length);
+    return true;
+}
+
+Stream* Session::find(std::uint32_t stream_id) noexcept {
+    const auto it = streams_.find(stream_id);
+    return it == streams_.end() ? nullptr : it->second.get();
+}
+
+std::unique_ptr<Stream> Session::acquire_stream() {
+    if (spare_streams_.empty()) {
+        return std::make_unique<Stream>();
+    }
+    std::unique_ptr<Stream> stream = std::move(spare_streams_.back());
+    spare_streams_.pop_back();
+    return stream;
+}
+
+void Session::release_stream(std::unique_ptr<Stream> stream) {
+    // As many as can be open at once are kept.
+    if (spare_streams_.size() < settings_.max_concurrent_streams) {
+        stream->clear();
+        spare_streams_.push_back(std::move(stream));
+    }
+}
+
+void Session::remove_stream(Stream& stream) {
+    const auto it = streams_.find(stream.id);
+    std::unique_ptr<Stream> owned = std::move(it->second);
+    streams_.erase(it);
+    release_stream(std::move(owned));
+}
+
+void Session::finish_stream(Stream& stream, Buffer& out) {
+    // A response sent before the request finished arriving tells the
+    // client to stop sending it.
+    if (!stream.remote_closed) {
+        append_rst_stream(out, stream.id, ErrorCode::NoError);
+    }
+    remove_stream(stream);
+}
+
+void Session::close_stream(Stream& stream) {
+    if (stream.phase == Stream::Phase::Handling) {
+        stream.reset = true;
+        return;
+    }
+    remove_stream(stream);
+}
+
+void Session::reset_stream(Stream& stream, ErrorCode error, Buffer& out) {
+    append_rst_stream(out, stream.id, error);
+    close_stream(stream);
+}
+
+bool Session::fail(ErrorCode error, Buffer& out) {
+    LOG_WARNING("HTTP/2 connection error " + std::to_string(static_cast<std::uint32_t>(error)));
+    send_goaway(error, out);
+    failed_ = true;
+    return false;
+}
+
+void Session::send_goaway(ErrorCode error, Buffer& out) {
+    if (goaway_sent_ && error == ErrorCode::NoError) {
+        return;
+    }
+    append_frame_header(out, 8, FRAME_GOAWAY, 0, 0);
+    append_u32(out, last_stream_id_);
+    append_u32(out, static_cast<std::uint32_t>(error));
+    goaway_sent_ = true;
+}
+
+} // namespace https_server::http2
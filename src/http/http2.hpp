@@ -0,0 +1,213 @@
+#ifndef HTTPS_SERVER_HTTP2_HPP
+#define HTTPS_SERVER_HTTP2_HPP
+
+#include "http/hpack.hpp"
+#include "http/http.hpp"
+#include "http/router.hpp"
+#include "utils/arena.hpp"
+#include "utils/buffer.hpp"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace https_server::http2 {
+
+// Sent by the client ahead of its first SETTINGS frame.
+inline constexpr std::string_view CLIENT_PREFACE = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+enum class ErrorCode : std::uint32_t {
+    NoError = 0x0,
+    ProtocolError = 0x1,
+    InternalError = 0x2,
+    FlowControlError = 0x3,
+    SettingsTimeout = 0x4,
+    StreamClosed = 0x5,
+    FrameSizeError = 0x6,
+    RefusedStream = 0x7,
+    Cancel = 0x8,
+    CompressionError = 0x9,
+    ConnectError = 0xa,
+    EnhanceYourCalm = 0xb,
+    InadequateSecurity = 0xc,
+    Http11Required = 0xd
+};
+
+// One request and its response. Once a stream is handed out as ready, the
+// handler owns 'request', 'handler', 'response' and 'arena' until it passes
+// the stream back to Session::respond; the session leaves them alone
+// meanwhile. Streams are recycled, buffers and arena included.
+struct Stream {
+    enum class Phase {
+        // The request is still arriving.
+        Receiving,
+        // The request is complete and out with a handler.
+        Handling,
+        // The response is being written.
+        Sending
+    };
+    
+    std::uint32_t id = 0;
+    // 'request' views 'head' and 'body'.
+    hpack::HeaderList head;
+    std::string body;
+    http::HttpRequest request;
+    std::unique_ptr<StreamingHandler> handler;
+    // Handlers run concurrently, so each stream has its own arena. The
+    // response is emplaced rather than assigned, to keep it there.
+    Arena arena;
+    std::optional<http::HttpResponse> response;
+    // The response's producer, or file_reader for a file region body.
+    http::BodyProducer* producer = nullptr;
+    http::FileRegionReader file_reader;
+    
+    Phase phase = Phase::Receiving;
+    bool remote_closed = false;
+    // Reset while Handling; dropped once the response comes back.
+    bool reset = false;
+    bool queued = false;
+    bool headers_sent = false;
+    // Request body bytes received, against the declared Content-Length.
+    std::uint64_t received = 0;
+    std::uint64_t declared_length = UINT64_MAX;
+    // Response body bytes still to send from the response's payload(), or
+    // owed by a producer with a Content-Length (UINT64_MAX without one).
+    std::uint64_t remaining = 0;
+    // Flow-control windows. SETTINGS can push the send window below zero.
+    std::int64_t send_window = 0;
+    std::int64_t receive_window = 0;
+    
+    // Back to the state of a new stream, keeping the buffers' capacity.
+    void clear() noexcept;
+};
+
+// The HTTP/2 framing layer of one connection (RFC 9113), independent of
+// how its bytes are moved: receive() consumes plaintext and write() produces
+// it. Requests come out as streams for the caller to run through its
+// handlers, and their responses are interleaved round robin, a frame per
+// stream at a time, within the peer's flow-control windows. DATA frames are
+// sized so that frame and header fill one TLS record.
+// Request bodies are buffered per stream up to max_body_size, and the
+// receive windows are reopened as they are read.
+class Session {
+public:
+    struct Settings {
+        std::uint32_t max_concurrent_streams = 100;
+        std::uint32_t max_header_list_size = 65536;
+        // 0 = unlimited.
+        std::uint64_t max_body_size = 0;
+        // Streams accepted before a GOAWAY asks the client to continue on
+        // a new connection (0 = unlimited).
+        std::uint32_t max_requests = 0;
+    };
+    
+    Session(const Router& router, const Settings& settings);
+    
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+    
+    // Queues the server preface.
+    void start(Buffer& out);
+    
+    // Consumes the complete frames at the front of 'in', queuing the frames
+    // they call for into 'out'. Streams whose request is complete are added
+    // to 'ready', each to be handled and passed to respond() or refuse().
+    // Returns false once the connection has failed; the GOAWAY saying why
+    // is in 'out' and later input is ignored.
+    bool receive(Buffer& in, Buffer& out, std::vector<Stream*>& ready);
+    
+    // Queues a handled stream's response for write().
+    void respond(Stream& stream);
+    // Answers a ready stream with REFUSED_STREAM instead, which tells the
+    // client it was not processed and can be retried.
+    void refuse(Stream& stream, Buffer& out);
+    
+    // Appends response frames until 'out' holds at least 'limit' bytes or
+    // nothing more can be sent before the peer opens its windows.
+    void write(Buffer& out, size_t limit);
+    
+    size_t open_streams() const noexcept { return streams_.size(); }
+    size_t handling_streams() const noexcept { return handling_; }
+    // After a GOAWAY either way once the last stream is done, and right
+    // away after a connection error.
+    bool finished() const noexcept {
+        return failed_ || ((goaway_sent_ || goaway_received_) && streams_.empty());
+    }
+
+private:
+    bool handle_frame(std::uint8_t type, std::uint8_t flags, std::uint32_t stream_id,
+                      std::string_view payload, Buffer& out, std::vector<Stream*>& ready);
+    bool on_headers(std::uint8_t flags, std::uint32_t stream_id, std::string_view payload,
+                    Buffer& out, std::vector<Stream*>& ready);
+    bool on_header_block(std::uint32_t stream_id, bool end_stream, Buffer& out, std::vector<Stream*>& ready);
+    bool on_data(std::uint8_t flags, std::uint32_t stream_id, std::string_view payload,
+                 Buffer& out, std::vector<Stream*>& ready);
+    bool on_settings(std::uint8_t flags, std::uint32_t stream_id, std::string_view payload, Buffer& out);
+    bool on_window_update(std::uint32_t stream_id, std::string_view payload, Buffer& out);
+    
+    bool build_request(Stream& stream);
+    void complete_request(Stream& stream, Buffer& out, std::vector<Stream*>& ready);
+    void reject(Stream& stream, int status_code, const std::string& status_text);
+    void enqueue(Stream& stream);
+    
+    bool write_stream(Stream& stream, Buffer& out);
+    void write_headers(Stream& stream, Buffer& out);
+    bool write_data(Stream& stream, Buffer& out);
+    
+    Stream* find(std::uint32_t stream_id) noexcept;
+    std::unique_ptr<Stream> acquire_stream();
+    void release_stream(std::unique_ptr<Stream> stream);
+    void remove_stream(Stream& stream);
+    void finish_stream(Stream& stream, Buffer& out);
+    void close_stream(Stream& stream);
+    void reset_stream(Stream& stream, ErrorCode error, Buffer& out);
+    bool fail(ErrorCode error, Buffer& out);
+    void send_goaway(ErrorCode error, Buffer& out);
+    
+    const Router& router_;
+    Settings settings_;
+    hpack::Decoder decoder_;
+    hpack::Encoder encoder_;
+    
+    // Map nodes come from a pool and closed streams wait in spare_streams_
+    // for reuse, so opening a stream does not allocate once the connection
+    // has warmed up.
+    std::pmr::unsynchronized_pool_resource node_pool_;
+    std::pmr::unordered_map<std::uint32_t, std::unique_ptr<Stream>> streams_;
+    std::vector<std::unique_ptr<Stream>> spare_streams_;
+    // Streams with response frames to write, in round-robin order. Ids
+    // rather than pointers, so closing a stream needs no search here.
+    std::deque<std::uint32_t> send_queue_;
+    size_t handling_;
+    std::uint32_t last_stream_id_;
+    std::uint32_t accepted_;
+    
+    // A header block split over CONTINUATION frames, while it arrives.
+    std::string header_block_;
+    std::uint32_t continuation_stream_;
+    bool continuation_end_stream_;
+    hpack::HeaderList trailers_;
+    // Scratch for encoding response heads.
+    std::string encoded_;
+    std::string name_;
+    
+    std::int64_t connection_send_window_;
+    std::int64_t connection_receive_window_;
+    std::int64_t peer_initial_window_;
+    std::uint32_t peer_max_frame_size_;
+    
+    bool preface_received_;
+    bool settings_received_;
+    bool goaway_sent_;
+    bool goaway_received_;
+    bool failed_;
+};
+
+} // namespace https_server::http2
+
+#endif // HTTPS_SERVER_HTTP2_HPP
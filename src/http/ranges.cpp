@@ -0,0 +1,214 @@
+#include "http/ranges.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <random>
+
+namespace https_server::http {
+
+namespace {
+
+bool is_space(char c) noexcept {
+    return c == ' ' || c == '\t';
+}
+
+std::string_view trim(std::string_view text) noexcept {
+    while (!text.empty() && is_space(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && is_space(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// All of 'text' as a decimal number.
+bool parse_number(std::string_view text, std::uint64_t& value) noexcept {
+    if (text.empty() || text.front() < '0' || text.front() > '9') {
+        return false;
+    }
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// A separator that is unlikely to occur in any body, fresh per response.
+std::string make_boundary() {
+    static constexpr char HEX[] = "0123456789abcdef";
+    thread_local std::mt19937_64 generator{std::random_device{}()};
+    std::uint64_t bits = generator();
+    std::string boundary(16, '0');
+    for (char& c : boundary) {
+        c = HEX[bits & 0xf];
+        bits >>= 4;
+    }
+    return boundary;
+}
+
+} // namespace
+
+RangeStatus parse_range(std::string_view header, std::uint64_t size, std::vector<ByteRange>& ranges) {
+    ranges.clear();
+    
+    header = trim(header);
+    const size_t equals = header.find('=');
+    if (equals == std::string_view::npos) {
+        return RangeStatus::Ignored;
+    }
+    const std::string_view unit = trim(header.substr(0, equals));
+    if (unit.size() != 5 || !std::equal(unit.begin(), unit.end(), "bytes", [](char a, char b) {
+            return (a | 0x20) == b;
+        })) {
+        return RangeStatus::Ignored;
+    }
+    
+    // Every spec has to parse, satisfiable or not; one that does not makes
+    // the whole header invalid, and invalid headers are ignored.
+    size_t specs = 0;
+    std::string_view list = header.substr(equals + 1);
+    while (!list.empty()) {
+        const size_t comma = list.find(',');
+        const std::string_view spec = trim(list.substr(0, comma));
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        if (spec.empty()) {
+            continue;
+        }
+        if (++specs > MAX_RANGES) {
+            return RangeStatus::Ignored;
+        }
+        
+        const size_t dash = spec.find('-');
+        if (dash == std::string_view::npos) {
+            return RangeStatus::Ignored;
+        }
+        const std::string_view first_text = trim(spec.substr(0, dash));
+        const std::string_view last_text = trim(spec.substr(dash + 1));
+        
+        std::uint64_t first = 0;
+        std::uint64_t last = 0;
+        if (first_text.empty()) {
+            // A suffix: the last 'last' bytes.
+            if (!parse_number(last_text, last)) {
+                return RangeStatus::Ignored;
+            }
+            if (last > 0 && size > 0) {
+                const std::uint64_t length = std::min(last, size);
+                ranges.push_back({size - length, length});
+            }
+            continue;
+        }
+        if (!parse_number(first_text, first)) {
+            return RangeStatus::Ignored;
+        }
+        if (last_text.empty()) {
+            last = UINT64_MAX;
+        } else if (!parse_number(last_text, last) || last < first) {
+            return RangeStatus::Ignored;
+        }
+        if (first < size) {
+            ranges.push_back({first, std::min(last, size - 1) - first + 1});
+        }
+    }
+    if (specs == 0) {
+        return RangeStatus::Ignored;
+    }
+    if (ranges.empty()) {
+        return RangeStatus::Unsatisfiable;
+    }
+    
+    std::sort(ranges.begin(), ranges.end(), [](const ByteRange& a, const ByteRange& b) {
+        return a.offset < b.offset;
+    });
+    size_t merged = 0;
+    for (size_t i = 1; i < ranges.size(); ++i) {
+        ByteRange& last = ranges[merged];
+        if (ranges[i].offset <= last.offset + last.length) {
+            last.length = std::max(last.offset + last.length, ranges[i].offset + ranges[i].length) - last.offset;
+        } else {
+            ranges[++merged] = ranges[i];
+        }
+    }
+    ranges.resize(merged + 1);
+    return RangeStatus::Satisfiable;
+}
+
+std::string content_range(const ByteRange& range, std::uint64_t size) {
+    return "bytes " + std::to_string(range.offset) + "-" + std::to_string(range.offset + range.length - 1) + "/" +
+           std::to_string(size);
+}
+
+RangesProducer::RangesProducer(SharedBuffer buffer, const std::vector<ByteRange>& ranges,
+                               std::string_view content_type)
+    : buffer_(std::move(buffer)), length_(0), segment_(0), head_sent_(0), range_sent_(0) {
+    build(nullptr, ranges, content_type, buffer_->size());
+}
+
+RangesProducer::RangesProducer(std::shared_ptr<const FileDescriptor> file, const std::vector<ByteRange>& ranges,
+                               std::string_view content_type)
+    : length_(0), segment_(0), head_sent_(0), range_sent_(0) {
+    build(file, ranges, content_type, file->size());
+}
+
+void RangesProducer::build(const std::shared_ptr<const FileDescriptor>& file, const std::vector<ByteRange>& ranges,
+                           std::string_view content_type, std::uint64_t size) {
+    if (ranges.size() == 1) {
+        segments_.push_back({std::string(), FileRegion{file, ranges[0].offset, ranges[0].length}});
+        content_type_ = content_type;
+        length_ = ranges[0].length;
+        return;
+    }
+    
+    const std::string boundary = make_boundary();
+    content_type_ = "multipart/byteranges; boundary=" + boundary;
+    segments_.reserve(ranges.size() + 1);
+    for (const ByteRange& range : ranges) {
+        std::string head = "\r\n--" + boundary + "\r\nContent-Type: ";
+        head += content_type;
+        head += "\r\nContent-Range: " + content_range(range, size) + "\r\n\r\n";
+        length_ += head.size() + range.length;
+        segments_.push_back({std::move(head), FileRegion{file, range.offset, range.length}});
+    }
+    segments_.push_back({"\r\n--" + boundary + "--\r\n", FileRegion{}});
+    length_ += segments_.back().head.size();
+}
+
+size_t RangesProducer::produce(char* out, size_t capacity, bool& done) {
+    size_t filled = 0;
+    while (segment_ < segments_.size()) {
+        const Segment& segment = segments_[segment_];
+        if (head_sent_ == segment.head.size() && range_sent_ == segment.region.length) {
+            ++segment_;
+            head_sent_ = 0;
+            range_sent_ = 0;
+            continue;
+        }
+        if (filled == capacity) {
+            break;
+        }
+        
+        if (head_sent_ < segment.head.size()) {
+            const size_t length = std::min(capacity - filled, segment.head.size() - head_sent_);
+            std::memcpy(out + filled, segment.head.data() + head_sent_, length);
+            head_sent_ += length;
+            filled += length;
+            continue;
+        }
+        
+        const size_t length = static_cast<size_t>(
+            std::min<std::uint64_t>(capacity - filled, segment.region.length - range_sent_));
+        if (buffer_) {
+            std::memcpy(out + filled, buffer_->data() + segment.region.offset + range_sent_, length);
+        } else {
+            if (range_sent_ == 0) {
+                reader_.reset(segment.region);
+            }
+            bool region_done = false;
+            reader_.produce(out + filled, length, region_done);
+        }
+        range_sent_ += length;
+        filled += length;
+    }
+    done = segment_ == segments_.size();
+    return filled;
+}
+
+} // namespace https_server::http
@@ -0,0 +1,79 @@
+#ifndef HTTPS_SERVER_RANGES_HPP
+#define HTTPS_SERVER_RANGES_HPP
+
+#include "http/body.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace https_server::http {
+
+struct ByteRange {
+    std::uint64_t offset = 0;
+    std::uint64_t length = 0;
+};
+
+enum class RangeStatus {
+    // Not a byte range request we serve, so the whole representation is sent.
+    Ignored,
+    Satisfiable,
+    // Well-formed, but no range overlaps the representation: 416.
+    Unsatisfiable
+};
+
+// Most ranges served from one request. More are ignored rather than
+// served, as a set of many small ranges costs far more to send than it saves.
+constexpr size_t MAX_RANGES = 16;
+
+// Parses a Range header against a representation of 'size' bytes into
+// 'ranges', sorted, with overlapping and adjacent ranges merged.
+RangeStatus parse_range(std::string_view header, std::uint64_t size, std::vector<ByteRange>& ranges);
+
+// "bytes first-last/size" for a Content-Range header.
+std::string content_range(const ByteRange& range, std::uint64_t size);
+
+// Sends ranges of a cached buffer or an open file. A single range is sent
+// as it is; several are sent as the parts of a multipart/byteranges body,
+// read from the source as each part goes out.
+class RangesProducer final : public BodyProducer {
+public:
+    RangesProducer(SharedBuffer buffer, const std::vector<ByteRange>& ranges, std::string_view content_type);
+    RangesProducer(std::shared_ptr<const FileDescriptor> file, const std::vector<ByteRange>& ranges,
+                   std::string_view content_type);
+    
+    size_t produce(char* out, size_t capacity, bool& done) override;
+    
+    // The body's size, for its Content-Length.
+    std::uint64_t length() const noexcept { return length_; }
+    // The body's Content-Type: the one given for a single range, and
+    // "multipart/byteranges; boundary=..." for several.
+    const std::string& content_type() const noexcept { return content_type_; }
+
+private:
+    // Text sent ahead of a range: a part's boundary and headers, or, with
+    // an empty range, the closing boundary. Ranges of the buffer leave
+    // 'region.file' null.
+    struct Segment {
+        std::string head;
+        FileRegion region;
+    };
+    
+    void build(const std::shared_ptr<const FileDescriptor>& file, const std::vector<ByteRange>& ranges,
+               std::string_view content_type, std::uint64_t size);
+    
+    SharedBuffer buffer_;
+    std::vector<Segment> segments_;
+    std::string content_type_;
+    std::uint64_t length_;
+    
+    // Position: the segment, and how much of its head and range are sent.
+    size_t segment_;
+    size_t head_sent_;
+    std::uint64_t range_sent_;
+    FileRegionReader reader_;
+};
+
+} // namespace https_server::http
+
+#endif // HTTPS_SERVER_RANGES_HPP
@@ -0,0 +1,246 @@
+#include "http/router.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace https_server {
+
+namespace {
+
+constexpr std::string_view METHODS[] = {
+    "GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS", "CONNECT", "TRACE"
+};
+
+// One bit per standard method; extension methods share the last one.
+std::uint16_t method_bit(std::string_view method) noexcept {
+    for (size_t i = 0; i < sizeof(METHODS) / sizeof(METHODS[0]); ++i) {
+        if (METHODS[i] == method) {
+            return static_cast<std::uint16_t>(1u << i);
+        }
+    }
+    return static_cast<std::uint16_t>(1u << (sizeof(METHODS) / sizeof(METHODS[0])));
+}
+
+size_t common_prefix(std::string_view a, std::string_view b) noexcept {
+    size_t i = 0;
+    while (i < a.size() && i < b.size() && a[i] == b[i]) {
+        ++i;
+    }
+    return i;
+}
+
+// ':' and '*' only start a capture at the beginning of a segment.
+size_t static_length(std::string_view pattern) noexcept {
+    for (size_t i = 1; i < pattern.size(); ++i) {
+        if ((pattern[i] == ':' || pattern[i] == '*') && pattern[i - 1] == '/') {
+            return i;
+        }
+    }
+    return pattern.size();
+}
+
+} // namespace
+
+// Static children are compressed edges whose first bytes differ, listed in
+// 'indices' so the next edge is picked by one byte. A parameter child starts
+// right after a '/', and a wildcard is always a leaf.
+struct Router::Node {
+    std::string prefix;
+    std::string indices;
+    std::vector<std::unique_ptr<Node>> children;
+    std::unique_ptr<Node> param;
+    std::unique_ptr<Node> wildcard;
+    // Parameter or wildcard name, for capture nodes.
+    std::string name;
+    std::uint16_t methods = 0;
+    std::vector<Route> routes;
+    
+    const Route* route_for(std::string_view method, std::uint16_t bit) const noexcept {
+        if (!(methods & bit)) {
+            return nullptr;
+        }
+        for (const Route& route : routes) {
+            if (route.method == method) {
+                return &route;
+            }
+        }
+        return nullptr;
+    }
+    
+    Node* insert_static(std::string_view text) {
+        Node* node = this;
+        while (!text.empty()) {
+            const size_t index = node->indices.find(text[0]);
+            if (index == std::string::npos) {
+                auto child = std::make_unique<Node>();
+                child->prefix = std::string(text);
+                node->indices.push_back(text[0]);
+                node->children.push_back(std::move(child));
+                return node->children.back().get();
+            }
+            
+            Node* child = node->children[index].get();
+            const size_t common = common_prefix(child->prefix, text);
+            if (common < child->prefix.size()) {
+                // Split the edge: the child keeps the shared part and its old
+                // contents move one level down.
+                auto tail = std::make_unique<Node>(std::move(*child));
+                tail->prefix.erase(0, common);
+                *child = Node{};
+                child->prefix = std::string(text.substr(0, common));
+                child->indices.push_back(tail->prefix[0]);
+                child->children.push_back(std::move(tail));
+            }
+            text.remove_prefix(common);
+            node = child;
+        }
+        return node;
+    }
+    
+    // 'path' is what follows this node's prefix.
+    const Route* match(std::string_view path, std::string_view method, std::uint16_t bit,
+                       http::PathParams& params) const noexcept {
+        if (path.empty()) {
+            if (const Route* route = route_for(method, bit)) {
+                return route;
+            }
+        } else {
+            const size_t index = indices.find(path[0]);
+            if (index != std::string::npos) {
+                const Node& child = *children[index];
+                if (path.compare(0, child.prefix.size(), child.prefix) == 0) {
+                    if (const Route* route = child.match(path.substr(child.prefix.size()), method, bit, params)) {
+                        return route;
+                    }
+                }
+            }
+            
+            if (param) {
+                const std::string_view value = path.substr(0, path.find('/'));
+                if (!value.empty()) {
+                    params.push_back(param->name, value);
+                    if (const Route* route = param->match(path.substr(value.size()), method, bit, params)) {
+                        return route;
+                    }
+                    params.pop_back();
+                }
+            }
+        }
+        
+        if (wildcard) {
+            if (const Route* route = wildcard->route_for(method, bit)) {
+                params.push_back(wildcard->name, path);
+                return route;
+            }
+        }
+        return nullptr;
+    }
+};
+
+Router::Router() : root_(std::make_unique<Node>()) {}
+
+Router::~Router() = default;
+
+void Router::add_route(const std::string& method, const std::string& pattern, HttpHandler handler) {
+    add(method, pattern).handler = std::move(handler);
+}
+
+void Router::add_streaming_route(const std::string& method, const std::string& pattern, StreamingHandlerFactory factory) {
+    add(method, pattern).streaming_factory = std::move(factory);
+}
+
+Route& Router::add(const std::string& method, const std::string& pattern) {
+    if (pattern.empty() || pattern[0] != '/') {
+        throw std::invalid_argument("Route pattern must start with '/': " + pattern);
+    }
+    
+    // Validated up front so a rejected pattern leaves no capture nodes behind.
+    size_t captures = 0;
+    for (size_t i = 1; i <= pattern.size(); ++i) {
+        if (pattern[i - 1] != '/' || i == pattern.size() || (pattern[i] != ':' && pattern[i] != '*')) {
+            continue;
+        }
+        const size_t end = std::min(pattern.find('/', i), pattern.size());
+        if (pattern[i] == ':' && end == i + 1) {
+            throw std::invalid_argument("Route parameter needs a name: " + pattern);
+        }
+        if (pattern[i] == '*' && end != pattern.size()) {
+            throw std::invalid_argument("Route wildcard must be the last segment: " + pattern);
+        }
+        ++captures;
+    }
+    if (captures > http::PathParams::CAPACITY) {
+        throw std::invalid_argument("Route pattern has too many captures: " + pattern);
+    }
+    
+    const auto attach = [&pattern](std::unique_ptr<Node>& slot, std::string_view name) {
+        if (!slot) {
+            slot = std::make_unique<Node>();
+            slot->name = std::string(name);
+        } else if (slot->name != name) {
+            throw std::invalid_argument("Route pattern conflicts with an existing capture name: " + pattern);
+        }
+        return slot.get();
+    };
+    
+    Node* node = root_.get();
+    std::string_view rest = pattern;
+    while (!rest.empty()) {
+        if (rest[0] == ':') {
+            const std::string_view name = rest.substr(1, rest.find('/') - 1);
+            node = attach(node->param, name);
+            rest.remove_prefix(name.size() + 1);
+        } else if (rest[0] == '*') {
+            node = attach(node->wildcard, rest.size() > 1 ? rest.substr(1) : rest);
+            rest = {};
+        } else {
+            const size_t length = static_length(rest);
+            node = node->insert_static(rest.substr(0, length));
+            rest.remove_prefix(length);
+        }
+    }
+    
+    const std::uint16_t bit = method_bit(method);
+    if (node->route_for(method, bit)) {
+        throw std::invalid_argument("Route already registered: " + method + " " + pattern);
+    }
+    node->methods |= bit;
+    Route& route = node->routes.emplace_back();
+    route.method = method;
+    route.pattern = pattern;
+    return route;
+}
+
+const Route* Router::find_route(http::HttpRequest& request) const {
+    request.params.clear();
+    const std::string_view path = request.uri.substr(0, request.uri.find('?'));
+    const Route* route = root_->match(path, request.method, method_bit(request.method), request.params);
+    // HEAD falls back to the GET route; the connection drops the body.
+    if (!route && request.method == "HEAD") {
+        request.params.clear();
+        route = root_->match(path, "GET", method_bit("GET"), request.params);
+    }
+    return route;
+}
+
+const StreamingHandlerFactory* Router::find_streaming_route(http::HttpRequest& request) const {
+    const Route* route = find_route(request);
+    return route && route->streaming_factory ? &route->streaming_factory : nullptr;
+}
+
+http::HttpResponse Router::route_request(http::HttpRequest& request) const {
+    const Route* route = find_route(request);
+    if (route && route->handler) {
+        return route->handler(request);
+    }
+    
+    http::HttpResponse response;
+    response.status_code = 404;
+    response.status_text = "Not Found";
+    response.body = "<h1>404 Not Found</h1>";
+    response.headers["Content-Type"] = "text/html; charset=utf-8";
+    return response;
+}
+
+} // namespace https_server
@@ -3,67 +3,72 @@
 
 #include "http.hpp"
 #include <functional>
-#include <map>
+#include <memory>
 #include <string>
-#include <vector>
+#include <string_view>
 
 namespace https_server {
 
 using HttpHandler = std::function<http::HttpResponse(const http::HttpRequest&)>;
 
+// Consumes a request body piece by piece instead of having it buffered in
+// HttpRequest::body. on_body runs on the connection's event loop as the
+// bytes are decoded, so it should only do cheap work (hash, count, copy
+// into a bounded sink); on_complete runs on the thread pool once the whole
+// body is in and builds the response.
+class StreamingHandler {
+public:
+    virtual ~StreamingHandler() = default;
+    
+    virtual void on_body(std::string_view chunk) = 0;
+    virtual http::HttpResponse on_complete() = 0;
+};
+
+// Called on the event loop once the head is parsed. The request's views
+// (body excluded) are only valid during the call.
+using StreamingHandlerFactory = std::function<std::unique_ptr<StreamingHandler>(const http::HttpRequest&)>;
+
 struct Route {
     std::string pattern;
     std::string method;
     HttpHandler handler;
-    bool is_wildcard;
+    StreamingHandlerFactory streaming_factory;
 };
 
+// Routes are kept in a radix tree over the path, with one node per distinct
+// prefix and the routes for each method at the node their pattern ends on.
+// A segment of the form ':name' matches one non-empty path segment and a
+// trailing '*' or '*name' matches the rest of the path, possibly empty; both
+// are captured into HttpRequest::params. Static text wins over a parameter,
+// which wins over a wildcard, regardless of registration order. Lookup only
+// considers the path up to '?', costs O(path length) and never allocates.
+// Routes are added at startup, before the router is shared with the loops.
 class Router {
 public:
-    void add_route(const std::string& method, const std::string& pattern, HttpHandler handler) {
-        Route route;
-        route.method = method;
-        route.pattern = pattern;
-        route.handler = std::move(handler);
-        route.is_wildcard = pattern.find('*') != std::string::npos;
-        
-        routes_.push_back(route);
-    }
-
-    http::HttpResponse route_request(const http::HttpRequest& request) const {
-        for (const auto& route : routes_) {
-            if (route.method != request.method) {
-                continue;
-            }
-            
-            if (matches_pattern(route.pattern, request.uri)) {
-                return route.handler(request);
-            }
-        }
-        
-        http::HttpResponse response;
-        response.status_code = 404;
-        response.status_text = "Not Found";
-        response.body = "<h1>404 Not Found</h1>";
-        response.headers["Content-Type"] = "text/html; charset=utf-8";
-        return response;
-    }
+    Router();
+    ~Router();
+    
+    Router(const Router&) = delete;
+    Router& operator=(const Router&) = delete;
+    
+    // Throw std::invalid_argument for a malformed pattern, for one that
+    // names a parameter differently from an overlapping route, and for a
+    // method and pattern that are already registered.
+    void add_route(const std::string& method, const std::string& pattern, HttpHandler handler);
+    void add_streaming_route(const std::string& method, const std::string& pattern, StreamingHandlerFactory factory);
+    
+    // The factory of the route matching 'request', if that route streams.
+    // Both lookups fill request.params.
+    const StreamingHandlerFactory* find_streaming_route(http::HttpRequest& request) const;
+    http::HttpResponse route_request(http::HttpRequest& request) const;
 
 private:
-    std::vector<Route> routes_;
+    struct Node;
+    
+    Route& add(const std::string& method, const std::string& pattern);
+    const Route* find_route(http::HttpRequest& request) const;
     
-    bool matches_pattern(const std::string& pattern, const std::string& uri) const {
-        if (pattern.find('*') == std::string::npos) {
-            return pattern == uri;
-        }
-        
-        if (pattern.back() == '*' && pattern.size() > 1 && pattern[pattern.size()-2] == '/') {
-            const std::string prefix = pattern.substr(0, pattern.size() - 1);
-            return uri.substr(0, prefix.size()) == prefix;
-        }
-        
-        return pattern == uri;
-    }
+    std::unique_ptr<Node> root_;
 };
 
 }
@@ -1,14 +1,15 @@
 #include "http/static_handler.hpp"
 #include "utils/logger.hpp"
 #include "utils/compression_suite.hpp"
-#include <fstream>
-#include <sstream>
+#include "http/ranges.hpp"
+#include <string_view>
 #include <vector>
 
 namespace https_server {
 
-StaticHandler::StaticHandler(const std::string& web_root) 
-    : web_root_(web_root) {
+StaticHandler::StaticHandler(const std::string& web_root, size_t cache_size, size_t max_cached_file_size)
+    : web_root_(web_root),
+      file_cache_(web_root, cache_size, max_cached_file_size) {
     init_mime_types();
 }
 
@@ -33,46 +34,147 @@ void StaticHandler::init_mime_types() {
 http::HttpResponse StaticHandler::handle(const http::HttpRequest& request) {
     http::HttpResponse response;
     
-    std::string file_path = request.uri;
-    if (file_path.empty() || file_path == "/") {
+    std::string file_path = normalize_path(std::string(request.uri));
+    if (file_path == "/") {
         file_path = "/index.html";
     }
     
-    file_path = normalize_path(file_path);
-    
     if (!is_safe_path(file_path)) {
         return load_error_page(403, "Forbidden");
     }
     
-    const std::string full_path = web_root_ + file_path;
-    
-    LOG_DEBUG("Trying to serve file: " + full_path);
-    
-    std::ifstream file(full_path, std::ios::binary);
-    if (!file.is_open()) {
-        LOG_WARNING("File not found: " + full_path);
-        return load_error_page(404, "Not Found");
+    // A file too large to cache is opened but not read until it is sent,
+    // and described by its metadata instead of its contents.
+    const std::shared_ptr<const FileCache::File> file = file_cache_.get(file_path);
+    std::shared_ptr<const http::FileDescriptor> descriptor;
+    http::Validators described;
+    if (!file) {
+        descriptor = http::FileDescriptor::open(web_root_ + file_path);
+        if (!descriptor) {
+            LOG_WARNING("File not found: " + web_root_ + file_path);
+            return load_error_page(404, "Not Found");
+        }
+        described = describe(*descriptor);
     }
-    
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string content = buffer.str();
+    const http::Validators& validators = file ? file->validators : described;
     
     const std::string content_type = get_content_type(file_path);
+    const bool compressible = file && compression::CompressionOps::instance()
+        .should_compress(content_type, file->content.size());
+    if (not_modified(request, validators, compressible, response)) {
+        return response;
+    }
+    
     response.headers["Content-Type"] = content_type;
+    response.headers["Last-Modified"] = validators.last_modified;
+    response.headers["Accept-Ranges"] = "bytes";
     
-    const std::string accept_encoding = get_accept_encoding(request);
+    if (serve_ranges(request, file, descriptor, validators, response)) {
+        return response;
+    }
     
-    if (!try_serve_compressed(file_path, content, content_type, accept_encoding, response)) {
-        response.body = content;
+    if (file) {
+        const std::string accept_encoding = get_accept_encoding(request);
+        if (!try_serve_compressed(file_path, *file, content_type, accept_encoding, response)) {
+            // Shares ownership of the cached file rather than copying it.
+            response.body_source = http::SharedBuffer(file, &file->content);
+            response.headers["ETag"] = validators.etag;
+        }
+    } else {
+        stream_file(std::move(descriptor), response);
+        response.headers["ETag"] = validators.etag;
     }
     
-    LOG_INFO("Served file: " + file_path + " (" + content_type + ", " + 
-             std::to_string(response.body.size()) + " bytes)");
+    // Debug only: logging every hit at Info would cost a write per request.
+    LOG_DEBUG("Served file: " + file_path + " (" + content_type + ", " + 
+              std::to_string(response.body_size()) + " bytes)");
     
     return response;
 }
 
+bool StaticHandler::not_modified(const http::HttpRequest& request, const http::Validators& validators,
+                                 bool compressible, http::HttpResponse& response) const {
+    // If-Modified-Since only counts without If-None-Match (RFC 9110 13.2.2).
+    std::string_view etag;
+    if (const std::string_view* if_none_match = request.find_header("If-None-Match")) {
+        etag = http::match_etag(*if_none_match, validators.etag);
+        if (etag.empty()) {
+            return false;
+        }
+    } else if (const std::string_view* if_modified_since = request.find_header("If-Modified-Since")) {
+        const std::int64_t since = http::parse_http_date(*if_modified_since);
+        if (since < 0 || validators.modified > since) {
+            return false;
+        }
+        etag = validators.etag;
+    } else {
+        return false;
+    }
+    
+    // Carries the tag of the representation the client has, which may be
+    // a compressed one, and nothing that describes a body.
+    response.status_code = 304;
+    response.status_text = "Not Modified";
+    response.headers["ETag"] = etag;
+    if (compressible) {
+        response.headers["Vary"] = "Accept-Encoding";
+    }
+    return true;
+}
+
+bool StaticHandler::serve_ranges(const http::HttpRequest& request,
+                                 const std::shared_ptr<const FileCache::File>& file,
+                                 std::shared_ptr<const http::FileDescriptor>& descriptor,
+                                 const http::Validators& validators, http::HttpResponse& response) const {
+    const std::string_view* range = request.find_header("Range");
+    if (!range) {
+        return false;
+    }
+    // A Range meant for another version of the file gets the whole of this one.
+    const std::string_view* if_range = request.find_header("If-Range");
+    if (if_range && !http::if_range_matches(*if_range, validators)) {
+        return false;
+    }
+    
+    const std::uint64_t size = file ? file->content.size() : descriptor->size();
+    std::vector<http::ByteRange> ranges;
+    switch (http::parse_range(*range, size, ranges)) {
+        case http::RangeStatus::Ignored:
+            return false;
+        case http::RangeStatus::Unsatisfiable:
+            response.status_code = 416;
+            response.status_text = "Range Not Satisfiable";
+            response.headers["Content-Range"] = "bytes */" + std::to_string(size);
+            return true;
+        case http::RangeStatus::Satisfiable:
+            break;
+    }
+    
+    // Ranges are of the unencoded file, so they are never compressed.
+    response.status_code = 206;
+    response.status_text = "Partial Content";
+    response.headers["ETag"] = validators.etag;
+    if (ranges.size() == 1) {
+        response.headers["Content-Range"] = http::content_range(ranges.front(), size);
+        if (descriptor) {
+            // Sent like a whole file that is not cached, straight from the
+            // descriptor by offset.
+            response.body_source = http::FileRegion{std::move(descriptor), ranges.front().offset,
+                                                    ranges.front().length};
+            return true;
+        }
+    }
+    
+    const std::string_view content_type = response.headers["Content-Type"];
+    std::unique_ptr<http::RangesProducer> producer = file
+        ? std::make_unique<http::RangesProducer>(http::SharedBuffer(file, &file->content), ranges, content_type)
+        : std::make_unique<http::RangesProducer>(std::move(descriptor), ranges, content_type);
+    response.headers["Content-Type"] = producer->content_type();
+    response.headers["Content-Length"] = std::to_string(producer->length());
+    response.producer = std::move(producer);
+    return true;
+}
+
 http::HttpResponse StaticHandler::load_error_page(int code, const std::string& status_text) {
     http::HttpResponse response;
     response.status_code = code;
@@ -80,13 +182,19 @@ http::HttpResponse StaticHandler::load_error_page(int code, const std::string& s
     response.headers["Content-Type"] = "text/html; charset=utf-8";
     
     std::string error_file = "/error-" + std::to_string(code) + ".html";
-    std::ifstream file(web_root_ + error_file, std::ios::binary);
+    const std::shared_ptr<const FileCache::File> file = file_cache_.get(error_file);
+    std::shared_ptr<const http::FileDescriptor> descriptor;
+    if (!file) {
+        descriptor = http::FileDescriptor::open(web_root_ + error_file);
+    }
     
-    if (file.is_open()) {
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        response.body = buffer.str();
-        LOG_INFO("Served error page: " + error_file);
+    if (file || descriptor) {
+        if (file) {
+            response.body_source = http::SharedBuffer(file, &file->content);
+        } else {
+            stream_file(std::move(descriptor), response);
+        }
+        LOG_DEBUG("Served error page: " + error_file);
     } else {
         response.body = "<h1>" + std::to_string(code) + " " + status_text + "</h1>";
         LOG_WARNING("Error page not found: " + error_file);
@@ -95,6 +203,28 @@ http::HttpResponse StaticHandler::load_error_page(int code, const std::string& s
     return response;
 }
 
+void StaticHandler::stream_file(std::shared_ptr<const http::FileDescriptor> descriptor,
+                                http::HttpResponse& response) {
+    // Too large for the cache: sent straight from the file in record-sized
+    // reads, so memory use does not grow with the file or the number of
+    // clients downloading it.
+    const std::uint64_t size = descriptor->size();
+    response.body_source = http::FileRegion{std::move(descriptor), 0, size};
+}
+
+http::Validators StaticHandler::describe(const http::FileDescriptor& descriptor) {
+    // Hashing the contents would mean reading the whole file for every
+    // version. Its inode, size and mtime change with the contents, so the
+    // tag stays strong in practice at the cost of one block of SHA-256.
+    http::Validators validators;
+    validators.etag = http::make_etag(std::to_string(descriptor.inode()) + "-" +
+                                      std::to_string(descriptor.size()) + "-" +
+                                      std::to_string(descriptor.modified_ns()));
+    validators.modified = descriptor.modified_ns() / 1000000000;
+    validators.last_modified = http::format_http_date(validators.modified);
+    return validators;
+}
+
 std::string StaticHandler::get_content_type(const std::string& file_path) const {
     const size_t dot_pos = file_path.find_last_of('.');
     if (dot_pos == std::string::npos) {
@@ -111,23 +241,41 @@ bool StaticHandler::is_safe_path(const std::string& requested_path) const {
 }
 
 std::string StaticHandler::normalize_path(const std::string& path) const {
-    std::string normalized = path;
-    for (char& c : normalized) {
-        if (c == '\\') c = '/';
+    // One spelling per file, since this is the cache key: the query and
+    // fragment are dropped, backslashes separate segments like slashes,
+    // and empty and "." segments are skipped.
+    const std::string_view raw = std::string_view(path).substr(0, path.find_first_of("?#"));
+    std::string normalized;
+    normalized.reserve(raw.size() + 1);
+    
+    size_t start = 0;
+    while (start <= raw.size()) {
+        size_t end = raw.find_first_of("/\\", start);
+        if (end == std::string_view::npos) {
+            end = raw.size();
+        }
+        const std::string_view segment = raw.substr(start, end - start);
+        if (!segment.empty() && segment != ".") {
+            normalized += '/';
+            normalized += segment;
+        }
+        start = end + 1;
     }
-    return normalized;
+    
+    return normalized.empty() ? "/" : normalized;
 }
 
 std::string StaticHandler::get_accept_encoding(const http::HttpRequest& request) const {
-    auto it = request.headers.find("Accept-Encoding");
-    return (it != request.headers.end()) ? it->second : "";
+    const std::string_view* accept_encoding = request.find_header("Accept-Encoding");
+    return accept_encoding ? std::string(*accept_encoding) : std::string();
 }
 
 bool StaticHandler::try_serve_compressed(const std::string& file_path, 
-                                         const std::string& content,
+                                         const FileCache::File& file,
                                          const std::string& content_type,
                                          const std::string& accept_encoding,
                                          http::HttpResponse& response) {
+    const std::string& content = file.content;
     if (!compression::CompressionOps::instance().should_compress(content_type, content.size())) {
         return false;
     }
@@ -137,8 +285,10 @@ bool StaticHandler::try_serve_compressed(const std::string& file_path,
     const std::string cache_key = file_path + ":" + accept_encoding;
     auto cache_it = compression_cache_.find(cache_key);
     
-    if (cache_it != compression_cache_.end()) {
-        response.body = cache_it->second.data;
+    // An entry for an older version of the file is replaced below.
+    if (cache_it != compression_cache_.end() && cache_it->second.version == file.version) {
+        response.body_source = cache_it->second.data;
+        response.headers["ETag"] = cache_it->second.etag;
         response.headers["Content-Encoding"] = cache_it->second.encoding;
         response.headers["Vary"] = "Accept-Encoding";
         return true;
@@ -152,13 +302,16 @@ bool StaticHandler::try_serve_compressed(const std::string& file_path,
     }
     
     CompressedCache cached_result;
-    cached_result.data = compressed;
+    cached_result.data = std::make_shared<const std::string>(std::move(compressed));
     cached_result.encoding = encoding_used;
     cached_result.original_size = content.size();
+    cached_result.version = file.version;
+    cached_result.etag = http::coded_etag(file.validators.etag, encoding_used);
     
-    compression_cache_[cache_key] = cached_result;
+    response.body_source = cached_result.data;
+    response.headers["ETag"] = cached_result.etag;
+    compression_cache_[cache_key] = std::move(cached_result);
     
-    response.body = compressed;
     response.headers["Content-Encoding"] = encoding_used;
     response.headers["Vary"] = "Accept-Encoding";
     
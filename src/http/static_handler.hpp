@@ -1,27 +1,44 @@
 #ifndef HTTPS_SERVER_STATIC_HANDLER_HPP
 #define HTTPS_SERVER_STATIC_HANDLER_HPP
 
+#include "http/file_cache.hpp"
 #include "http/http.hpp"
+#include "http/validators.hpp"
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <map>
 #include <mutex>
 
 namespace https_server {
 
+// Compressed copy of one version of a file.
 struct CompressedCache {
-    std::string data;
+    std::shared_ptr<const std::string> data;
     std::string encoding;
     size_t original_size;
+    std::uint64_t version;
+    // The file's strong ETag, marked with the encoding.
+    std::string etag;
 };
 
+// Serves files under 'web_root' from a FileCache, so a hit shares the
+// cached bytes with the response instead of reading or copying them. Files
+// too large to cache are streamed from disk. Responses carry an ETag and
+// Last-Modified, and conditional requests that match get a 304 before any
+// contents are read or compressed. Byte ranges are sent from the cached
+// bytes or the file by offset, several as multipart/byteranges.
 class StaticHandler {
 public:
-    explicit StaticHandler(const std::string& web_root);
+    explicit StaticHandler(const std::string& web_root,
+                           size_t cache_size = 64 * 1024 * 1024,
+                           size_t max_cached_file_size = 1024 * 1024);
     
     http::HttpResponse handle(const http::HttpRequest& request);
 
 private:
     std::string web_root_;
+    FileCache file_cache_;
     std::map<std::string, std::string> mime_types_;
     std::map<std::string, CompressedCache> compression_cache_;
     std::mutex cache_mutex_;
@@ -31,10 +48,21 @@ private:
     bool is_safe_path(const std::string& requested_path) const;
     std::string normalize_path(const std::string& path) const;
     http::HttpResponse load_error_page(int code, const std::string& status_text);
+    void stream_file(std::shared_ptr<const http::FileDescriptor> descriptor, http::HttpResponse& response);
+    static http::Validators describe(const http::FileDescriptor& descriptor);
+    // Turns 'response' into a 304 when the request's conditional headers
+    // match 'validators'.
+    bool not_modified(const http::HttpRequest& request, const http::Validators& validators,
+                      bool compressible, http::HttpResponse& response) const;
+    // Answers a Range request with 206 or 416, taking the descriptor of a
+    // file that is not cached. Returns false when the whole file is sent.
+    bool serve_ranges(const http::HttpRequest& request, const std::shared_ptr<const FileCache::File>& file,
+                      std::shared_ptr<const http::FileDescriptor>& descriptor,
+                      const http::Validators& validators, http::HttpResponse& response) const;
     
     std::string get_accept_encoding(const http::HttpRequest& request) const;
     bool try_serve_compressed(const std::string& file_path, 
-                              const std::string& content,
+                              const FileCache::File& file,
                               const std::string& content_type,
                               const std::string& accept_encoding,
                               http::HttpResponse& response);
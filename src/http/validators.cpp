@@ -0,0 +1,288 @@
+#include "http/validators.hpp"
+#include "crypto/sha256.hpp"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace https_server::http {
+
+namespace {
+
+constexpr const char* DAYS[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+constexpr const char* MONTHS[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                  "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+// Days from 1970-01-01 to a date in the proleptic Gregorian calendar.
+std::int64_t days_from_civil(std::int64_t year, unsigned month, unsigned day) noexcept {
+    year -= month <= 2;
+    const std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned year_of_era = static_cast<unsigned>(year - era * 400);
+    const unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + static_cast<std::int64_t>(day_of_era) - 719468;
+}
+
+// Reads fields of an HTTP-date left to right; any mismatch sets 'failed'.
+class DateReader {
+public:
+    explicit DateReader(std::string_view text) noexcept : text_(text) {}
+    
+    bool failed() const noexcept { return failed_; }
+    bool at_end() const noexcept { return text_.empty(); }
+    
+    void expect(char c) noexcept {
+        if (text_.empty() || text_.front() != c) {
+            failed_ = true;
+            return;
+        }
+        text_.remove_prefix(1);
+    }
+    
+    void skip_spaces() noexcept {
+        while (!text_.empty() && text_.front() == ' ') {
+            text_.remove_prefix(1);
+        }
+    }
+    
+    // 'min_digits' to 'max_digits' decimal digits.
+    int number(size_t min_digits, size_t max_digits) noexcept {
+        int value = 0;
+        size_t digits = 0;
+        while (digits < max_digits && !text_.empty() && text_.front() >= '0' && text_.front() <= '9') {
+            value = value * 10 + (text_.front() - '0');
+            text_.remove_prefix(1);
+            ++digits;
+        }
+        if (digits < min_digits) {
+            failed_ = true;
+        }
+        return value;
+    }
+    
+    // A month name, as 1 to 12.
+    unsigned month() noexcept {
+        for (unsigned i = 0; i < 12; ++i) {
+            if (text_.substr(0, 3) == MONTHS[i]) {
+                text_.remove_prefix(3);
+                return i + 1;
+            }
+        }
+        failed_ = true;
+        return 1;
+    }
+    
+    // The day name, which only has to be letters since the date is
+    // authoritative.
+    void day_name() noexcept {
+        size_t length = 0;
+        while (length < text_.size() && ((text_[length] >= 'A' && text_[length] <= 'Z') ||
+                                         (text_[length] >= 'a' && text_[length] <= 'z'))) {
+            ++length;
+        }
+        if (length < 3) {
+            failed_ = true;
+        }
+        text_.remove_prefix(length);
+    }
+    
+    void time_of_day(int& hour, int& minute, int& second) noexcept {
+        hour = number(2, 2);
+        expect(':');
+        minute = number(2, 2);
+        expect(':');
+        second = number(2, 2);
+    }
+
+private:
+    std::string_view text_;
+    bool failed_ = false;
+};
+
+} // namespace
+
+std::array<std::uint8_t, 32> sha256(std::string_view data) noexcept {
+    std::uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                              0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    
+    const auto* input = reinterpret_cast<const std::uint8_t*>(data.data());
+    const size_t whole = data.size() - data.size() % 64;
+    for (size_t offset = 0; offset < whole; offset += 64) {
+        sha256_block_asm(input + offset, state);
+    }
+    
+    // The tail, 0x80, zeros and the length in bits take one or two blocks.
+    std::uint8_t tail[128] = {};
+    const size_t rest = data.size() - whole;
+    if (rest > 0) {
+        std::memcpy(tail, input + whole, rest);
+    }
+    tail[rest] = 0x80;
+    const size_t tail_size = rest < 56 ? 64 : 128;
+    const std::uint64_t bits = static_cast<std::uint64_t>(data.size()) * 8;
+    for (size_t i = 0; i < 8; ++i) {
+        tail[tail_size - 1 - i] = static_cast<std::uint8_t>(bits >> (8 * i));
+    }
+    for (size_t offset = 0; offset < tail_size; offset += 64) {
+        sha256_block_asm(tail + offset, state);
+    }
+    
+    std::array<std::uint8_t, 32> digest;
+    for (size_t i = 0; i < 8; ++i) {
+        digest[i * 4 + 0] = static_cast<std::uint8_t>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<std::uint8_t>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<std::uint8_t>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<std::uint8_t>(state[i]);
+    }
+    return digest;
+}
+
+std::string make_etag(std::string_view data) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    const std::array<std::uint8_t, 32> digest = sha256(data);
+    
+    std::string etag;
+    etag.reserve(34);
+    etag += '"';
+    for (size_t i = 0; i < 16; ++i) {
+        etag += HEX[digest[i] >> 4];
+        etag += HEX[digest[i] & 0xf];
+    }
+    etag += '"';
+    return etag;
+}
+
+std::string coded_etag(std::string_view etag, std::string_view coding) {
+    std::string coded(etag.substr(0, etag.size() - 1));
+    coded += '-';
+    coded += coding;
+    coded += '"';
+    return coded;
+}
+
+std::string_view match_etag(std::string_view if_none_match, std::string_view etag) noexcept {
+    // The opening quote and hex of 'etag', which a coded tag extends.
+    const std::string_view stem = etag.substr(0, etag.size() - 1);
+    
+    size_t position = 0;
+    while (position < if_none_match.size()) {
+        const char c = if_none_match[position];
+        if (c == ' ' || c == '\t' || c == ',') {
+            ++position;
+            continue;
+        }
+        if (c == '*') {
+            return etag;
+        }
+        if (if_none_match.compare(position, 2, "W/") == 0) {
+            position += 2;
+        }
+        if (position >= if_none_match.size() || if_none_match[position] != '"') {
+            return {};
+        }
+        const size_t close = if_none_match.find('"', position + 1);
+        if (close == std::string_view::npos) {
+            return {};
+        }
+        const std::string_view tag = if_none_match.substr(position, close + 1 - position);
+        if (tag == etag || (tag.size() > etag.size() && tag.compare(0, stem.size(), stem) == 0 &&
+                            tag[stem.size()] == '-')) {
+            return tag;
+        }
+        position = close + 1;
+    }
+    return {};
+}
+
+bool if_range_matches(std::string_view if_range, const Validators& validators) noexcept {
+    while (!if_range.empty() && (if_range.front() == ' ' || if_range.front() == '\t')) {
+        if_range.remove_prefix(1);
+    }
+    while (!if_range.empty() && (if_range.back() == ' ' || if_range.back() == '\t')) {
+        if_range.remove_suffix(1);
+    }
+    if (if_range.empty() || if_range.compare(0, 2, "W/") == 0) {
+        return false;
+    }
+    if (if_range.front() == '"') {
+        return if_range == validators.etag;
+    }
+    return parse_http_date(if_range) == validators.modified;
+}
+
+std::string format_http_date(std::int64_t seconds) {
+    const std::time_t time = static_cast<std::time_t>(seconds);
+    std::tm utc{};
+#ifdef _WIN32
+    gmtime_s(&utc, &time);
+#else
+    gmtime_r(&time, &utc);
+#endif
+    char date[32];
+    const int written = std::snprintf(date, sizeof(date), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+                                      DAYS[utc.tm_wday], utc.tm_mday, MONTHS[utc.tm_mon], utc.tm_year + 1900,
+                                      utc.tm_hour, utc.tm_min, utc.tm_sec);
+    return std::string(date, written > 0 ? static_cast<size_t>(written) : 0);
+}
+
+std::int64_t parse_http_date(std::string_view date) noexcept {
+    DateReader reader(date);
+    int year = 0;
+    unsigned month = 1;
+    int day = 0;
+    int hour = 0;
+    int minute = 0;
+    int second = 0;
+    
+    reader.day_name();
+    if (date.size() > 3 && date[3] == ',') {
+        // IMF-fixdate: "Sun, 06 Nov 1994 08:49:37 GMT".
+        reader.expect(',');
+        reader.expect(' ');
+        day = reader.number(2, 2);
+        reader.expect(' ');
+        month = reader.month();
+        reader.expect(' ');
+        year = reader.number(4, 4);
+        reader.expect(' ');
+        reader.time_of_day(hour, minute, second);
+        reader.expect(' ');
+        reader.expect('G');
+        reader.expect('M');
+        reader.expect('T');
+    } else if (date.find(',') != std::string_view::npos) {
+        // Obsolete RFC 850: "Sunday, 06-Nov-94 08:49:37 GMT". Two-digit
+        // years are taken as the closest, which is what clients mean.
+        reader.expect(',');
+        reader.expect(' ');
+        day = reader.number(2, 2);
+        reader.expect('-');
+        month = reader.month();
+        reader.expect('-');
+        year = reader.number(2, 2);
+        year += year < 70 ? 2000 : 1900;
+        reader.expect(' ');
+        reader.time_of_day(hour, minute, second);
+        reader.expect(' ');
+        reader.expect('G');
+        reader.expect('M');
+        reader.expect('T');
+    } else {
+        // asctime: "Sun Nov  6 08:49:37 1994".
+        reader.expect(' ');
+        month = reader.month();
+        reader.expect(' ');
+        reader.skip_spaces();
+        day = reader.number(1, 2);
+        reader.expect(' ');
+        reader.time_of_day(hour, minute, second);
+        reader.expect(' ');
+        year = reader.number(4, 4);
+    }
+    
+    if (reader.failed() || !reader.at_end() || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return -1;
+    }
+    return days_from_civil(year, month, static_cast<unsigned>(day)) * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+} // namespace https_server::http
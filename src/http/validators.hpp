@@ -0,0 +1,51 @@
+#ifndef HTTPS_SERVER_VALIDATORS_HPP
+#define HTTPS_SERVER_VALIDATORS_HPP
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace https_server::http {
+
+// What a conditional request is checked against.
+struct Validators {
+    // Quoted strong entity tag of the unencoded representation.
+    std::string etag;
+    // Modification time, in seconds since the epoch and as an HTTP-date.
+    std::int64_t modified = 0;
+    std::string last_modified;
+};
+
+// SHA-256 of 'data', run through sha256_block_asm. Whole blocks are hashed
+// in place; only the padded tail is copied.
+std::array<std::uint8_t, 32> sha256(std::string_view data) noexcept;
+
+// A strong entity tag for 'data': the first 128 bits of its SHA-256 as
+// quoted hex.
+std::string make_etag(std::string_view data);
+
+// The same tag for the representation of 'etag' in a content coding, such
+// as "br". Its bytes differ, so a strong tag has to as well.
+std::string coded_etag(std::string_view etag, std::string_view coding);
+
+// Whether an If-None-Match value lists 'etag' or a coded_etag of it, using
+// the weak comparison RFC 9110 asks for. Returns the listed tag that
+// matched, for the 304 to carry, or an empty view.
+std::string_view match_etag(std::string_view if_none_match, std::string_view etag) noexcept;
+
+// Whether an If-Range value still describes the representation, so its
+// Range applies. Entity tags are compared strongly, and a date has to be
+// exactly the modification time (RFC 9110 13.1.5).
+bool if_range_matches(std::string_view if_range, const Validators& validators) noexcept;
+
+// 'seconds' since the epoch as an IMF-fixdate, "Sun, 06 Nov 1994 08:49:37 GMT".
+std::string format_http_date(std::int64_t seconds);
+
+// Seconds since the epoch of an HTTP-date in any of its three forms, or -1
+// when 'date' is not one.
+std::int64_t parse_http_date(std::string_view date) noexcept;
+
+} // namespace https_server::http
+
+#endif // HTTPS_SERVER_VALIDATORS_HPP
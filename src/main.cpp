@@ -12,9 +12,56 @@
 #include <cstdlib>
 #include <iomanip>
 #include <sstream>
+#include <openssl/evp.h>
 
 using json = nlohmann::json;
 
+// Hashes an upload as it streams in, so the body is never held in memory.
+class UploadDigest : public https_server::StreamingHandler {
+public:
+    UploadDigest(const https_server::ServerConfig& config, std::string content_type)
+        : config_(config), content_type_(std::move(content_type)), ctx_(EVP_MD_CTX_new()), bytes_(0) {
+        if (!ctx_ || EVP_DigestInit_ex(ctx_, EVP_sha256(), nullptr) != 1) {
+            EVP_MD_CTX_free(ctx_);
+            throw std::runtime_error("Failed to initialize SHA-256");
+        }
+    }
+    
+    ~UploadDigest() override {
+        EVP_MD_CTX_free(ctx_);
+    }
+    
+    void on_body(std::string_view chunk) override {
+        EVP_DigestUpdate(ctx_, chunk.data(), chunk.size());
+        bytes_ += chunk.size();
+    }
+    
+    https_server::http::HttpResponse on_complete() override {
+        unsigned char digest[EVP_MAX_MD_SIZE];
+        unsigned int digest_len = 0;
+        EVP_DigestFinal_ex(ctx_, digest, &digest_len);
+        
+        json response_json;
+        response_json["status"] = "success";
+        response_json["bytes"] = bytes_;
+        response_json["content_type"] = content_type_;
+        response_json["sha256"] = https_server::network_ops::NetworkOps::instance()
+            .encode_hex(std::string(reinterpret_cast<const char*>(digest), digest_len));
+        
+        https_server::http::HttpResponse response;
+        response.security_config = &config_.security;
+        response.headers["Content-Type"] = "application/json; charset=utf-8";
+        response.body = response_json.dump(2);
+        return response;
+    }
+
+private:
+    const https_server::ServerConfig& config_;
+    std::string content_type_;
+    EVP_MD_CTX* ctx_;
+    size_t bytes_;
+};
+
 int main() {
     try {
         const auto config = https_server::Config::load();
@@ -25,7 +72,9 @@ int main() {
         https_server::Server server(config);
         auto& router = server.get_router();
 
-        https_server::StaticHandler static_handler(config.web_root);
+        https_server::StaticHandler static_handler(config.web_root,
+                                                   static_cast<size_t>(config.static_cache_size),
+                                                   static_cast<size_t>(config.static_cache_max_file_size));
 
         router.add_route("GET", "/", [&static_handler, &config](const https_server::http::HttpRequest& req) {
             https_server::http::HttpRequest index_req = req;
@@ -102,6 +151,32 @@ int main() {
             return response;
         });
 
+        router.add_route("GET", "/api/stats", [&server, &config](const https_server::http::HttpRequest&) {
+            const auto& admission = server.admission();
+            const auto& stats = admission.stats();
+            
+            https_server::http::HttpResponse response;
+            response.security_config = &config.security;
+            response.headers["Content-Type"] = "application/json; charset=utf-8";
+            response.headers["Cache-Control"] = "no-store";
+            
+            json response_json;
+            response_json["admission"]["admitted"] = stats.admitted.load(std::memory_order_relaxed);
+            response_json["admission"]["shed"] = stats.shed.load(std::memory_order_relaxed);
+            response_json["admission"]["rejected_connections"] = stats.rejected_connections.load(std::memory_order_relaxed);
+            response_json["admission"]["limit"] = admission.limit();
+            response_json["admission"]["in_flight"] = admission.in_flight();
+            response_json["admission"]["connections"] = admission.connections();
+            
+            const auto& tls = server.tls_stats();
+            response_json["tls"]["handshakes"] = tls.handshakes.load(std::memory_order_relaxed);
+            response_json["tls"]["ktls_send"] = tls.ktls_send.load(std::memory_order_relaxed);
+            response_json["tls"]["ktls_recv"] = tls.ktls_recv.load(std::memory_order_relaxed);
+            
+            response.body = response_json.dump(2);
+            return response;
+        });
+        
         router.add_route("POST", "/api/echo", [&config](const https_server::http::HttpRequest& req) {
             std::string request_id = https_server::Logger::instance().generate_request_id();
             
@@ -121,7 +196,7 @@ int main() {
                     response.status_text = "Bad Request";
                 } else {
                     auto validation_result = https_server::validation::ValidationOps::instance()
-                        .json_validate_fast(req.body.c_str(), req.body.size());
+                        .json_validate_fast(req.body.data(), req.body.size());
                     
                     if (validation_result != https_server::validation::ValidationResult::VALID) {
                         json error_response;
@@ -147,7 +222,7 @@ int main() {
                         response.status_code = 400;
                         response.status_text = "Bad Request";
                     } else {
-                        json request_json = json::parse(req.body);
+                        json request_json = json::parse(req.body.begin(), req.body.end());
                         
                         json response_json = request_json;
                         response_json["received"] = true;
@@ -181,6 +256,11 @@ int main() {
             return response;
         });
 
+        router.add_streaming_route("POST", "/api/upload", [&config](const https_server::http::HttpRequest& req) {
+            const std::string_view* content_type = req.find_header("Content-Type");
+            return std::make_unique<UploadDigest>(config, content_type ? std::string(*content_type) : std::string());
+        });
+        
         router.add_route("GET", "/style.css", [&static_handler, &config](const https_server::http::HttpRequest& req) {
             auto response = static_handler.handle(req);
             response.security_config = &config.security;
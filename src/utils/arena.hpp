@@ -0,0 +1,118 @@
+#ifndef HTTPS_SERVER_ARENA_HPP
+#define HTTPS_SERVER_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace https_server {
+
+// Monotonic memory resource for objects that live as long as one request.
+// Deallocation is a no-op; reset() rewinds to the first block and keeps
+// every block for the next request, so once a connection has served its
+// largest request it stops calling the global allocator. Allocations above
+// LARGE_ALLOCATION (big bodies) go to the heap and back on deallocate, so
+// they are not held for the life of the connection.
+// Not thread safe: one request's handler uses it at a time.
+class Arena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t LARGE_ALLOCATION = 64 * 1024;
+    
+    explicit Arena(size_t first_block_size = 8192) noexcept
+        : first_block_size_(first_block_size), current_(0), offset_(0) {}
+    
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    
+    // Everything allocated since the last reset must be destroyed by now.
+    void reset() noexcept {
+        current_ = 0;
+        offset_ = 0;
+    }
+    
+    size_t block_count() const noexcept { return blocks_.size(); }
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+    
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (bytes > LARGE_ALLOCATION) {
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        
+        while (true) {
+            if (current_ < blocks_.size()) {
+                const Block& block = blocks_[current_];
+                const auto base = reinterpret_cast<std::uintptr_t>(block.data.get());
+                const size_t start = ((base + offset_ + alignment - 1) & ~(alignment - 1)) - base;
+                if (start + bytes <= block.size) {
+                    offset_ = start + bytes;
+                    return block.data.get() + start;
+                }
+                ++current_;
+                offset_ = 0;
+                continue;
+            }
+            
+            // Each block doubles the last, up to what the largest allocation
+            // needs, so a request settles into a few blocks.
+            size_t size = blocks_.empty() ? first_block_size_ : blocks_.back().size * 2;
+            while (size < bytes + alignment) {
+                size *= 2;
+            }
+            blocks_.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+        }
+    }
+    
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+        if (bytes > LARGE_ALLOCATION) {
+            std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+        }
+    }
+    
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+    
+    std::vector<Block> blocks_;
+    size_t first_block_size_;
+    size_t current_;
+    size_t offset_;
+};
+
+// The slot behind request_resource().
+inline std::pmr::memory_resource*& request_resource_slot() noexcept {
+    thread_local std::pmr::memory_resource* resource = nullptr;
+    return resource;
+}
+
+// What per-request objects built on this thread draw from: the arena of the
+// innermost ArenaScope, or the global heap outside one.
+inline std::pmr::memory_resource* request_resource() noexcept {
+    std::pmr::memory_resource* resource = request_resource_slot();
+    return resource ? resource : std::pmr::new_delete_resource();
+}
+
+// Installs 'arena' as this thread's request_resource() for its lifetime.
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena) noexcept : previous_(request_resource_slot()) {
+        request_resource_slot() = &arena;
+    }
+    ~ArenaScope() { request_resource_slot() = previous_; }
+    
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    std::pmr::memory_resource* previous_;
+};
+
+} // namespace https_server
+
+#endif // HTTPS_SERVER_ARENA_HPP
@@ -1,138 +1,89 @@
 bits 64
 default rel
 
-section .data align=32
-crlf_pattern: times 8 dw 0x0d0a
-crlf_crlf: db 0x0d, 0x0a, 0x0d, 0x0a, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+; Arguments arrive in rcx/rdx/r8 under the Microsoft x64 convention and in
+; rdi/rsi/rdx under System V; the ARG_* names map both onto one body. Only
+; volatile registers are touched (ymm0-ymm5 are volatile on Win64 too).
+%ifidn __OUTPUT_FORMAT__, win64
+    %define ARG_DATA rcx
+    %define ARG_LEN  rdx
+    %define ARG_POS  r8
+%else
+    %define ARG_DATA rdi
+    %define ARG_LEN  rsi
+    %define ARG_POS  rdx
+%endif
 
 section .text
 
 global http_find_header_end_avx2
-global http_parse_method_uri_avx2
 
+; bool http_find_header_end_avx2(const char* data, size_t len, size_t* pos)
+;
+; Finds the first "\r\n\r\n" in data[0, len) and stores the offset just past
+; it in *pos. 32 candidate positions are tested per iteration by comparing
+; four shifted loads against '\r' / '\n' and and-ing the results.
 http_find_header_end_avx2:
-    test rdx, rdx
-    jz .not_found
-    
-    cmp rdx, 4
-    jb .not_found
-    
-    vmovdqu xmm0, [crlf_crlf]
-    
-    mov rax, rcx
-    mov r8, rcx
-    add r8, rdx
-    sub r8, 3
-    
-.search_loop:
-    cmp rcx, r8
-    ja .not_found
-    
-    vmovdqu xmm1, [rcx]
-    vpcmpeqd xmm2, xmm1, xmm0
-    vpmovmskb r9d, xmm2
-    
-    test r9d, r9d
-    jnz .check_match
-    
-    inc rcx
-    jmp .search_loop
-    
-.check_match:
-    mov r10d, [rcx]
-    cmp r10d, 0x0a0d0a0d
-    je .found
-    
-    inc rcx
-    jmp .search_loop
-    
+    xor     eax, eax
+    cmp     ARG_LEN, 4
+    jb      .not_found
+
+    mov     r9d, 0x0d0d0d0d
+    vmovd   xmm0, r9d
+    vpbroadcastd ymm0, xmm0
+    mov     r9d, 0x0a0a0a0a
+    vmovd   xmm1, r9d
+    vpbroadcastd ymm1, xmm1
+
+    ; A vector step reads 32 candidates plus 3 bytes of lookahead.
+    cmp     ARG_LEN, 35
+    jb      .tail
+    mov     r10, ARG_LEN
+    sub     r10, 35
+
+.vector_loop:
+    vpcmpeqb ymm2, ymm0, [ARG_DATA + rax]
+    vpcmpeqb ymm3, ymm1, [ARG_DATA + rax + 1]
+    vpand   ymm2, ymm2, ymm3
+    vpcmpeqb ymm4, ymm0, [ARG_DATA + rax + 2]
+    vpcmpeqb ymm5, ymm1, [ARG_DATA + rax + 3]
+    vpand   ymm4, ymm4, ymm5
+    vpand   ymm2, ymm2, ymm4
+    vpmovmskb r9d, ymm2
+    test    r9d, r9d
+    jnz     .vector_found
+    add     rax, 32
+    cmp     rax, r10
+    jbe     .vector_loop
+    jmp     .tail
+
+.vector_found:
+    bsf     r9d, r9d
+    add     rax, r9
+    jmp     .found
+
+.tail:
+    lea     r9, [rax + 4]
+    cmp     r9, ARG_LEN
+    ja      .not_found_vector
+    cmp     dword [ARG_DATA + rax], 0x0a0d0a0d
+    je      .found
+    inc     rax
+    jmp     .tail
+
 .found:
-    sub rcx, rax
-    add rcx, 4
-    mov [r8], rcx
-    mov rax, 1
-    vzeroupper
-    ret
-    
-.not_found:
-    xor rax, rax
+    add     rax, 4
+    mov     [ARG_POS], rax
+    mov     eax, 1
     vzeroupper
     ret
 
-http_parse_method_uri_avx2:
-    test rdx, rdx
-    jz .error
-    
-    mov rax, r8
-    mov qword [rax], 0
-    mov qword [rax+8], 0
-    mov qword [rax+16], 0
-    mov qword [rax+24], 0
-    mov qword [rax+32], 0
-    mov byte [rax+40], 0
-    
-    mov r9, rcx
-    mov r10, rcx
-    add r10, rdx
-    
-.find_method_end:
-    cmp r9, r10
-    jae .error
-    
-    movzx r11, byte [r9]
-    cmp r11b, 0x20
-    je .method_found
-    
-    inc r9
-    jmp .find_method_end
-    
-.method_found:
-    mov r11, r9
-    sub r11, rcx
-    mov [rax], r11
-    
-    inc r9
-    
-.skip_spaces1:
-    cmp r9, r10
-    jae .error
-    
-    movzx r11, byte [r9]
-    cmp r11b, 0x20
-    jne .find_uri_start
-    
-    inc r9
-    jmp .skip_spaces1
-    
-.find_uri_start:
-    mov r11, r9
-    sub r11, rcx
-    mov [rax+8], r11
-    
-.find_uri_end:
-    cmp r9, r10
-    jae .error
-    
-    movzx r11, byte [r9]
-    cmp r11b, 0x20
-    je .uri_found
-    
-    inc r9
-    jmp .find_uri_end
-    
-.uri_found:
-    mov r11, r9
-    sub r11, rcx
-    sub r11, [rax+8]
-    mov [rax+16], r11
-    
-    mov byte [rax+40], 1
-    mov rax, 1
+.not_found_vector:
     vzeroupper
+.not_found:
+    xor     eax, eax
     ret
-    
-.error:
-    mov byte [rax+40], 0
-    xor rax, rax
-    vzeroupper
-    ret
\ No newline at end of file
+
+%ifidn __OUTPUT_FORMAT__, elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
@@ -5,6 +5,7 @@
 #define NOMINMAX
 #endif
 
+#include <string>
 #include <vector>
 #include <cstring>
 #include <string_view>
@@ -32,6 +33,10 @@ public:
         append(str.data(), str.size());
     }
 
+    char* read_ptr() noexcept {
+        return data_.data() + read_pos_;
+    }
+    
     char* write_ptr() noexcept {
         return data_.data() + write_pos_;
     }
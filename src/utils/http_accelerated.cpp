@@ -1,4 +1,5 @@
 #include "utils/http_accelerated.hpp"
+#include <cstring>
 
 #ifdef _WIN32
 #include <intrin.h>
@@ -6,6 +7,17 @@
 #include <cpuid.h>
 #endif
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define HTTP_SIMD_SCAN 1
+#endif
+
+#if defined(__GNUC__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
 namespace https_server {
 namespace http_accelerated {
 
@@ -24,5 +36,323 @@ bool HttpOps::detect_avx2() noexcept {
 #endif
 }
 
+const char* to_string(ParseError error) noexcept {
+    switch (error) {
+        case ParseError::None: return "no error";
+        case ParseError::HeadersTooLarge: return "header section too large";
+        case ParseError::TooManyHeaders: return "too many header fields";
+        case ParseError::InvalidMethod: return "invalid method";
+        case ParseError::InvalidUri: return "invalid request target";
+        case ParseError::InvalidVersion: return "invalid HTTP version";
+        case ParseError::InvalidHeaderName: return "invalid header field name";
+        case ParseError::InvalidHeaderValue: return "invalid header field value";
+        case ParseError::InvalidLineEnding: return "invalid line ending";
+    }
+    return "unknown error";
+}
+
+namespace {
+
+using CharTable = std::array<bool, 256>;
+
+// tchar = "!" / "#" / "$" / "%" / "&" / "'" / "*" / "+" / "-" / "." /
+//         "^" / "_" / "`" / "|" / "~" / DIGIT / ALPHA
+constexpr bool is_tchar(unsigned c) noexcept {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+           c == '!' || c == '#' || c == '$' || c == '%' || c == '&' || c == '\'' || c == '*' ||
+           c == '+' || c == '-' || c == '.' || c == '^' || c == '_' || c == '`' || c == '|' || c == '~';
+}
+
+constexpr CharTable make_tchar_table() noexcept {
+    CharTable table{};
+    for (unsigned c = 0; c < 256; ++c) {
+        table[c] = is_tchar(c);
+    }
+    return table;
+}
+
+// Request targets are checked loosely, as any visible byte: the router
+// and handlers decode them. Field values also allow SP and HTAB.
+constexpr CharTable make_visible_table(bool allow_space) noexcept {
+    CharTable table{};
+    for (unsigned c = 0; c < 256; ++c) {
+        table[c] = (c > 0x20 && c != 0x7F) || (allow_space && (c == ' ' || c == '\t'));
+    }
+    return table;
+}
+
+constexpr CharTable TCHAR = make_tchar_table();
+constexpr CharTable URI_CHAR = make_visible_table(false);
+constexpr CharTable VALUE_CHAR = make_visible_table(true);
+
+const char* skip_scalar(const char* p, const char* end, const CharTable& table) noexcept {
+    while (p < end && table[static_cast<unsigned char>(*p)]) {
+        ++p;
+    }
+    return p;
+}
+
+#ifdef HTTP_SIMD_SCAN
+
+// Nibble bitmaps for a vpshufb class test: byte c is a tchar when
+// LO[c & 15] & HI[c >> 4] is non-zero. HI is zero from 8 up, which keeps
+// every non-ASCII byte out of the class.
+struct NibbleTables {
+    alignas(16) std::uint8_t lo[16];
+    alignas(16) std::uint8_t hi[16];
+};
+
+constexpr NibbleTables make_tchar_nibbles() noexcept {
+    NibbleTables tables{};
+    for (unsigned c = 0; c < 128; ++c) {
+        if (is_tchar(c)) {
+            tables.lo[c & 15] = static_cast<std::uint8_t>(tables.lo[c & 15] | (1u << (c >> 4)));
+        }
+    }
+    for (unsigned h = 0; h < 8; ++h) {
+        tables.hi[h] = static_cast<std::uint8_t>(1u << h);
+    }
+    return tables;
+}
+
+constexpr NibbleTables TCHAR_NIBBLES = make_tchar_nibbles();
+
+inline unsigned count_trailing_zeros(std::uint32_t mask) noexcept {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+AVX2_TARGET const char* skip_tchar_avx2(const char* p, const char* end) noexcept {
+    const __m256i lo_table = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(TCHAR_NIBBLES.lo)));
+    const __m256i hi_table = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(TCHAR_NIBBLES.hi)));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+    
+    while (end - p >= 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i lo = _mm256_shuffle_epi8(lo_table, _mm256_and_si256(bytes, nibble));
+        const __m256i hi = _mm256_shuffle_epi8(hi_table, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble));
+        const __m256i outside = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), zero);
+        const auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(outside));
+        if (mask != 0) {
+            return p + count_trailing_zeros(mask);
+        }
+        p += 32;
+    }
+    return skip_scalar(p, end, TCHAR);
+}
+
+// Stops at control characters (below 'lowest', except HTAB when allowed)
+// and DEL. Bytes from 0x80 up are negative as int8 and always pass.
+AVX2_TARGET const char* skip_visible_avx2(const char* p, const char* end, char lowest, bool allow_tab,
+                                          const CharTable& table) noexcept {
+    const __m256i negative_one = _mm256_set1_epi8(-1);
+    const __m256i bound = _mm256_set1_epi8(lowest);
+    const __m256i del = _mm256_set1_epi8(0x7F);
+    const __m256i tab = allow_tab ? _mm256_set1_epi8('\t') : _mm256_set1_epi8(0x7F);
+    
+    while (end - p >= 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i control = _mm256_andnot_si256(
+            _mm256_cmpeq_epi8(bytes, tab),
+            _mm256_and_si256(_mm256_cmpgt_epi8(bytes, negative_one), _mm256_cmpgt_epi8(bound, bytes)));
+        const __m256i outside = _mm256_or_si256(control, _mm256_cmpeq_epi8(bytes, del));
+        const auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(outside));
+        if (mask != 0) {
+            return p + count_trailing_zeros(mask);
+        }
+        p += 32;
+    }
+    return skip_scalar(p, end, table);
+}
+
+#endif // HTTP_SIMD_SCAN
+
+const char* skip_tchar(const char* p, const char* end, bool vectorized) noexcept {
+#ifdef HTTP_SIMD_SCAN
+    if (vectorized) {
+        return skip_tchar_avx2(p, end);
+    }
+#endif
+    (void)vectorized;
+    return skip_scalar(p, end, TCHAR);
+}
+
+const char* skip_uri(const char* p, const char* end, bool vectorized) noexcept {
+#ifdef HTTP_SIMD_SCAN
+    if (vectorized) {
+        return skip_visible_avx2(p, end, 0x21, false, URI_CHAR);
+    }
+#endif
+    (void)vectorized;
+    return skip_scalar(p, end, URI_CHAR);
+}
+
+const char* skip_field_value(const char* p, const char* end, bool vectorized) noexcept {
+#ifdef HTTP_SIMD_SCAN
+    if (vectorized) {
+        return skip_visible_avx2(p, end, 0x20, true, VALUE_CHAR);
+    }
+#endif
+    (void)vectorized;
+    return skip_scalar(p, end, VALUE_CHAR);
+}
+
+bool find_header_end_scalar(const char* data, size_t len, size_t* pos) noexcept {
+    const size_t found = std::string_view(data, len).find("\r\n\r\n");
+    if (found == std::string_view::npos) {
+        return false;
+    }
+    *pos = found + 4;
+    return true;
+}
+
+Span make_span(const char* data, const char* first, const char* last) noexcept {
+    return Span{static_cast<std::uint32_t>(first - data), static_cast<std::uint32_t>(last - first)};
+}
+
+} // namespace
+
+RequestParser::RequestParser(bool vectorized) noexcept
+    : vectorized_(vectorized),
+      headers_{}
+{
+    reset();
+}
+
+void RequestParser::reset() noexcept {
+    status_ = ParseStatus::Incomplete;
+    error_ = ParseError::None;
+    error_offset_ = 0;
+    start_ = 0;
+    scanned_ = 0;
+    header_length_ = 0;
+    method_ = {};
+    uri_ = {};
+    version_ = {};
+    minor_version_ = 0;
+    header_count_ = 0;
+}
+
+ParseStatus RequestParser::fail(ParseError error, size_t offset) noexcept {
+    error_ = error;
+    error_offset_ = offset;
+    status_ = ParseStatus::Error;
+    return status_;
+}
+
+ParseStatus RequestParser::parse(const char* data, size_t len) noexcept {
+    if (status_ != ParseStatus::Incomplete) {
+        return status_;
+    }
+    
+    // Empty lines before the request line are ignored (RFC 9112 2.2), e.g.
+    // a CRLF some clients send after a POST body.
+    if (scanned_ == start_) {
+        while (len - start_ >= 2 && data[start_] == '\r' && data[start_ + 1] == '\n') {
+            start_ += 2;
+        }
+        scanned_ = start_;
+        if (len - start_ < 2) {
+            return len > MAX_HEADER_BYTES ? fail(ParseError::HeadersTooLarge, MAX_HEADER_BYTES) : status_;
+        }
+    }
+    
+    // The terminator may straddle the previous read: back up three bytes.
+    const size_t from = scanned_ >= start_ + 3 ? scanned_ - 3 : start_;
+    size_t end = 0;
+    const bool found = vectorized_ ? HttpOps::instance().find_header_end(data + from, len - from, &end)
+                                   : find_header_end_scalar(data + from, len - from, &end);
+    if (!found) {
+        scanned_ = len;
+        return len > MAX_HEADER_BYTES ? fail(ParseError::HeadersTooLarge, MAX_HEADER_BYTES) : status_;
+    }
+    
+    header_length_ = from + end;
+    scanned_ = header_length_;
+    if (header_length_ > MAX_HEADER_BYTES) {
+        return fail(ParseError::HeadersTooLarge, MAX_HEADER_BYTES);
+    }
+    
+    status_ = parse_head(data);
+    return status_;
+}
+
+ParseStatus RequestParser::parse_head(const char* data) noexcept {
+    // Every line ends in CRLF at or before 'limit', where the blank line
+    // starts, so lookahead past a scan result stays inside the head.
+    const char* const limit = data + header_length_ - 2;
+    const char* p = data + start_;
+    
+    // request-line = method SP request-target SP HTTP-version CRLF
+    const char* token_end = skip_tchar(p, limit, vectorized_);
+    if (token_end == p || *token_end != ' ') {
+        return fail(ParseError::InvalidMethod, static_cast<size_t>(token_end - data));
+    }
+    method_ = make_span(data, p, token_end);
+    p = token_end + 1;
+    
+    token_end = skip_uri(p, limit, vectorized_);
+    if (token_end == p || *token_end != ' ') {
+        return fail(ParseError::InvalidUri, static_cast<size_t>(token_end - data));
+    }
+    uri_ = make_span(data, p, token_end);
+    p = token_end + 1;
+    
+    if (limit - p < 10 || std::memcmp(p, "HTTP/1.", 7) != 0 || (p[7] != '0' && p[7] != '1')) {
+        return fail(ParseError::InvalidVersion, static_cast<size_t>(p - data));
+    }
+    if (p[8] != '\r' || p[9] != '\n') {
+        const bool line_break = p[8] == '\r' || p[8] == '\n';
+        return fail(line_break ? ParseError::InvalidLineEnding : ParseError::InvalidVersion,
+                    static_cast<size_t>(p + 8 - data));
+    }
+    version_ = make_span(data, p, p + 8);
+    minor_version_ = p[7] - '0';
+    p += 10;
+    
+    // field-line = field-name ":" OWS field-value OWS CRLF
+    while (p < limit) {
+        // Also rejects obs-fold (a line starting with SP / HTAB) and
+        // whitespace between the name and the colon.
+        const char* name_end = skip_tchar(p, limit, vectorized_);
+        if (name_end == p || *name_end != ':') {
+            return fail(ParseError::InvalidHeaderName, static_cast<size_t>(name_end - data));
+        }
+        if (header_count_ == MAX_HEADERS) {
+            return fail(ParseError::TooManyHeaders, static_cast<size_t>(p - data));
+        }
+        
+        const char* value = name_end + 1;
+        while (*value == ' ' || *value == '\t') {
+            ++value;
+        }
+        const char* value_end = skip_field_value(value, limit, vectorized_);
+        if (*value_end != '\r') {
+            return fail(*value_end == '\n' ? ParseError::InvalidLineEnding : ParseError::InvalidHeaderValue,
+                        static_cast<size_t>(value_end - data));
+        }
+        if (value_end[1] != '\n') {
+            return fail(ParseError::InvalidLineEnding, static_cast<size_t>(value_end + 1 - data));
+        }
+        
+        const char* trimmed = value_end;
+        while (trimmed > value && (trimmed[-1] == ' ' || trimmed[-1] == '\t')) {
+            --trimmed;
+        }
+        headers_[header_count_++] = HeaderSpan{make_span(data, p, name_end), make_span(data, value, trimmed)};
+        p = value_end + 2;
+    }
+    
+    return ParseStatus::Complete;
+}
+
 } // namespace http_accelerated
-} // namespace https_server
\ No newline at end of file
+} // namespace https_server
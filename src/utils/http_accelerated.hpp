@@ -1,6 +1,7 @@
 #ifndef HTTPS_SERVER_HTTP_ACCELERATED_HPP
 #define HTTPS_SERVER_HTTP_ACCELERATED_HPP
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <string_view>
@@ -8,15 +9,9 @@
 namespace https_server {
 namespace http_accelerated {
 
-struct HttpParseResult {
-    size_t method_len;
-    size_t uri_start; 
-    size_t uri_len;
-    bool valid;
-};
-
+#ifdef HAS_HTTP_ASM
 extern "C" bool http_find_header_end_avx2(const char* data, size_t len, size_t* pos) noexcept;
-extern "C" bool http_parse_method_uri_avx2(const char* data, size_t len, HttpParseResult* result) noexcept;
+#endif
 
 class HttpOps {
 public:
@@ -26,9 +21,11 @@ public:
     }
     
     bool find_header_end(const char* data, size_t len, size_t* pos) const noexcept {
+#ifdef HAS_HTTP_ASM
         if (len >= 32 && has_avx2_) {
             return http_find_header_end_avx2(data, len, pos);
         }
+#endif
         
         std::string_view view(data, len);
         auto found = view.find("\r\n\r\n");
@@ -39,16 +36,6 @@ public:
         return false;
     }
     
-    HttpParseResult parse_method_uri(const char* data, size_t len) const noexcept {
-        if (len >= 16 && has_avx2_) {
-            HttpParseResult result;
-            if (http_parse_method_uri_avx2(data, len, &result)) {
-                return result;
-            }
-        }
-        return {0, 0, 0, false};
-    }
-    
     bool has_avx2() const noexcept { return has_avx2_; }
 
 private:
@@ -58,7 +45,97 @@ private:
     bool has_avx2_;
 };
 
+enum class ParseStatus {
+    Complete,
+    Incomplete,
+    Error
+};
+
+enum class ParseError {
+    None,
+    HeadersTooLarge,
+    TooManyHeaders,
+    InvalidMethod,
+    InvalidUri,
+    InvalidVersion,
+    InvalidHeaderName,
+    InvalidHeaderValue,
+    InvalidLineEnding
+};
+
+const char* to_string(ParseError error) noexcept;
+
+// Byte range in the parsed buffer. Offsets rather than pointers, so results
+// stay valid when the buffer is reallocated between reads.
+struct Span {
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;
+    
+    std::string_view in(const char* data) const noexcept { return std::string_view(data + offset, length); }
+};
+
+struct HeaderSpan {
+    Span name;
+    Span value;
+};
+
+// Incremental HTTP/1.1 request-head parser. parse() is called with the whole
+// request received so far, starting at its first byte; after Incomplete it
+// only scans the bytes that arrived since the previous call. The request
+// line and header fields are validated against the RFC 9110 / 9112 grammar
+// in one pass once the blank line is in, with AVX2 scans for the character
+// classes when the CPU has them. Leading empty lines are skipped, obs-fold
+// and bare LF are rejected. Never allocates.
+class RequestParser {
+public:
+    static constexpr size_t MAX_HEADERS = 100;
+    static constexpr size_t MAX_HEADER_BYTES = 64 * 1024;
+    
+    // 'vectorized' selects the AVX2 scans and must only be set when the
+    // CPU has AVX2; the default follows HttpOps.
+    explicit RequestParser(bool vectorized = HttpOps::instance().has_avx2()) noexcept;
+    
+    ParseStatus parse(const char* data, size_t len) noexcept;
+    void reset() noexcept;
+    
+    ParseStatus status() const noexcept { return status_; }
+    ParseError error() const noexcept { return error_; }
+    // Where in the buffer the error was detected.
+    size_t error_offset() const noexcept { return error_offset_; }
+    
+    // Bytes from the start of the buffer through the blank line.
+    size_t header_length() const noexcept { return header_length_; }
+    
+    Span method() const noexcept { return method_; }
+    Span uri() const noexcept { return uri_; }
+    Span version() const noexcept { return version_; }
+    // 0 for HTTP/1.0, 1 for HTTP/1.1.
+    int minor_version() const noexcept { return minor_version_; }
+    
+    const HeaderSpan* headers_begin() const noexcept { return headers_.data(); }
+    const HeaderSpan* headers_end() const noexcept { return headers_.data() + header_count_; }
+    size_t header_count() const noexcept { return header_count_; }
+
+private:
+    ParseStatus fail(ParseError error, size_t offset) noexcept;
+    ParseStatus parse_head(const char* data) noexcept;
+    
+    bool vectorized_;
+    ParseStatus status_;
+    ParseError error_;
+    size_t error_offset_;
+    size_t start_;
+    size_t scanned_;
+    size_t header_length_;
+    Span method_;
+    Span uri_;
+    Span version_;
+    int minor_version_;
+    size_t header_count_;
+    std::array<HeaderSpan, MAX_HEADERS> headers_;
+};
+
 } // namespace http_accelerated
 } // namespace https_server
 
-#endif
\ No newline at end of file
+#endif
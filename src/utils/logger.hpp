@@ -19,6 +19,7 @@ public:
     static Logger& instance();
     
     void set_level(LogLevel level);
+    bool enabled(LogLevel level) const noexcept { return level >= level_; }
     void log(LogLevel level, const std::string& message);
     void log_with_binary_data(LogLevel level, const std::string& message, 
                               const void* data, size_t size);
@@ -35,10 +36,18 @@ private:
     std::ofstream file_;
 };
 
-#define LOG_DEBUG(msg) https_server::Logger::instance().log(https_server::LogLevel::Debug, msg)
-#define LOG_INFO(msg) https_server::Logger::instance().log(https_server::LogLevel::Info, msg)
-#define LOG_WARNING(msg) https_server::Logger::instance().log(https_server::LogLevel::Warning, msg)
-#define LOG_ERROR(msg) https_server::Logger::instance().log(https_server::LogLevel::Error, msg)
+// The message is only built when the level is enabled.
+#define HTTPS_SERVER_LOG(level, msg) \
+    do { \
+        if (https_server::Logger::instance().enabled(level)) { \
+            https_server::Logger::instance().log(level, msg); \
+        } \
+    } while (0)
+
+#define LOG_DEBUG(msg) HTTPS_SERVER_LOG(https_server::LogLevel::Debug, msg)
+#define LOG_INFO(msg) HTTPS_SERVER_LOG(https_server::LogLevel::Info, msg)
+#define LOG_WARNING(msg) HTTPS_SERVER_LOG(https_server::LogLevel::Warning, msg)
+#define LOG_ERROR(msg) HTTPS_SERVER_LOG(https_server::LogLevel::Error, msg)
 
 #define LOG_BINARY(level, msg, data, size) \
     https_server::Logger::instance().log_with_binary_data(level, msg, data, size)
@@ -0,0 +1,41 @@
+#include "http/http.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+// libFuzzer entry point: clang++ -std=c++17 -fsanitize=fuzzer,address -Isrc
+//     tests/fuzz/http_parser_fuzzer.cpp src/http/http.cpp src/utils/http_accelerated.cpp
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size) {
+    const std::string_view raw(reinterpret_cast<const char*>(data), size);
+    https_server::http::HttpRequest request;
+    
+    try {
+        https_server::http::parse_request(raw, request);
+    } catch (const std::runtime_error&) {
+        return 0;
+    }
+    
+    // Every view must lie inside the input.
+    const auto inside = [raw](std::string_view view) {
+        if (view.empty()) return;
+        if (view.data() < raw.data() || view.data() + view.size() > raw.data() + raw.size()) {
+            __builtin_trap();
+        }
+    };
+    inside(request.method);
+    inside(request.uri);
+    inside(request.http_version);
+    inside(request.body);
+    for (const auto& header : request.headers) {
+        inside(header.name);
+        inside(header.value);
+    }
+    
+    const https_server::http::OwnedHttpRequest owned(request);
+    if (owned.request().headers.size() != request.headers.size() || owned.request().uri != request.uri) {
+        __builtin_trap();
+    }
+    request.keep_alive();
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "core/server.hpp"
+#include "core/config.hpp"
+#include "utils/logger.hpp"
+#include "../unit/check.hpp"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <openssl/ssl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using https_server::http::HttpRequest;
+using https_server::http::HttpResponse;
+
+static constexpr std::uint16_t PORT = 48443;
+
+struct Reply {
+    std::string head;
+    std::string body;
+    
+    bool has(std::string_view line) const { return head.find(std::string(line) + "\r\n") != std::string::npos; }
+};
+
+// Takes one response off the front of 'in', framed by its Content-Length
+// unless it answers a HEAD; nothing when 'in' does not start with a whole
+// one.
+static std::optional<Reply> next_reply(std::string& in, bool head) {
+    const size_t head_end = in.find("\r\n\r\n");
+    if (in.rfind("HTTP/1.1 ", 0) != 0 || head_end == std::string::npos) {
+        return std::nullopt;
+    }
+    Reply reply;
+    reply.head = in.substr(0, head_end + 4);
+    const size_t field = reply.head.find("\r\nContent-Length: ");
+    if (field == std::string::npos) {
+        return std::nullopt;
+    }
+    const size_t length = head ? 0 : std::strtoul(reply.head.c_str() + field + 18, nullptr, 10);
+    if (in.size() < head_end + 4 + length) {
+        return std::nullopt;
+    }
+    reply.body = in.substr(head_end + 4, length);
+    in.erase(0, head_end + 4 + length);
+    return reply;
+}
+
+// Connects with TLS, sends 'requests' in one write and reads until the
+// server closes the connection.
+static std::optional<std::string> exchange(const std::string& requests) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(PORT);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    // The server may not be listening yet.
+    int fd = -1;
+    bool connected = false;
+    for (int attempt = 0; attempt < 100 && !connected; ++attempt) {
+        if (fd >= 0) {
+            close(fd);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        connected = connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    }
+    
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    SSL* ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    std::optional<std::string> received;
+    if (connected && SSL_connect(ssl) == 1 &&
+        SSL_write(ssl, requests.data(), static_cast<int>(requests.size())) == static_cast<int>(requests.size())) {
+        received.emplace();
+        char buffer[16384];
+        int bytes = 0;
+        while ((bytes = SSL_read(ssl, buffer, sizeof(buffer))) > 0) {
+            received->append(buffer, static_cast<size_t>(bytes));
+        }
+    }
+    SSL_free(ssl);
+    SSL_CTX_free(ctx);
+    close(fd);
+    return received;
+}
+
+int main() {
+    https_server::ServerConfig config;
+    config.port = PORT;
+    config.threads = 2;
+    config.event_loops = 1;
+    config.cert_file = HTTPS_SERVER_SOURCE_DIR "/cert.pem";
+    config.key_file = HTTPS_SERVER_SOURCE_DIR "/key.pem";
+    config.keep_alive_timeout_ms = 500;
+    https_server::Logger::instance().set_level(https_server::LogLevel::Error);
+    
+    https_server::Server server(config);
+    server.get_router().add_route("GET", "/hello", [](const HttpRequest&) {
+        HttpResponse response;
+        response.body = "hello";
+        return response;
+    });
+    server.get_router().add_route("GET", "/bye", [](const HttpRequest&) {
+        HttpResponse response;
+        response.body = "bye";
+        response.headers["Connection"] = "close";
+        return response;
+    });
+    std::thread thread([&server] { server.run(); });
+    
+    // A HEAD, answered from the GET route, leaves the connection framed for
+    // the requests behind it. A handler's close ends the connection there,
+    // and the request after it goes unanswered.
+    std::optional<std::string> received = exchange(
+        "HEAD /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        "GET /bye HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    server.shutdown();
+    thread.join();
+    CHECK(received);
+    
+    const std::optional<Reply> head = next_reply(*received, true);
+    CHECK(head && head->has("HTTP/1.1 200 OK") && head->has("Content-Length: 5"));
+    CHECK(head->has("Connection: keep-alive") && head->has("Keep-Alive: timeout=1"));
+    
+    const std::optional<Reply> get = next_reply(*received, false);
+    CHECK(get && get->has("HTTP/1.1 200 OK") && get->body == "hello");
+    
+    const std::optional<Reply> bye = next_reply(*received, false);
+    CHECK(bye && bye->has("Connection: close") && bye->body == "bye");
+    CHECK(!bye->has("Keep-Alive: timeout=1"));
+    CHECK(received->empty());
+    
+    std::cout << "Full handshake tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+// Sends a large file over TLS on loopback the ways the server can: read
+// into userspace and encrypted there, and with kernel TLS, both through
+// SSL_write and SSL_sendfile. The client decrypts in userspace every time.
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr size_t RECORD_SIZE = 16384;
+
+enum class Mode {
+    Userspace,
+    KtlsWrite,
+    KtlsSendfile
+};
+
+static void fail(const std::string& message) {
+    std::cerr << message << "\n";
+    ERR_print_errors_fp(stderr);
+    std::exit(1);
+}
+
+// A self-signed P-256 certificate, generated in memory.
+static void use_generated_certificate(SSL_CTX* ctx) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    if (!key || !cert) {
+        fail("Failed to generate a certificate");
+    }
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    if (X509_sign(cert, key, EVP_sha256()) == 0 ||
+        SSL_CTX_use_certificate(ctx, cert) != 1 || SSL_CTX_use_PrivateKey(ctx, key) != 1) {
+        fail("Failed to set up the certificate");
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+}
+
+// A connected pair of loopback TCP sockets, as kernel TLS needs TCP.
+static void connect_pair(int& server, int& client) {
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, 1) != 0 || getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        fail("Failed to listen on loopback");
+    }
+    client = socket(AF_INET, SOCK_STREAM, 0);
+    if (client < 0 || connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        fail("Failed to connect on loopback");
+    }
+    server = accept(listener, nullptr, nullptr);
+    if (server < 0) {
+        fail("Failed to accept on loopback");
+    }
+    close(listener);
+}
+
+// Sends 'size' bytes of 'file' in the given mode and returns the throughput
+// in MB/s, or a negative value when kernel TLS did not engage.
+static double run(Mode mode, SSL_CTX* server_ctx, SSL_CTX* client_ctx, int file, std::uint64_t size) {
+    int server_socket = -1;
+    int client_socket = -1;
+    connect_pair(server_socket, client_socket);
+    
+    SSL* client = SSL_new(client_ctx);
+    SSL_set_fd(client, client_socket);
+    std::uint64_t received = 0;
+    std::thread reader([&] {
+        if (SSL_connect(client) != 1) {
+            fail("Client handshake failed");
+        }
+        std::vector<char> buffer(RECORD_SIZE);
+        while (received < size) {
+            const int result = SSL_read(client, buffer.data(), static_cast<int>(buffer.size()));
+            if (result <= 0) {
+                break;
+            }
+            received += static_cast<std::uint64_t>(result);
+        }
+    });
+    
+    SSL* server = SSL_new(server_ctx);
+    SSL_set_fd(server, server_socket);
+    if (SSL_accept(server) != 1) {
+        fail("Server handshake failed");
+    }
+    const bool ktls = BIO_get_ktls_send(SSL_get_wbio(server)) != 0;
+    
+    double throughput = -1.0;
+    if (ktls == (mode != Mode::Userspace)) {
+        std::vector<char> buffer(RECORD_SIZE);
+        const auto start = Clock::now();
+        std::uint64_t sent = 0;
+        while (sent < size) {
+            ossl_ssize_t result = 0;
+            if (mode == Mode::KtlsSendfile) {
+                result = SSL_sendfile(server, file, static_cast<off_t>(sent),
+                                      static_cast<size_t>(size - sent), 0);
+            } else {
+                const size_t length = static_cast<size_t>(std::min<std::uint64_t>(RECORD_SIZE, size - sent));
+                if (pread(file, buffer.data(), length, static_cast<off_t>(sent)) != static_cast<ssize_t>(length)) {
+                    fail("Failed to read the file");
+                }
+                result = SSL_write(server, buffer.data(), static_cast<int>(length));
+            }
+            if (result <= 0) {
+                fail("Send failed");
+            }
+            sent += static_cast<std::uint64_t>(result);
+        }
+        reader.join();
+        const std::chrono::duration<double> duration = Clock::now() - start;
+        if (received != size) {
+            fail("Client received " + std::to_string(received) + " of " + std::to_string(size) + " bytes");
+        }
+        throughput = static_cast<double>(size) / (1024 * 1024) / duration.count();
+    } else {
+        shutdown(server_socket, SHUT_RDWR);
+        reader.join();
+    }
+    
+    SSL_free(server);
+    SSL_free(client);
+    close(server_socket);
+    close(client_socket);
+    return throughput;
+}
+
+int main(int argc, char* argv[]) {
+    const std::uint64_t size_mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 512;
+    const std::uint64_t size = size_mb * 1024 * 1024;
+    const int rounds = 3;
+    
+    char path[] = "/tmp/benchmark_ktls_XXXXXX";
+    const int file = mkstemp(path);
+    if (file < 0) {
+        fail("Failed to create the test file");
+    }
+    unlink(path);
+    std::vector<char> chunk(1024 * 1024);
+    for (size_t i = 0; i < chunk.size(); ++i) {
+        chunk[i] = static_cast<char>(i * 2654435761u >> 24);
+    }
+    for (std::uint64_t written = 0; written < size; written += chunk.size()) {
+        if (write(file, chunk.data(), chunk.size()) != static_cast<ssize_t>(chunk.size())) {
+            fail("Failed to write the test file");
+        }
+    }
+    
+    std::unique_ptr<SSL_CTX, decltype(&SSL_CTX_free)> userspace_ctx(SSL_CTX_new(TLS_server_method()), SSL_CTX_free);
+    std::unique_ptr<SSL_CTX, decltype(&SSL_CTX_free)> ktls_ctx(SSL_CTX_new(TLS_server_method()), SSL_CTX_free);
+    std::unique_ptr<SSL_CTX, decltype(&SSL_CTX_free)> client_ctx(SSL_CTX_new(TLS_client_method()), SSL_CTX_free);
+    if (!userspace_ctx || !ktls_ctx || !client_ctx) {
+        fail("Failed to create SSL contexts");
+    }
+    use_generated_certificate(userspace_ctx.get());
+    use_generated_certificate(ktls_ctx.get());
+    SSL_CTX_set_options(ktls_ctx.get(), SSL_OP_ENABLE_KTLS);
+    
+    std::cout << "Sending " << size_mb << " MB over loopback TLS, best of " << rounds << " rounds.\n";
+    std::cout << std::fixed << std::setprecision(2);
+    
+    const struct {
+        const char* name;
+        Mode mode;
+        SSL_CTX* ctx;
+    } cases[] = {
+        {"pread + SSL_write (userspace TLS)", Mode::Userspace, userspace_ctx.get()},
+        {"pread + SSL_write (kernel TLS)", Mode::KtlsWrite, ktls_ctx.get()},
+        {"SSL_sendfile (kernel TLS)", Mode::KtlsSendfile, ktls_ctx.get()},
+    };
+    
+    for (const auto& c : cases) {
+        double best = -1.0;
+        for (int round = 0; round < rounds; ++round) {
+            best = std::max(best, run(c.mode, c.ctx, client_ctx.get(), file, size));
+        }
+        std::cout << std::left << std::setw(36) << c.name;
+        if (best < 0) {
+            std::cout << "skipped, kernel TLS is not available for this kernel or cipher\n";
+        } else {
+            std::cout << best << " MB/s\n";
+        }
+    }
+    
+    close(file);
+    return 0;
+}
+
+#else
+
+int main() {
+    std::cout << "Kernel TLS is only available on Linux and FreeBSD, skipping.\n";
+    return 0;
+}
+
+#endif
@@ -0,0 +1,132 @@
+#include "http/router.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using https_server::http::HttpRequest;
+using https_server::http::HttpResponse;
+
+// The previous router: a list scanned in registration order, with string
+// compares per route and a substr per wildcard.
+class LinearRouter {
+public:
+    void add_route(const std::string& method, const std::string& pattern, https_server::HttpHandler handler) {
+        routes_.push_back(Route{pattern, method, std::move(handler)});
+    }
+    
+    HttpResponse route_request(const HttpRequest& request) const {
+        for (const auto& route : routes_) {
+            if (route.method == request.method && matches_pattern(route.pattern, request.uri)) {
+                return route.handler(request);
+            }
+        }
+        HttpResponse response;
+        response.status_code = 404;
+        return response;
+    }
+
+private:
+    struct Route {
+        std::string pattern;
+        std::string method;
+        https_server::HttpHandler handler;
+    };
+    
+    bool matches_pattern(const std::string& pattern, std::string_view uri) const {
+        if (pattern.find('*') == std::string::npos) {
+            return pattern == uri;
+        }
+        
+        if (pattern.back() == '*' && pattern.size() > 1 && pattern[pattern.size()-2] == '/') {
+            const std::string prefix = pattern.substr(0, pattern.size() - 1);
+            return uri.substr(0, prefix.size()) == prefix;
+        }
+        
+        return pattern == uri;
+    }
+    
+    std::vector<Route> routes_;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps the routed results observable so the loop is not optimized out.
+static volatile size_t sink;
+
+// The handler does nothing, so the time is the lookup plus one response.
+static HttpResponse empty_handler(const HttpRequest&) {
+    return HttpResponse{};
+}
+
+// main.cpp's routes in front of 'resources' REST-style groups, catch-alls last.
+template <typename Router>
+void add_routes(Router& router, size_t resources) {
+    for (const char* path : {"/", "/about", "/bench", "/api/benchmark", "/api/stats", "/style.css", "/test.html"}) {
+        router.add_route("GET", path, empty_handler);
+    }
+    router.add_route("POST", "/api/echo", empty_handler);
+    for (size_t i = 0; i < resources; ++i) {
+        const std::string base = "/api/v1/resource" + std::to_string(i);
+        router.add_route("GET", base, empty_handler);
+        router.add_route("POST", base, empty_handler);
+        router.add_route("GET", base + "/search", empty_handler);
+        router.add_route("GET", base + "/export", empty_handler);
+    }
+    router.add_route("GET", "/static/*", empty_handler);
+    router.add_route("GET", "/*", empty_handler);
+}
+
+template <typename Router>
+double measure(const Router& router, const std::vector<std::string>& uris, size_t rounds) {
+    std::vector<HttpRequest> requests(uris.size());
+    for (size_t i = 0; i < uris.size(); ++i) {
+        requests[i].method = "GET";
+        requests[i].uri = uris[i];
+    }
+    
+    size_t checksum = 0;
+    const auto start = Clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (HttpRequest& request : requests) {
+            checksum += static_cast<size_t>(router.route_request(request).status_code);
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    
+    sink = checksum;
+    return elapsed.count() / static_cast<double>(rounds * requests.size());
+}
+
+int main() {
+    const size_t rounds = 2000;
+    
+    std::cout << "Starting router benchmark...\n";
+    std::cout << std::fixed << std::setprecision(1);
+    
+    for (size_t resources : {2, 25, 100}) {
+        LinearRouter linear;
+        https_server::Router radix;
+        add_routes(linear, resources);
+        add_routes(radix, resources);
+        
+        // A spread of hits across the table, static files and misses that
+        // end up at the catch-all.
+        std::vector<std::string> uris = {"/", "/about", "/api/stats", "/static/css/site.css", "/images/logo.png"};
+        for (size_t i = 0; i < resources; i += std::max<size_t>(1, resources / 8)) {
+            uris.push_back("/api/v1/resource" + std::to_string(i));
+            uris.push_back("/api/v1/resource" + std::to_string(i) + "/export");
+        }
+        
+        const double linear_ns = measure(linear, uris, rounds);
+        const double radix_ns = measure(radix, uris, rounds);
+        std::cout << std::setw(5) << resources * 4 + 10 << " routes:"
+                  << std::setw(10) << linear_ns << " ns linear"
+                  << std::setw(10) << radix_ns << " ns radix"
+                  << std::setw(8) << linear_ns / radix_ns << "x\n";
+    }
+    
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include "core/thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// The previous pool: one std::function queue behind a single mutex.
+class MutexPool {
+public:
+    explicit MutexPool(size_t num_threads) {
+        for (size_t i = 0; i < num_threads; ++i) {
+            workers_.emplace_back([this] {
+                while (true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        condition_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+                        if (stop_ && tasks_.empty()) {
+                            return;
+                        }
+                        task = std::move(tasks_.front());
+                        tasks_.pop();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+    
+    ~MutexPool() {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        condition_.notify_all();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+    
+    void enqueue(std::function<void()> task) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            tasks_.emplace(std::move(task));
+        }
+        condition_.notify_one();
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stop_ = false;
+};
+
+using Clock = std::chrono::steady_clock;
+
+struct Payload {
+    std::atomic<size_t> done{0};
+};
+
+// Tasks capture a shared_ptr plus a scalar, like the server's request tasks.
+template <typename Pool>
+double measure_throughput(Pool& pool, size_t producers, size_t tasks_per_producer) {
+    auto payload = std::make_shared<Payload>();
+    const size_t total = producers * tasks_per_producer;
+    
+    const auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&pool, payload, tasks_per_producer] {
+            for (size_t i = 0; i < tasks_per_producer; ++i) {
+                pool.enqueue([payload, i] {
+                    payload->done.fetch_add(1, std::memory_order_relaxed);
+                    (void)i;
+                });
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    while (payload->done.load(std::memory_order_acquire) != total) {
+        std::this_thread::yield();
+    }
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+    
+    return static_cast<double>(total) / elapsed.count() / 1e6;
+}
+
+// Time from enqueue on an idle pool until the task starts running.
+template <typename Pool>
+std::vector<double> measure_wakeup(Pool& pool, size_t samples) {
+    std::vector<double> latencies;
+    latencies.reserve(samples);
+    
+    for (size_t i = 0; i < samples; ++i) {
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        
+        std::atomic<bool> ran{false};
+        Clock::time_point started;
+        const auto enqueued = Clock::now();
+        pool.enqueue([&ran, &started] {
+            started = Clock::now();
+            ran.store(true, std::memory_order_release);
+        });
+        while (!ran.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(started - enqueued).count());
+    }
+    
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+template <typename Pool>
+void run(const char* name, size_t workers, size_t producers, size_t tasks_per_producer, size_t samples) {
+    Pool pool(workers);
+    
+    const double mtasks = measure_throughput(pool, producers, tasks_per_producer);
+    const std::vector<double> wakeup = measure_wakeup(pool, samples);
+    
+    std::cout << std::left << std::setw(16) << name
+              << std::right << std::setw(10) << mtasks << " Mtasks/s"
+              << std::setw(12) << wakeup[wakeup.size() / 2] << " us p50"
+              << std::setw(12) << wakeup[wakeup.size() * 99 / 100] << " us p99\n";
+}
+
+int main() {
+    const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    const size_t workers = hardware;
+    const size_t producers = std::max<size_t>(1, hardware / 2);
+    const size_t tasks_per_producer = 1000000;
+    const size_t samples = 2000;
+    
+    std::cout << "Starting thread pool benchmark...\n";
+    std::cout << workers << " workers, " << producers << " producers, "
+              << tasks_per_producer << " tasks each; " << samples << " wake-up samples.\n";
+    std::cout << std::fixed << std::setprecision(2);
+    
+    run<MutexPool>("mutex queue", workers, producers, tasks_per_producer, samples);
+    run<https_server::ThreadPool>("work stealing", workers, producers, tasks_per_producer, samples);
+    
+    return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef HTTPS_SERVER_TEST_CHECK_HPP
+#define HTTPS_SERVER_TEST_CHECK_HPP
+
+#include <iostream>
+
+// Fails the test from main() when 'condition' is false. Unlike assert(), it
+// stays in Release builds, which compile the tests with NDEBUG.
+#define CHECK(condition)                                                                          \
+    do {                                                                                          \
+        if (!(condition)) {                                                                       \
+            std::cout << "FAILURE: " << #condition << " (" << __FILE__ << ":" << __LINE__ << ")" \
+                      << std::endl;                                                               \
+            return 1;                                                                             \
+        }                                                                                         \
+    } while (false)
+
+#endif // HTTPS_SERVER_TEST_CHECK_HPP
@@ -0,0 +1,138 @@
+#include "core/admission.hpp"
+#include "check.hpp"
+#include <iostream>
+#include <cstdint>
+#include <string>
+
+using https_server::AdmissionController;
+using https_server::ServerConfig;
+
+int main() {
+    ServerConfig config;
+    config.max_pending_requests = 64;
+    config.queue_delay_target_ms = 20;
+    config.retry_after_s = 7;
+    config.max_connections = 3;
+    constexpr std::uint64_t on_time = 1000;
+    constexpr std::uint64_t late = 30000;
+    
+    // The limit starts at max_pending_requests, and requests over it are shed.
+    {
+        AdmissionController admission(config, 4);
+        CHECK(admission.limit() == 64 && admission.in_flight() == 0);
+        for (int i = 0; i < 64; ++i) {
+            CHECK(admission.try_admit());
+        }
+        CHECK(!admission.try_admit());
+        CHECK(admission.in_flight() == 64);
+        CHECK(admission.stats().admitted == 64 && admission.stats().shed == 1);
+        
+        // Completing on time at the ceiling leaves the limit where it is.
+        for (int i = 0; i < 64; ++i) {
+            admission.complete(on_time, 0);
+        }
+        CHECK(admission.in_flight() == 0 && admission.limit() == 64);
+        
+        const std::string& response = admission.overload_response();
+        CHECK(response.rfind("HTTP/1.1 503 Service Unavailable\r\n", 0) == 0);
+        CHECK(response.find("Retry-After: 7\r\n") != std::string::npos);
+        CHECK(response.find("Connection: close\r\n") != std::string::npos);
+    }
+    
+    // Late requests cut the limit to 3/4, once per 50 ms however many there
+    // are, down to the worker count; the new limit sheds at once.
+    {
+        AdmissionController admission(config, 4);
+        std::uint64_t now = 1000000;
+        CHECK(admission.try_admit());
+        admission.complete(late, now);
+        CHECK(admission.limit() == 48);
+        for (int i = 0; i < 10; ++i) {
+            CHECK(admission.try_admit());
+            admission.complete(late, now + 49999);
+        }
+        CHECK(admission.limit() == 48);
+        
+        for (int i = 0; i < 48; ++i) {
+            CHECK(admission.try_admit());
+        }
+        CHECK(!admission.try_admit());
+        for (int i = 0; i < 48; ++i) {
+            admission.complete(late, now + 50000);
+        }
+        CHECK(admission.limit() == 36 && admission.in_flight() == 0);
+        
+        const std::uint32_t expected[] = {27, 21, 16, 12, 9, 7, 6, 5, 4, 4, 4};
+        for (const std::uint32_t limit : expected) {
+            now += 50000;
+            CHECK(admission.try_admit());
+            admission.complete(late, now + 50000);
+            CHECK(admission.limit() == limit);
+        }
+        
+        // On time, the limit grows by one per 'limit' completions in a row.
+        now += 100000;
+        for (int i = 0; i < 3; ++i) {
+            CHECK(admission.try_admit());
+            admission.complete(on_time, now);
+        }
+        CHECK(admission.limit() == 4);
+        CHECK(admission.try_admit());
+        admission.complete(on_time, now);
+        CHECK(admission.limit() == 5);
+        
+        // A decrease starts the count again.
+        for (int i = 0; i < 4; ++i) {
+            CHECK(admission.try_admit());
+            admission.complete(on_time, now);
+        }
+        now += 50000;
+        CHECK(admission.try_admit());
+        admission.complete(late, now);
+        CHECK(admission.limit() == 4);
+        for (int i = 0; i < 3; ++i) {
+            CHECK(admission.try_admit());
+            admission.complete(on_time, now);
+        }
+        CHECK(admission.limit() == 4);
+        
+        // And never past max_pending_requests.
+        for (int i = 0; i < 10000; ++i) {
+            CHECK(admission.try_admit());
+            admission.complete(on_time, now);
+        }
+        CHECK(admission.limit() == 64 && admission.in_flight() == 0);
+    }
+    
+    // A zero target turns the adaptive limit off.
+    {
+        ServerConfig fixed = config;
+        fixed.queue_delay_target_ms = 0;
+        AdmissionController admission(fixed, 4);
+        CHECK(admission.try_admit());
+        admission.complete(late, 1000000);
+        CHECK(admission.limit() == 64);
+    }
+    
+    // Connections past max_connections are refused until one closes.
+    {
+        AdmissionController admission(config, 4);
+        for (int i = 0; i < 3; ++i) {
+            CHECK(admission.try_open_connection());
+        }
+        CHECK(!admission.try_open_connection());
+        CHECK(admission.connections() == 3 && admission.stats().rejected_connections == 1);
+        admission.close_connection();
+        CHECK(admission.try_open_connection());
+        
+        ServerConfig unlimited = config;
+        unlimited.max_connections = 0;
+        AdmissionController open(unlimited, 4);
+        for (int i = 0; i < 1000; ++i) {
+            CHECK(open.try_open_connection());
+        }
+    }
+    
+    std::cout << "Admission tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "utils/arena.hpp"
+#include "http/http.hpp"
+#include "check.hpp"
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using https_server::Arena;
+using https_server::ArenaScope;
+using https_server::http::HttpResponse;
+
+// Every trip to the global allocator is counted.
+static size_t global_allocations = 0;
+
+void* operator new(size_t size) {
+    ++global_allocations;
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    ++global_allocations;
+    const size_t align = static_cast<size_t>(alignment);
+    if (void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+// What a typical handler does to build its response.
+static HttpResponse build_response(int round) {
+    HttpResponse response;
+    response.status_code = 200;
+    response.headers["Content-Type"] = "application/json; charset=utf-8";
+    response.headers["X-Request-ID"] = "request-" + std::to_string(round);
+    response.headers["Cache-Control"] = "no-store, no-cache, must-revalidate";
+    response.body = "{\"status\": \"success\", \"message\": \"a body that does not fit in a short string\"}";
+    response.body += ", round " + std::to_string(round);
+    return response;
+}
+
+int main() {
+    // Allocations are aligned and do not overlap, across several blocks.
+    {
+        Arena arena(256);
+        std::vector<std::pair<char*, size_t>> spans;
+        for (size_t i = 1; i <= 200; ++i) {
+            const size_t alignment = size_t(1) << (i % 5);
+            const size_t size = i * 3;
+            char* pointer = static_cast<char*>(arena.allocate(size, alignment));
+            CHECK(reinterpret_cast<std::uintptr_t>(pointer) % alignment == 0);
+            for (size_t j = 0; j < size; ++j) {
+                pointer[j] = static_cast<char>(i);
+            }
+            spans.emplace_back(pointer, size);
+        }
+        for (size_t i = 0; i < spans.size(); ++i) {
+            for (size_t j = 0; j < spans[i].second; ++j) {
+                CHECK(spans[i].first[j] == static_cast<char>(i + 1));
+            }
+        }
+        CHECK(arena.block_count() > 1);
+        
+        // The same requests fit in the same blocks after a reset.
+        const size_t blocks = arena.block_count();
+        for (int round = 0; round < 3; ++round) {
+            arena.reset();
+            for (size_t i = 1; i <= 200; ++i) {
+                static_cast<void>(arena.allocate(i * 3, size_t(1) << (i % 5)));
+            }
+            CHECK(arena.block_count() == blocks);
+        }
+    }
+    
+    // Large allocations go to the heap and back.
+    {
+        Arena arena;
+        const size_t before = global_allocations;
+        void* large = arena.allocate(Arena::LARGE_ALLOCATION + 1, 16);
+        CHECK(global_allocations == before + 1 && arena.block_count() == 0);
+        arena.deallocate(large, Arena::LARGE_ALLOCATION + 1, 16);
+    }
+    
+    // Responses built in a scope draw from the arena; once it has grown to
+    // size, building one costs no global allocations.
+    {
+        Arena arena;
+        for (int round = 0; round < 4; ++round) {
+            const size_t before = global_allocations;
+            {
+                ArenaScope scope(arena);
+                arena.reset();
+                std::vector<HttpResponse> responses;
+                responses.reserve(2);
+                responses.emplace_back(build_response(round));
+                responses.emplace_back(build_response(round + 1));
+                CHECK(responses[0].body.get_allocator().resource() == &arena);
+                const std::string expected = "request-" + std::to_string(round + 1);
+                CHECK(responses[1].headers.find("X-Request-ID")->second == std::string_view(expected));
+                if (round > 0) {
+                    // Only the vector, which a connection keeps.
+                    CHECK(global_allocations == before + 1);
+                }
+            }
+        }
+        
+        // Outside a scope the heap is used, and moving keeps the resource.
+        const HttpResponse response = build_response(0);
+        CHECK(response.body.get_allocator().resource() == std::pmr::new_delete_resource());
+        ArenaScope scope(arena);
+        HttpResponse moved(build_response(0));
+        CHECK(moved.body.get_allocator().resource() == &arena);
+    }
+    
+    std::cout << "Arena tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "http/body.hpp"
+#include "http/http.hpp"
+#include "check.hpp"
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+using namespace https_server::http;
+namespace fs = std::filesystem;
+
+static void write_file(const fs::path& path, const std::string& content) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+struct EmptyProducer final : BodyProducer {
+    size_t produce(char*, size_t, bool& done) override {
+        done = true;
+        return 0;
+    }
+};
+
+// Runs 'reader' to the end in pieces of at most 'piece' bytes, or returns
+// nothing if it ever produces more than asked for.
+static std::optional<std::string> drain(FileRegionReader& reader, size_t piece) {
+    std::string out;
+    bool done = false;
+    while (!done) {
+        const size_t size = out.size();
+        out.resize(size + piece);
+        const size_t produced = reader.produce(out.data() + size, piece, done);
+        if (produced > piece) {
+            return std::nullopt;
+        }
+        out.resize(size + produced);
+    }
+    return out;
+}
+
+int main() {
+    const fs::path root = fs::temp_directory_path() / ("body_test_" + std::to_string(getpid()));
+    fs::create_directories(root);
+    std::string content;
+    for (int i = 0; i < 50000; ++i) {
+        content += static_cast<char>('a' + i % 26);
+    }
+    write_file(root / "data.txt", content);
+    write_file(root / "empty.txt", "");
+    
+    // File regions, read in pieces from an offset.
+    {
+        const auto descriptor = FileDescriptor::open((root / "data.txt").string());
+        CHECK(descriptor && descriptor->size() == content.size());
+        CHECK(!FileDescriptor::open((root / "missing.txt").string()));
+        CHECK(!FileDescriptor::open(root.string()));
+        
+        FileRegionReader reader;
+        const FileRegion whole{descriptor, 0, content.size()};
+        reader.reset(whole);
+        CHECK(drain(reader, 16384) == content);
+        
+        const FileRegion part{descriptor, 1000, 30000};
+        reader.reset(part);
+        CHECK(drain(reader, 7) == content.substr(1000, 30000));
+        
+        const auto empty = FileDescriptor::open((root / "empty.txt").string());
+        CHECK(empty && empty->size() == 0);
+        const FileRegion nothing{empty, 0, 0};
+        reader.reset(nothing);
+        CHECK(drain(reader, 16384) == std::string());
+        
+        // A file that shrank under its region fails rather than ending early.
+        const FileRegion past_end{descriptor, 40000, 20000};
+        reader.reset(past_end);
+        bool threw = false;
+        try {
+            drain(reader, 16384);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+    
+    // The response sees the same bytes and size, whatever holds them.
+    {
+        HttpResponse owned;
+        owned.body = "owned";
+        CHECK(owned.payload() == "owned" && owned.body_size() == 5 && !owned.file_region());
+        
+        HttpResponse shared;
+        shared.body_source = std::make_shared<const std::string>("shared");
+        CHECK(shared.payload() == "shared" && shared.body_size() == 6);
+        
+        HttpResponse region;
+        region.body_source = FileRegion{FileDescriptor::open((root / "data.txt").string()), 0, 1234};
+        CHECK(region.payload().empty() && region.body_size() == 1234);
+        CHECK(region.file_region() && region.file_region()->length == 1234);
+    }
+    
+    // Framing and default headers are found whatever case a handler wrote
+    // them in, so a streamed body is never framed twice.
+    {
+        HttpResponse streamed;
+        streamed.producer = std::make_unique<EmptyProducer>();
+        CHECK(streamed.chunked());
+        streamed.headers["content-length"] = "0";
+        streamed.headers["connection"] = "keep-alive";
+        streamed.headers["date"] = "Sun, 06 Nov 1994 08:49:37 GMT";
+        CHECK(!streamed.chunked());
+        streamed.headers["Content-Length"] = "5";
+        CHECK(streamed.headers.size() == 3 && streamed.headers.find("CONTENT-LENGTH")->second == "5");
+        
+        https_server::Buffer out;
+        streamed.write_head(out);
+        const std::string head(out.readable_view());
+        CHECK(head.find("Transfer-Encoding") == std::string::npos);
+        CHECK(head.find("Connection: close") == std::string::npos);
+        CHECK(head.find("Date:") == std::string::npos);
+        CHECK(head.find("content-length: 5\r\n") != std::string::npos);
+    }
+    
+    fs::remove_all(root);
+    std::cout << "Body tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include "http/body_reader.hpp"
+#include "check.hpp"
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using https_server::http::BodyError;
+using https_server::http::BodyReader;
+using https_server::http::BodyStatus;
+
+struct Decoded {
+    BodyStatus status;
+    std::string body;
+    size_t consumed;
+};
+
+// Decodes 'framed' in place, delivering it 'step' bytes at a time the way a
+// connection appends reads behind the already-decoded part.
+static Decoded decode_in_place(BodyReader& reader, const std::string& framed, size_t step) {
+    std::vector<char> buffer;
+    size_t received = 0;
+    size_t consumed = 0;
+    size_t decoded = 0;
+    BodyStatus status = reader.status();
+    
+    while (status == BodyStatus::Incomplete && received < framed.size()) {
+        const size_t count = std::min(step, framed.size() - received);
+        buffer.insert(buffer.end(), framed.begin() + static_cast<std::ptrdiff_t>(received),
+                      framed.begin() + static_cast<std::ptrdiff_t>(received + count));
+        received += count;
+        
+        size_t used = 0;
+        size_t produced = 0;
+        status = reader.decode(buffer.data() + consumed, buffer.size() - consumed, buffer.data() + decoded,
+                               used, produced);
+        consumed += used;
+        decoded += produced;
+    }
+    return Decoded{status, std::string(buffer.data(), decoded), consumed};
+}
+
+static Decoded decode_chunked(const std::string& framed, size_t step = 1 << 20) {
+    BodyReader reader;
+    reader.start_chunked(0);
+    return decode_in_place(reader, framed, step);
+}
+
+int main() {
+    // Content-Length bodies pass through and stop at the declared length.
+    {
+        BodyReader reader;
+        reader.start_length(11);
+        const Decoded decoded = decode_in_place(reader, "hello worldGET / HTTP/1.1", 4);
+        CHECK(decoded.status == BodyStatus::Complete);
+        CHECK(decoded.body == "hello world");
+        CHECK(decoded.consumed == 11);
+        CHECK(reader.body_size() == 11);
+        
+        reader.start_length(0);
+        CHECK(reader.status() == BodyStatus::Complete);
+    }
+    
+    // Chunked bodies decode the same whichever way the bytes are split.
+    {
+        const std::string framed =
+            "5\r\nhello\r\n"
+            "1;name=value;other\r\n \r\n"
+            "00000a \r\n0123456789\r\n"
+            "1A\r\nabcdefghijklmnopqrstuvwxyz\r\n"
+            "0\r\n"
+            "Checksum: abc\r\n"
+            "X-Trailer: 1\r\n"
+            "\r\n";
+        const std::string next = "GET / HTTP/1.1\r\n\r\n";
+        const std::string expected = "hello 0123456789abcdefghijklmnopqrstuvwxyz";
+        
+        for (size_t step = 1; step <= framed.size(); ++step) {
+            const Decoded decoded = decode_chunked(framed + next, step);
+            CHECK(decoded.status == BodyStatus::Complete);
+            CHECK(decoded.body == expected);
+            CHECK(decoded.consumed == framed.size());
+        }
+        
+        const Decoded empty = decode_chunked("0\r\n\r\n");
+        CHECK(empty.status == BodyStatus::Complete && empty.body.empty() && empty.consumed == 5);
+    }
+    
+    // Malformed framing.
+    {
+        const auto error_of = [](const std::string& framed, size_t max_size = 0) {
+            BodyReader reader;
+            reader.start_chunked(max_size);
+            decode_in_place(reader, framed, 1 << 20);
+            return reader.error();
+        };
+        
+        CHECK(error_of("5\r\nhello\r\n0\r\n\r\n") == BodyError::None);
+        CHECK(error_of("x\r\n") == BodyError::InvalidChunk);
+        CHECK(error_of("\r\n") == BodyError::InvalidChunk);
+        CHECK(error_of(";ext\r\n") == BodyError::InvalidChunk);
+        CHECK(error_of("5\nhello\r\n") == BodyError::InvalidChunk);
+        CHECK(error_of("5\r\nhelloX\r\n") == BodyError::InvalidChunk);
+        CHECK(error_of("5\r\nhello\n0\r\n\r\n") == BodyError::InvalidChunk);
+        CHECK(error_of("5\r\nhello\r\n0\r\nX: 1\n\r\n") == BodyError::InvalidChunk);
+        CHECK(error_of("5\r\nhello\r\n0\r\n\rX") == BodyError::InvalidChunk);
+        CHECK(error_of("10000000000000000\r\n") == BodyError::InvalidChunk);
+        CHECK(error_of("1;" + std::string(BodyReader::MAX_CHUNK_LINE, 'x') + "\r\n") == BodyError::InvalidChunk);
+        CHECK(error_of("0\r\nX: " + std::string(BodyReader::MAX_TRAILER_BYTES, 'x') + "\r\n\r\n") ==
+              BodyError::InvalidChunk);
+        
+        // Trailer fields are field-name ":" field-value, without obs-fold.
+        CHECK(error_of("0\r\nX-Empty:\r\nX:\t a b \r\n\r\n") == BodyError::None);
+        CHECK(error_of("0\r\nno colon\r\n\r\n") == BodyError::InvalidChunk);
+        CHECK(error_of("0\r\nX : 1\r\n\r\n") == BodyError::InvalidChunk);
+        CHECK(error_of("0\r\n: 1\r\n\r\n") == BodyError::InvalidChunk);
+        CHECK(error_of("0\r\nX: 1\r\n folded\r\n\r\n") == BodyError::InvalidChunk);
+        CHECK(error_of(std::string("0\r\nX: a\0b\r\n\r\n", 13)) == BodyError::InvalidChunk);
+        CHECK(error_of(std::string("0\r\nX\0: 1\r\n\r\n", 12)) == BodyError::InvalidChunk);
+        
+        // The limit applies to the decoded total and is checked per chunk
+        // size line, before any of that chunk's data is accepted.
+        CHECK(error_of("4\r\nabcd\r\n4\r\nefgh\r\n0\r\n\r\n", 8) == BodyError::None);
+        CHECK(error_of("4\r\nabcd\r\n5\r\n", 8) == BodyError::TooLarge);
+        CHECK(error_of("ffffffffffffffff\r\n", 8) == BodyError::TooLarge);
+    }
+    
+    // Random chunk layouts round-trip.
+    {
+        std::mt19937 rng(11);
+        for (int i = 0; i < 2000; ++i) {
+            std::string body;
+            std::string framed;
+            const size_t chunks = rng() % 8;
+            for (size_t c = 0; c < chunks; ++c) {
+                std::string data(1 + rng() % 300, '\0');
+                for (char& ch : data) {
+                    ch = static_cast<char>(rng());
+                }
+                char size[32];
+                std::snprintf(size, sizeof(size), (rng() % 2) ? "%zx" : "%zX", data.size());
+                framed += std::string(size) + "\r\n" + data + "\r\n";
+                body += data;
+            }
+            framed += "0\r\n\r\n";
+            
+            const Decoded decoded = decode_chunked(framed, 1 + rng() % 64);
+            CHECK(decoded.status == BodyStatus::Complete);
+            CHECK(decoded.body == body);
+            CHECK(decoded.consumed == framed.size());
+        }
+    }
+    
+    std::cout << "Body reader tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "http/file_cache.hpp"
+#include "http/body.hpp"
+#include "check.hpp"
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using https_server::FileCache;
+namespace fs = std::filesystem;
+
+static void write_file(const fs::path& path, const std::string& content) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+// Polls 'predicate' for up to two seconds, as inotify events arrive
+// asynchronously.
+template <typename Predicate>
+static bool eventually(Predicate predicate) {
+    for (int attempt = 0; attempt < 200; ++attempt) {
+        if (predicate()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+int main() {
+    const fs::path root = fs::temp_directory_path() / ("file_cache_test_" + std::to_string(getpid()));
+    fs::remove_all(root);
+    fs::create_directories(root / "css");
+    write_file(root / "index.html", "<h1>one</h1>");
+    write_file(root / "css" / "style.css", "body {}");
+    write_file(root / "large.bin", std::string(4096, 'x'));
+    
+    {
+        FileCache cache(root.string(), 16384, 2048);
+        CHECK(cache.watching());
+        
+        // A hit returns the same shared entry.
+        const auto first = cache.get("/index.html");
+        CHECK(first && first->content == "<h1>one</h1>");
+        CHECK(cache.get("/index.html") == first);
+        CHECK(cache.get("/css/style.css")->content == "body {}");
+        CHECK(cache.size() == 2);
+        
+        // Missing files and directories are not found.
+        CHECK(!cache.get("/missing.html"));
+        CHECK(!cache.get("/css"));
+        
+        // Files above the per-file limit are left to the caller.
+        CHECK(!cache.get("/large.bin"));
+        CHECK(cache.size() == 2);
+        
+        // A change is picked up; holders of the old entry keep it.
+        write_file(root / "index.html", "<h1>two</h1>");
+        CHECK(eventually([&] { return cache.get("/index.html")->content == "<h1>two</h1>"; }));
+        CHECK(first->content == "<h1>one</h1>");
+        CHECK(cache.get("/index.html")->version != first->version);
+        
+        // Validators come with each version.
+        CHECK(first->validators.etag == https_server::http::make_etag("<h1>one</h1>"));
+        CHECK(cache.get("/index.html")->validators.etag == https_server::http::make_etag("<h1>two</h1>"));
+        CHECK(!first->validators.last_modified.empty());
+        
+        // The modification time is the one a streamed copy would report.
+        const auto descriptor = https_server::http::FileDescriptor::open((root / "index.html").string());
+        CHECK(descriptor && cache.get("/index.html")->validators.modified == descriptor->modified_ns() / 1000000000);
+        
+        // So is a change in a subdirectory, including one created later.
+        write_file(root / "css" / "style.css", "body { margin: 0 }");
+        CHECK(eventually([&] { return cache.get("/css/style.css")->content == "body { margin: 0 }"; }));
+        fs::create_directories(root / "js" / "lib");
+        CHECK(eventually([&] {
+            write_file(root / "js" / "lib" / "app.js", "let a;");
+            return cache.get("/js/lib/app.js") != nullptr;
+        }));
+        write_file(root / "js" / "lib" / "app.js", "let b;");
+        CHECK(eventually([&] { return cache.get("/js/lib/app.js")->content == "let b;"; }));
+        
+        // Removing a file or its directory removes its entry.
+        fs::remove(root / "css" / "style.css");
+        CHECK(eventually([&] { return cache.get("/css/style.css") == nullptr; }));
+        fs::remove_all(root / "js");
+        CHECK(eventually([&] { return cache.get("/js/lib/app.js") == nullptr; }));
+        
+        // Replacing a file by renaming over it.
+        write_file(root / "index.new", "<h1>three</h1>");
+        fs::rename(root / "index.new", root / "index.html");
+        CHECK(eventually([&] { return cache.get("/index.html")->content == "<h1>three</h1>"; }));
+    }
+    
+    // The byte budget holds, and recently hit entries outlive the others.
+    {
+        for (int i = 0; i < 16; ++i) {
+            write_file(root / ("file" + std::to_string(i) + ".txt"), std::string(1000, static_cast<char>('a' + i)));
+        }
+        FileCache cache(root.string(), 4000, 2000);
+        const auto hot = cache.get("/file0.txt");
+        for (int i = 1; i < 16; ++i) {
+            CHECK(cache.get("/file" + std::to_string(i) + ".txt")->content.size() == 1000);
+            CHECK(cache.bytes() <= 4000);
+            cache.get("/file0.txt");
+        }
+        CHECK(cache.get("/file0.txt") == hot);
+    }
+    
+    // With no budget, nothing is cached.
+    {
+        FileCache cache(root.string(), 0, 0);
+        CHECK(!cache.get("/index.html"));
+        CHECK(cache.size() == 0 && !cache.watching());
+    }
+    
+    fs::remove_all(root);
+    std::cout << "File cache tests passed" << std::endl;
+    return 0;
+}
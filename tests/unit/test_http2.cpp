@@ -0,0 +1,359 @@
+#include "http/hpack.hpp"
+#include "http/http2.hpp"
+#include "http/router.hpp"
+#include "check.hpp"
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using https_server::Buffer;
+using https_server::Router;
+using https_server::http::HttpRequest;
+using https_server::http::HttpResponse;
+namespace http2 = https_server::http2;
+namespace hpack = https_server::http2::hpack;
+
+struct Frame {
+    std::uint8_t type;
+    std::uint8_t flags;
+    std::uint32_t stream_id;
+    std::string payload;
+};
+
+using Fields = std::vector<std::pair<std::string, std::string>>;
+
+static std::string hex(std::string_view text) {
+    std::string bytes;
+    for (size_t i = 0; i + 1 < text.size(); i += 2) {
+        bytes.push_back(static_cast<char>(std::stoi(std::string(text.substr(i, 2)), nullptr, 16)));
+    }
+    return bytes;
+}
+
+static std::string u32(std::uint32_t value) {
+    return {static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+            static_cast<char>(value >> 8), static_cast<char>(value)};
+}
+
+static std::string frame(std::uint8_t type, std::uint8_t flags, std::uint32_t stream_id, const std::string& payload) {
+    std::string out = u32(static_cast<std::uint32_t>(payload.size()) << 8).substr(0, 3);
+    out.push_back(static_cast<char>(type));
+    out.push_back(static_cast<char>(flags));
+    return out + u32(stream_id) + payload;
+}
+
+static std::string setting(std::uint16_t id, std::uint32_t value) {
+    return std::string{static_cast<char>(id >> 8), static_cast<char>(id)} + u32(value);
+}
+
+// The frames written to 'out', which is emptied; none when the last is cut
+// short, so that the caller's checks on them fail.
+static std::vector<Frame> frames(Buffer& out) {
+    std::vector<Frame> result;
+    const std::string_view view = out.readable_view();
+    size_t offset = 0;
+    while (offset + 9 <= view.size()) {
+        const auto* header = reinterpret_cast<const unsigned char*>(view.data() + offset);
+        const size_t length = static_cast<size_t>(header[0]) << 16 | static_cast<size_t>(header[1]) << 8 | header[2];
+        const std::uint32_t id = static_cast<std::uint32_t>(header[5] & 0x7f) << 24 |
+                                 static_cast<std::uint32_t>(header[6]) << 16 |
+                                 static_cast<std::uint32_t>(header[7]) << 8 | header[8];
+        result.push_back(Frame{header[3], header[4], id, std::string(view.substr(offset + 9, length))});
+        offset += 9 + length;
+    }
+    if (offset != view.size()) {
+        result.clear();
+    }
+    out.clear();
+    return result;
+}
+
+static Fields to_fields(const hpack::HeaderList& list) {
+    Fields fields;
+    for (size_t i = 0; i < list.size(); ++i) {
+        fields.emplace_back(list.name(i), list.value(i));
+    }
+    return fields;
+}
+
+static std::string encode(hpack::Encoder& encoder, const Fields& fields) {
+    std::string block;
+    encoder.begin_block(block);
+    for (const auto& [name, value] : fields) {
+        encoder.encode(name, value, hpack::Encoder::Indexing::Incremental, block);
+    }
+    return block;
+}
+
+static std::string request_headers(hpack::Encoder& encoder, std::uint32_t stream_id, const std::string& method,
+                                   const std::string& path, bool end_stream, const Fields& extra = {}) {
+    Fields fields = {{":method", method}, {":scheme", "https"}, {":path", path}, {":authority", "localhost"}};
+    fields.insert(fields.end(), extra.begin(), extra.end());
+    return frame(0x1, static_cast<std::uint8_t>(0x4 | (end_stream ? 0x1 : 0)), stream_id, encode(encoder, fields));
+}
+
+// Exchanges prefaces and reads the server's frames. Returns whether the
+// server answered with its SETTINGS, a WINDOW_UPDATE and the SETTINGS ACK.
+static bool open(http2::Session& session, Buffer& in, Buffer& out, std::vector<http2::Stream*>& ready,
+                 const std::string& settings = "") {
+    session.start(out);
+    const std::string preface = std::string(http2::CLIENT_PREFACE) + frame(0x4, 0, 0, settings);
+    in.append(preface);
+    if (!session.receive(in, out, ready)) {
+        return false;
+    }
+    const std::vector<Frame> sent = frames(out);
+    return sent.size() == 3 && sent[0].type == 0x4 && sent[0].flags == 0 && sent[0].payload.size() == 18 &&
+           sent[1].type == 0x8 && sent[1].stream_id == 0 && sent[2].type == 0x4 && sent[2].flags == 0x1;
+}
+
+static void add_routes(Router& router) {
+    router.add_route("GET", "/hello", [](const HttpRequest&) {
+        HttpResponse response;
+        response.body = "hello";
+        return response;
+    });
+    router.add_route("POST", "/echo", [](const HttpRequest& request) {
+        HttpResponse response;
+        response.body = std::string(request.body);
+        response.headers["Content-Type"] = "text/plain";
+        return response;
+    });
+}
+
+int main() {
+    // RFC 7541 C.4: three requests with Huffman coding, sharing one table.
+    {
+        hpack::Decoder decoder(4096, 65536);
+        hpack::HeaderList list;
+        CHECK(decoder.decode(hex("828684418cf1e3c2e5f23a6ba0ab90f4ff"), list) == hpack::Decoder::Status::Ok);
+        CHECK((to_fields(list) == Fields{{":method", "GET"}, {":scheme", "http"}, {":path", "/"},
+                                         {":authority", "www.example.com"}}));
+        CHECK(decoder.decode(hex("828684be5886a8eb10649cbf"), list) == hpack::Decoder::Status::Ok);
+        CHECK((to_fields(list) == Fields{{":method", "GET"}, {":scheme", "http"}, {":path", "/"},
+                                         {":authority", "www.example.com"}, {"cache-control", "no-cache"}}));
+        CHECK(decoder.decode(hex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"), list) ==
+              hpack::Decoder::Status::Ok);
+        CHECK((to_fields(list) == Fields{{":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"},
+                                         {":authority", "www.example.com"}, {"custom-key", "custom-value"}}));
+    }
+    
+    // Huffman coding round-trips every byte value, and rejects EOS.
+    {
+        std::string text;
+        for (int c = 0; c < 256; ++c) {
+            text.push_back(static_cast<char>(c));
+        }
+        std::string encoded;
+        hpack::huffman_encode(text, encoded);
+        CHECK(encoded.size() == hpack::huffman_encoded_size(text));
+        std::string decoded;
+        CHECK(hpack::huffman_decode(encoded, decoded) && decoded == text);
+        
+        encoded.clear();
+        hpack::huffman_encode("www.example.com", encoded);
+        CHECK(encoded == hex("f1e3c2e5f23a6ba0ab90f4ff"));
+        decoded.clear();
+        CHECK(!hpack::huffman_decode(hex("ffffffff"), decoded));
+    }
+    
+    // The encoder's output decodes to what went in, and fields seen before
+    // shrink to an index each.
+    {
+        hpack::Encoder encoder;
+        hpack::Decoder decoder(4096, 65536);
+        const Fields fields = {{":status", "200"}, {"content-type", "application/json"},
+                               {"x-request-id", "0123456789"}, {"server", "https-server"}};
+        const std::string first = encode(encoder, fields);
+        const std::string second = encode(encoder, fields);
+        CHECK(second.size() == fields.size());
+        
+        hpack::HeaderList list;
+        CHECK(decoder.decode(first, list) == hpack::Decoder::Status::Ok && to_fields(list) == fields);
+        CHECK(decoder.decode(second, list) == hpack::Decoder::Status::Ok && to_fields(list) == fields);
+        
+        // A smaller peer table is announced at the start of the next block.
+        encoder.set_max_table_size(0);
+        std::string block;
+        encoder.begin_block(block);
+        CHECK(block == hex("20"));
+        CHECK(decoder.decode(block + encode(encoder, {{"server", "x"}}), list) == hpack::Decoder::Status::Ok);
+        CHECK((to_fields(list) == Fields{{"server", "x"}}));
+    }
+    
+    // Malformed blocks, and blocks over the list limit.
+    {
+        hpack::Decoder decoder(4096, 64);
+        hpack::HeaderList list;
+        CHECK(decoder.decode(hex("80"), list) == hpack::Decoder::Status::Error);
+        CHECK(decoder.decode(hex("ff00"), list) == hpack::Decoder::Status::Error);
+        CHECK(decoder.decode(hex("3fe21f"), list) == hpack::Decoder::Status::Error);
+        CHECK(decoder.decode(hex("82ffffffffff0f"), list) == hpack::Decoder::Status::Error);
+        
+        hpack::Encoder encoder;
+        const std::string block = encode(encoder, {{"x-large", std::string(100, 'a')}});
+        CHECK(decoder.decode(block, list) == hpack::Decoder::Status::TooLarge);
+    }
+    
+    Router router;
+    add_routes(router);
+    http2::Session::Settings settings;
+    settings.max_concurrent_streams = 2;
+    
+    // A GET and a POST multiplexed on one connection.
+    {
+        http2::Session session(router, settings);
+        Buffer in;
+        Buffer out;
+        std::vector<http2::Stream*> ready;
+        CHECK(open(session, in, out, ready));
+        hpack::Encoder encoder;
+        hpack::Decoder decoder(4096, 65536);
+        
+        in.append(request_headers(encoder, 1, "GET", "/hello", true));
+        in.append(request_headers(encoder, 3, "POST", "/echo", false, {{"content-length", "4"}}));
+        in.append(frame(0x0, 0, 3, "pi"));
+        in.append(frame(0x0, 0x1, 3, "ng"));
+        CHECK(session.receive(in, out, ready));
+        CHECK(ready.size() == 2 && session.handling_streams() == 2);
+        CHECK(ready[0]->request.method == "GET" && ready[0]->request.uri == "/hello");
+        CHECK(ready[0]->request.http_version == "HTTP/2");
+        CHECK(ready[0]->request.find_header("Host") && *ready[0]->request.find_header("Host") == "localhost");
+        CHECK(ready[1]->request.body == "ping");
+        
+        for (http2::Stream* stream : ready) {
+            stream->response = router.route_request(stream->request);
+            session.respond(*stream);
+        }
+        session.write(out, 1 << 20);
+        
+        const std::vector<Frame> sent = frames(out);
+        std::vector<std::pair<std::uint32_t, std::string>> bodies;
+        for (const Frame& sent_frame : sent) {
+            if (sent_frame.type == 0x1) {
+                hpack::HeaderList list;
+                CHECK(decoder.decode(sent_frame.payload, list) == hpack::Decoder::Status::Ok);
+                const Fields fields = to_fields(list);
+                CHECK((fields[0] == std::pair<std::string, std::string>{":status", "200"}));
+            } else if (sent_frame.type == 0x0) {
+                CHECK(sent_frame.flags == 0x1);
+                bodies.emplace_back(sent_frame.stream_id, sent_frame.payload);
+            }
+        }
+        CHECK((bodies == std::vector<std::pair<std::uint32_t, std::string>>{{1, "hello"}, {3, "ping"}}));
+        CHECK(session.open_streams() == 0 && !session.finished());
+    }
+    
+    // A HEAD is answered from the GET route by HEADERS that end the stream
+    // and keep the content-length.
+    {
+        http2::Session session(router, settings);
+        Buffer in;
+        Buffer out;
+        std::vector<http2::Stream*> ready;
+        CHECK(open(session, in, out, ready));
+        hpack::Encoder encoder;
+        hpack::Decoder decoder(4096, 65536);
+        
+        in.append(request_headers(encoder, 1, "HEAD", "/hello", true));
+        CHECK(session.receive(in, out, ready) && ready.size() == 1);
+        ready[0]->response = router.route_request(ready[0]->request);
+        session.respond(*ready[0]);
+        session.write(out, 1 << 20);
+        
+        const std::vector<Frame> sent = frames(out);
+        CHECK(sent.size() == 1 && sent[0].type == 0x1 && sent[0].flags == 0x5);
+        hpack::HeaderList list;
+        CHECK(decoder.decode(sent[0].payload, list) == hpack::Decoder::Status::Ok);
+        const Fields fields = to_fields(list);
+        CHECK((fields[0] == std::pair<std::string, std::string>{":status", "200"}));
+        CHECK((fields[1] == std::pair<std::string, std::string>{"content-length", "5"}));
+        CHECK(session.open_streams() == 0);
+    }
+    
+    // Responses wait for the peer's flow-control windows.
+    {
+        http2::Session session(router, settings);
+        Buffer in;
+        Buffer out;
+        std::vector<http2::Stream*> ready;
+        CHECK(open(session, in, out, ready, setting(0x4, 3)));
+        hpack::Encoder encoder;
+        
+        in.append(request_headers(encoder, 1, "GET", "/hello", true));
+        CHECK(session.receive(in, out, ready) && ready.size() == 1);
+        ready[0]->response = router.route_request(ready[0]->request);
+        session.respond(*ready[0]);
+        ready.clear();
+        session.write(out, 1 << 20);
+        std::vector<Frame> sent = frames(out);
+        CHECK(sent.size() == 2 && sent[1].type == 0x0 && sent[1].payload == "hel" && sent[1].flags == 0);
+        
+        in.append(frame(0x8, 0, 1, u32(10)));
+        CHECK(session.receive(in, out, ready));
+        session.write(out, 1 << 20);
+        sent = frames(out);
+        CHECK(sent.size() == 1 && sent[0].payload == "lo" && sent[0].flags == 0x1);
+    }
+    
+    // Stream errors, refused streams and connection errors.
+    {
+        http2::Session session(router, settings);
+        Buffer in;
+        Buffer out;
+        std::vector<http2::Stream*> ready;
+        CHECK(open(session, in, out, ready));
+        hpack::Encoder encoder;
+        
+        // Uppercase names are malformed.
+        in.append(request_headers(encoder, 1, "GET", "/hello", true, {{"X-Upper", "1"}}));
+        CHECK(session.receive(in, out, ready) && ready.empty());
+        std::vector<Frame> sent = frames(out);
+        CHECK(sent.size() == 1 && sent[0].type == 0x3 && sent[0].payload == u32(0x1));
+        
+        // Past max_concurrent_streams.
+        in.append(request_headers(encoder, 3, "GET", "/hello", false));
+        in.append(request_headers(encoder, 5, "GET", "/hello", false));
+        in.append(request_headers(encoder, 7, "GET", "/hello", false));
+        CHECK(session.receive(in, out, ready) && session.open_streams() == 2);
+        sent = frames(out);
+        CHECK(sent.size() == 1 && sent[0].stream_id == 7 && sent[0].payload == u32(0x7));
+        
+        // PINGs are answered.
+        in.append(frame(0x6, 0, 0, "12345678"));
+        CHECK(session.receive(in, out, ready));
+        sent = frames(out);
+        CHECK(sent.size() == 1 && sent[0].flags == 0x1 && sent[0].payload == "12345678");
+        
+        // Data on an idle stream fails the connection.
+        in.append(frame(0x0, 0, 9, "x"));
+        CHECK(!session.receive(in, out, ready) && session.finished());
+        sent = frames(out);
+        CHECK(sent.size() == 1 && sent[0].type == 0x7 && sent[0].payload == u32(7) + u32(0x1));
+    }
+    
+    // The client must open with its preface and SETTINGS.
+    {
+        http2::Session session(router, settings);
+        Buffer in;
+        Buffer out;
+        std::vector<http2::Stream*> ready;
+        session.start(out);
+        frames(out);
+        in.append(std::string(http2::CLIENT_PREFACE) + frame(0x6, 0, 0, "12345678"));
+        CHECK(!session.receive(in, out, ready));
+        const std::vector<Frame> sent = frames(out);
+        CHECK(sent.size() == 1 && sent[0].type == 0x7);
+        
+        http2::Session http1(router, settings);
+        in.clear();
+        in.append(std::string("GET / HTTP/1.1\r\nHost: x\r\n\r\n"));
+        CHECK(!http1.receive(in, out, ready));
+    }
+    
+    std::cout << "HTTP/2 tests passed" << std::endl;
+    return 0;
+}
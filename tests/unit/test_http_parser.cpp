@@ -0,0 +1,191 @@
+#include "utils/http_accelerated.hpp"
+#include "check.hpp"
+#include <algorithm>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace https_server::http_accelerated;
+
+struct Parsed {
+    ParseStatus status;
+    ParseError error;
+    size_t header_length;
+    std::string method;
+    std::string uri;
+    std::string version;
+    std::vector<std::pair<std::string, std::string>> headers;
+    
+    bool operator==(const Parsed& other) const {
+        return status == other.status && error == other.error && header_length == other.header_length &&
+               method == other.method && uri == other.uri && version == other.version && headers == other.headers;
+    }
+};
+
+static Parsed capture(const RequestParser& parser, const char* data) {
+    Parsed parsed{parser.status(), parser.error(), parser.header_length(), {}, {}, {}, {}};
+    if (parser.status() == ParseStatus::Complete) {
+        parsed.method = std::string(parser.method().in(data));
+        parsed.uri = std::string(parser.uri().in(data));
+        parsed.version = std::string(parser.version().in(data));
+        for (const HeaderSpan* header = parser.headers_begin(); header != parser.headers_end(); ++header) {
+            parsed.headers.emplace_back(header->name.in(data), header->value.in(data));
+        }
+    }
+    return parsed;
+}
+
+static Parsed parse_whole(const std::string& raw, bool vectorized) {
+    RequestParser parser(vectorized);
+    parser.parse(raw.data(), raw.size());
+    return capture(parser, raw.data());
+}
+
+// Feeds the request in 'step'-byte reads, copying it to a fresh buffer each
+// time the way a growing receive buffer would move.
+static Parsed parse_split(const std::string& raw, size_t step, bool vectorized) {
+    RequestParser parser(vectorized);
+    std::vector<char> buffer;
+    for (size_t len = 0; len < raw.size();) {
+        len = std::min(raw.size(), len + step);
+        buffer.assign(raw.begin(), raw.begin() + static_cast<std::ptrdiff_t>(len));
+        if (parser.parse(buffer.data(), buffer.size()) != ParseStatus::Incomplete) {
+            break;
+        }
+    }
+    return capture(parser, buffer.data());
+}
+
+// The error both scan paths report, or nothing when they disagree.
+static std::optional<ParseError> error_of(const std::string& raw) {
+    const Parsed vectorized = parse_whole(raw, HttpOps::instance().has_avx2());
+    const Parsed scalar = parse_whole(raw, false);
+    if (!(vectorized == scalar)) {
+        return std::nullopt;
+    }
+    return vectorized.error;
+}
+
+int main() {
+    const bool avx2 = HttpOps::instance().has_avx2();
+    
+    // A typical request, split at every possible point, on both scan paths.
+    {
+        const std::string raw =
+            "GET /api/items?id=42&sort=desc HTTP/1.1\r\n"
+            "Host: example.com\r\n"
+            "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+            "Accept:text/html,application/xhtml+xml;q=0.9\r\n"
+            "X-Padded: \t value with  inner spaces \t \r\n"
+            "Cookie: a=1; b=\xc3\xa9\r\n"
+            "\r\n"
+            "trailing body bytes";
+        
+        const Parsed expected = parse_whole(raw, false);
+        CHECK(expected.status == ParseStatus::Complete);
+        CHECK(expected.header_length == raw.find("\r\n\r\n") + 4);
+        CHECK(expected.method == "GET");
+        CHECK(expected.uri == "/api/items?id=42&sort=desc");
+        CHECK(expected.version == "HTTP/1.1");
+        CHECK(expected.headers.size() == 5);
+        CHECK(expected.headers[0].first == "Host" && expected.headers[0].second == "example.com");
+        CHECK(expected.headers[2].second == "text/html,application/xhtml+xml;q=0.9");
+        CHECK(expected.headers[3].second == "value with  inner spaces");
+        CHECK(expected.headers[4].second == "a=1; b=\xc3\xa9");
+        
+        for (const bool vectorized : {false, avx2}) {
+            CHECK(parse_whole(raw, vectorized) == expected);
+            for (size_t step = 1; step <= 64; ++step) {
+                CHECK(parse_split(raw, step, vectorized) == expected);
+            }
+        }
+        
+        RequestParser parser;
+        parser.parse(raw.data(), raw.size());
+        CHECK(parser.minor_version() == 1);
+        parser.reset();
+        CHECK(parser.status() == ParseStatus::Incomplete && parser.header_count() == 0);
+    }
+    
+    // Incomplete until the blank line arrives; empty lines before the
+    // request line are skipped.
+    {
+        RequestParser parser;
+        const std::string partial = "\r\n\r\nGET / HTTP/1.0\r\nHost: a\r\n";
+        CHECK(parser.parse(partial.data(), partial.size()) == ParseStatus::Incomplete);
+        const std::string full = partial + "\r\n";
+        CHECK(parser.parse(full.data(), full.size()) == ParseStatus::Complete);
+        CHECK(parser.method().in(full.data()) == "GET");
+        CHECK(parser.minor_version() == 0);
+        CHECK(parser.header_length() == full.size());
+    }
+    
+    // Precise error codes.
+    {
+        CHECK(error_of("GET / HTTP/1.1\r\nHost: a\r\n\r\n") == ParseError::None);
+        CHECK(error_of(" GET / HTTP/1.1\r\n\r\n") == ParseError::InvalidMethod);
+        CHECK(error_of("G(T / HTTP/1.1\r\n\r\n") == ParseError::InvalidMethod);
+        CHECK(error_of("GET  / HTTP/1.1\r\n\r\n") == ParseError::InvalidUri);
+        CHECK(error_of("GET /a\x7f HTTP/1.1\r\n\r\n") == ParseError::InvalidUri);
+        CHECK(error_of("GET / HTTP/2.0\r\n\r\n") == ParseError::InvalidVersion);
+        CHECK(error_of("GET / HTTP/1.2\r\n\r\n") == ParseError::InvalidVersion);
+        CHECK(error_of("GET / HTTP/1.1 \r\n\r\n") == ParseError::InvalidVersion);
+        CHECK(error_of("GET / HTTP/1.1\nHost: a\r\n\r\n") == ParseError::InvalidLineEnding);
+        CHECK(error_of("GET / HTTP/1.1\r\nHost: a\nX: b\r\n\r\n") == ParseError::InvalidLineEnding);
+        CHECK(error_of("GET / HTTP/1.1\r\nHost : a\r\n\r\n") == ParseError::InvalidHeaderName);
+        CHECK(error_of("GET / HTTP/1.1\r\n: a\r\n\r\n") == ParseError::InvalidHeaderName);
+        CHECK(error_of("GET / HTTP/1.1\r\nX: a\r\n folded\r\n\r\n") == ParseError::InvalidHeaderName);
+        CHECK(error_of("GET / HTTP/1.1\r\nX: a\x01" "b\r\n\r\n") == ParseError::InvalidHeaderValue);
+        
+        RequestParser parser;
+        const std::string raw = "GET / HTTP/1.1\r\nHost : a\r\n\r\n";
+        CHECK(parser.parse(raw.data(), raw.size()) == ParseStatus::Error);
+        CHECK(parser.error_offset() == raw.find(" :"));
+        CHECK(std::string_view(to_string(parser.error())) == "invalid header field name");
+    }
+    
+    // Header count and size limits.
+    {
+        std::string raw = "GET / HTTP/1.1\r\n";
+        for (size_t i = 0; i < RequestParser::MAX_HEADERS; ++i) {
+            raw += "X-" + std::to_string(i) + ": v\r\n";
+        }
+        CHECK(error_of(raw + "\r\n") == ParseError::None);
+        CHECK(error_of(raw + "X-Last: v\r\n\r\n") == ParseError::TooManyHeaders);
+        
+        const std::string flood = "GET / HTTP/1.1\r\nX: " + std::string(RequestParser::MAX_HEADER_BYTES, 'a');
+        RequestParser parser;
+        CHECK(parser.parse(flood.data(), flood.size()) == ParseStatus::Error);
+        CHECK(parser.error() == ParseError::HeadersTooLarge);
+    }
+    
+    // The vector and scalar scans agree on randomly corrupted requests,
+    // including bytes that land inside long (multi-vector) tokens.
+    {
+        const std::string base =
+            "POST /upload/some/fairly/long/path/that/spans/more/than/one/vector HTTP/1.1\r\n"
+            "Content-Type: multipart/form-data; boundary=----WebKitFormBoundary7MA4YWxkTrZu0gW\r\n"
+            "X-Very-Long-Header-Name-That-Crosses-A-Vector-Boundary: 1\r\n"
+            "\r\n";
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<size_t> position(0, base.size() - 5);
+        std::uniform_int_distribution<int> byte(0, 255);
+        
+        size_t errors = 0;
+        for (int i = 0; i < 20000; ++i) {
+            std::string raw = base;
+            raw[position(rng)] = static_cast<char>(byte(rng));
+            const Parsed scalar = parse_whole(raw, false);
+            CHECK(parse_whole(raw, avx2) == scalar);
+            CHECK(parse_split(raw, 7, avx2) == scalar);
+            errors += scalar.status == ParseStatus::Error;
+        }
+        CHECK(errors > 0);
+    }
+    
+    std::cout << "HTTP parser tests passed (AVX2 " << (avx2 ? "on" : "off") << ")" << std::endl;
+    return 0;
+}
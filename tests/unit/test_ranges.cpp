@@ -0,0 +1,141 @@
+#include "http/ranges.hpp"
+#include "check.hpp"
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <unistd.h>
+
+using namespace https_server::http;
+namespace fs = std::filesystem;
+
+// The ranges parsed from 'header', or nothing when it does not parse to
+// 'expected'.
+static std::optional<std::vector<ByteRange>> parse(const std::string& header, std::uint64_t size,
+                                                   RangeStatus expected) {
+    std::vector<ByteRange> ranges;
+    const RangeStatus status = parse_range(header, size, ranges);
+    if (status != expected) {
+        return std::nullopt;
+    }
+    return ranges;
+}
+
+static bool same(const std::optional<std::vector<ByteRange>>& ranges, std::initializer_list<ByteRange> expected) {
+    if (!ranges || ranges->size() != expected.size()) {
+        return false;
+    }
+    size_t i = 0;
+    for (const ByteRange& range : expected) {
+        if ((*ranges)[i].offset != range.offset || (*ranges)[i].length != range.length) {
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+// Runs 'producer' to the end in pieces of at most 'piece' bytes, or returns
+// nothing if it produces more than asked for or stalls before the end.
+static std::optional<std::string> drain(RangesProducer& producer, size_t piece) {
+    std::string out;
+    bool done = false;
+    while (!done) {
+        const size_t size = out.size();
+        out.resize(size + piece);
+        const size_t produced = producer.produce(out.data() + size, piece, done);
+        if (produced > piece || (produced == 0 && !done)) {
+            return std::nullopt;
+        }
+        out.resize(size + produced);
+    }
+    return out;
+}
+
+int main() {
+    // Range forms, clamped to the representation.
+    CHECK(same(parse("bytes=0-99", 1000, RangeStatus::Satisfiable), {{0, 100}}));
+    CHECK(same(parse("bytes=900-", 1000, RangeStatus::Satisfiable), {{900, 100}}));
+    CHECK(same(parse("bytes=-100", 1000, RangeStatus::Satisfiable), {{900, 100}}));
+    CHECK(same(parse("bytes=-5000", 1000, RangeStatus::Satisfiable), {{0, 1000}}));
+    CHECK(same(parse("bytes=990-2000", 1000, RangeStatus::Satisfiable), {{990, 10}}));
+    CHECK(same(parse("Bytes = 5-9", 1000, RangeStatus::Satisfiable), {{5, 5}}));
+    
+    // Several ranges are sorted, and overlapping or adjacent ones merged;
+    // the unsatisfiable among them are dropped.
+    CHECK(same(parse("bytes=500-599, 0-9", 1000, RangeStatus::Satisfiable), {{0, 10}, {500, 100}}));
+    CHECK(same(parse("bytes=0-9,5-19,20-29", 1000, RangeStatus::Satisfiable), {{0, 30}}));
+    CHECK(same(parse("bytes=0-0,5000-6000", 1000, RangeStatus::Satisfiable), {{0, 1}}));
+    
+    // Nothing in range is a 416; anything malformed is ignored.
+    CHECK(parse("bytes=1000-", 1000, RangeStatus::Unsatisfiable));
+    CHECK(parse("bytes=-0", 1000, RangeStatus::Unsatisfiable));
+    CHECK(parse("bytes=0-", 0, RangeStatus::Unsatisfiable));
+    CHECK(parse("items=0-9", 1000, RangeStatus::Ignored));
+    CHECK(parse("bytes=", 1000, RangeStatus::Ignored));
+    CHECK(parse("bytes=9-0", 1000, RangeStatus::Ignored));
+    CHECK(parse("bytes=a-b", 1000, RangeStatus::Ignored));
+    CHECK(parse("bytes=0-9,x", 1000, RangeStatus::Ignored));
+    CHECK(parse("bytes=+1-2", 1000, RangeStatus::Ignored));
+    std::string many = "bytes=0-0";
+    for (size_t i = 1; i <= MAX_RANGES; ++i) {
+        many += "," + std::to_string(i * 2) + "-" + std::to_string(i * 2);
+    }
+    CHECK(parse(many, 1000, RangeStatus::Ignored));
+    
+    CHECK(content_range({0, 100}, 1000) == "bytes 0-99/1000");
+    
+    std::string content;
+    for (int i = 0; i < 50000; ++i) {
+        content += static_cast<char>('a' + i % 26);
+    }
+    const fs::path path = fs::temp_directory_path() / ("ranges_test_" + std::to_string(getpid()));
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << content;
+    }
+    const auto buffer = std::make_shared<const std::string>(content);
+    const auto file = FileDescriptor::open(path.string());
+    CHECK(file);
+    
+    // A single range is the bytes alone, from either source.
+    {
+        const std::vector<ByteRange> ranges{{1000, 30000}};
+        RangesProducer from_buffer(buffer, ranges, "text/plain");
+        CHECK(from_buffer.content_type() == "text/plain" && from_buffer.length() == 30000);
+        CHECK(drain(from_buffer, 16384) == content.substr(1000, 30000));
+        RangesProducer from_file(file, ranges, "text/plain");
+        CHECK(drain(from_file, 7) == content.substr(1000, 30000));
+    }
+    
+    // Several are multipart/byteranges, the same from either source, and as
+    // long as announced.
+    {
+        const std::vector<ByteRange> ranges{{0, 10}, {20000, 20000}, {49990, 10}};
+        RangesProducer from_buffer(buffer, ranges, "text/plain");
+        const std::string type = from_buffer.content_type();
+        CHECK(type.rfind("multipart/byteranges; boundary=", 0) == 0);
+        const std::string boundary = type.substr(type.find('=') + 1);
+        const std::optional<std::string> body = drain(from_buffer, 1000);
+        CHECK(body && body->size() == from_buffer.length());
+        
+        std::string expected;
+        for (const ByteRange& range : ranges) {
+            expected += "\r\n--" + boundary + "\r\nContent-Type: text/plain\r\nContent-Range: " +
+                        content_range(range, content.size()) + "\r\n\r\n" +
+                        content.substr(static_cast<size_t>(range.offset), static_cast<size_t>(range.length));
+        }
+        expected += "\r\n--" + boundary + "--\r\n";
+        CHECK(body == expected);
+        
+        RangesProducer from_file(file, ranges, "text/plain");
+        const std::optional<std::string> file_body = drain(from_file, 16384);
+        CHECK(file_body && file_body->size() == from_file.length());
+        CHECK(file_body->find(content.substr(20000, 20000)) != std::string::npos);
+    }
+    
+    fs::remove(path);
+    std::cout << "Range tests passed" << std::endl;
+    return 0;
+}
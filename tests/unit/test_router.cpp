@@ -0,0 +1,172 @@
+#include "http/router.hpp"
+#include "check.hpp"
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using https_server::Router;
+using https_server::http::HttpRequest;
+using https_server::http::HttpResponse;
+
+// Each handler answers with its own name so the test can see which matched.
+static void add(Router& router, const std::string& method, const std::string& pattern) {
+    router.add_route(method, pattern, [pattern](const HttpRequest&) {
+        HttpResponse response;
+        response.body = pattern;
+        return response;
+    });
+}
+
+// The request views 'method' and 'uri', so callers pass literals.
+static std::string route(const Router& router, std::string_view method, std::string_view uri,
+                         HttpRequest* out = nullptr) {
+    HttpRequest request;
+    request.method = method;
+    request.uri = uri;
+    const HttpResponse response = router.route_request(request);
+    if (out) {
+        *out = request;
+    }
+    return response.status_code == 404 ? "404" : std::string(response.body);
+}
+
+static bool throws(Router& router, const std::string& method, const std::string& pattern) {
+    try {
+        add(router, method, pattern);
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+int main() {
+    Router router;
+    add(router, "GET", "/");
+    add(router, "GET", "/about");
+    add(router, "GET", "/api/benchmark");
+    add(router, "GET", "/api/stats");
+    add(router, "POST", "/api/echo");
+    add(router, "GET", "/users/new");
+    add(router, "GET", "/users/:id");
+    add(router, "DELETE", "/users/:id");
+    add(router, "GET", "/users/:id/posts/:post");
+    add(router, "GET", "/static/*path");
+    add(router, "GET", "/*");
+    add(router, "PURGE", "/cache/*");
+    
+    // Static routes, split edges and the query string.
+    {
+        CHECK(route(router, "GET", "/") == "/");
+        CHECK(route(router, "GET", "/about") == "/about");
+        CHECK(route(router, "GET", "/about?x=1") == "/about");
+        CHECK(route(router, "GET", "/api/benchmark") == "/api/benchmark");
+        CHECK(route(router, "GET", "/api/stats") == "/api/stats");
+        CHECK(route(router, "POST", "/api/echo") == "/api/echo");
+        CHECK(route(router, "POST", "/api/stats") == "404");
+        CHECK(route(router, "PUT", "/about") == "404");
+        CHECK(route(router, "POST", "/api/ech") == "404");
+    }
+    
+    // Parameters, and static text winning over them.
+    {
+        HttpRequest request;
+        CHECK(route(router, "GET", "/users/new", &request) == "/users/new");
+        CHECK(request.params.empty());
+        
+        CHECK(route(router, "GET", "/users/ne", &request) == "/users/:id");
+        CHECK(request.find_param("id") && *request.find_param("id") == "ne");
+        CHECK(route(router, "GET", "/users/newer", &request) == "/users/:id");
+        CHECK(*request.find_param("id") == "newer");
+        CHECK(route(router, "DELETE", "/users/new", &request) == "/users/:id");
+        CHECK(*request.find_param("id") == "new");
+        
+        CHECK(route(router, "GET", "/users/42/posts/7?full=1", &request) == "/users/:id/posts/:post");
+        CHECK(request.params.size() == 2);
+        CHECK(*request.find_param("id") == "42" && *request.find_param("post") == "7");
+        CHECK(!request.find_param("missing"));
+        
+        // An empty segment is not a parameter; the catch-all takes it.
+        CHECK(route(router, "GET", "/users/", &request) == "/*");
+        CHECK(route(router, "DELETE", "/users/") == "404");
+        CHECK(route(router, "DELETE", "/users/42/posts/7") == "404");
+    }
+    
+    // Wildcards capture the rest of the path, and backtracking keeps the
+    // captures of abandoned branches out of the result.
+    {
+        HttpRequest request;
+        CHECK(route(router, "GET", "/static/css/site.css", &request) == "/static/*path");
+        CHECK(request.params.size() == 1 && *request.find_param("path") == "css/site.css");
+        CHECK(route(router, "GET", "/static/", &request) == "/static/*path");
+        CHECK(*request.find_param("path") == "");
+        
+        CHECK(route(router, "GET", "/users/42/comments", &request) == "/*");
+        CHECK(request.params.size() == 1 && *request.find_param("*") == "users/42/comments");
+        CHECK(route(router, "GET", "/index.html", &request) == "/*");
+        
+        CHECK(route(router, "PURGE", "/cache/a/b") == "/cache/*");
+        CHECK(route(router, "GET", "/cache/a/b") == "/*");
+        CHECK(route(router, "GET", "*") == "404");
+    }
+    
+    // HEAD is answered by the GET route unless it has one of its own.
+    {
+        HttpRequest request;
+        CHECK(route(router, "HEAD", "/about") == "/about");
+        CHECK(route(router, "HEAD", "/users/42", &request) == "/users/:id");
+        CHECK(request.params.size() == 1 && *request.find_param("id") == "42");
+        CHECK(route(router, "HEAD", "*") == "404");
+        
+        Router own;
+        add(own, "GET", "/page");
+        add(own, "HEAD", "/:name");
+        CHECK(route(own, "HEAD", "/page") == "/:name");
+        CHECK(route(own, "GET", "/page") == "/page");
+    }
+    
+    // Registration order does not matter.
+    {
+        Router reversed;
+        add(reversed, "GET", "/*");
+        add(reversed, "GET", "/files/:name");
+        add(reversed, "GET", "/files/index");
+        CHECK(route(reversed, "GET", "/files/index") == "/files/index");
+        CHECK(route(reversed, "GET", "/files/other") == "/files/:name");
+        CHECK(route(reversed, "GET", "/files/a/b") == "/*");
+    }
+    
+    // Streaming routes are found through the same tree.
+    {
+        Router streaming;
+        streaming.add_streaming_route("POST", "/upload/:bucket", [](const HttpRequest&) {
+            return std::unique_ptr<https_server::StreamingHandler>();
+        });
+        add(streaming, "GET", "/upload/:bucket");
+        
+        HttpRequest request;
+        request.method = "POST";
+        request.uri = "/upload/photos";
+        CHECK(streaming.find_streaming_route(request));
+        CHECK(*request.find_param("bucket") == "photos");
+        request.method = "GET";
+        CHECK(!streaming.find_streaming_route(request));
+    }
+    
+    // Malformed and conflicting patterns.
+    {
+        CHECK(throws(router, "GET", "about"));
+        CHECK(throws(router, "GET", "/about"));
+        CHECK(throws(router, "GET", "/users/:name"));
+        CHECK(throws(router, "GET", "/x/:"));
+        CHECK(throws(router, "GET", "/x/*/y"));
+        CHECK(throws(router, "GET", "/static/*file"));
+        CHECK(throws(router, "GET", "/:a/:b/:c/:d/:e/:f/:g/:h/:i"));
+        CHECK(!throws(router, "POST", "/about"));
+        CHECK(!throws(router, "GET", "/users/:id/avatar"));
+    }
+    
+    std::cout << "Router tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include "core/timer_wheel.hpp"
+#include "check.hpp"
+#include <iostream>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+using https_server::Timer;
+using https_server::TimerWheel;
+
+int main() {
+    // Every timer fires exactly on its tick, across all levels.
+    {
+        TimerWheel wheel(1000);
+        constexpr size_t count = 20000;
+        std::vector<std::unique_ptr<Timer>> timers;
+        std::vector<std::uint64_t> expected(count);
+        std::vector<std::uint64_t> fired(count, 0);
+        
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<std::uint64_t> small(1, 200);
+        std::uniform_int_distribution<std::uint64_t> large(1, 300000);
+        
+        for (size_t i = 0; i < count; ++i) {
+            const std::uint64_t delay = (i % 2) ? small(rng) : large(rng);
+            expected[i] = wheel.now() + delay;
+            timers.push_back(std::make_unique<Timer>([&wheel, &fired, i] { fired[i] = wheel.now(); }));
+            wheel.schedule(*timers[i], delay);
+        }
+        CHECK(wheel.size() == count);
+        
+        // Advance in uneven steps, as a loop waking up late would.
+        std::uint64_t now = wheel.now();
+        while (!wheel.empty()) {
+            now += 1 + (now % 97);
+            wheel.advance(now);
+        }
+        
+        for (size_t i = 0; i < count; ++i) {
+            CHECK(fired[i] == expected[i]);
+        }
+    }
+    
+    // Cancel, re-arm and destruction unlink the node.
+    {
+        TimerWheel wheel;
+        int fired = 0;
+        Timer timer([&fired] { ++fired; });
+        
+        wheel.schedule(timer, 50);
+        CHECK(timer.armed());
+        timer.cancel();
+        CHECK(!timer.armed() && wheel.empty());
+        wheel.advance(100);
+        CHECK(fired == 0);
+        
+        wheel.schedule(timer, 10);
+        wheel.schedule(timer, 500);
+        CHECK(wheel.size() == 1);
+        wheel.advance(110);
+        CHECK(fired == 0);
+        wheel.advance(600);
+        CHECK(fired == 1);
+        
+        {
+            Timer scoped([&fired] { ++fired; });
+            wheel.schedule(scoped, 5);
+        }
+        CHECK(wheel.empty());
+        wheel.advance(700);
+        CHECK(fired == 1);
+    }
+    
+    // A callback may re-arm its own timer and cancel others due on the same tick.
+    {
+        TimerWheel wheel;
+        int repeats = 0;
+        int other_fired = 0;
+        Timer other([&other_fired] { ++other_fired; });
+        Timer repeating;
+        repeating.set_callback([&] {
+            ++repeats;
+            other.cancel();
+            if (repeats < 3) {
+                wheel.schedule(repeating, 10);
+            }
+        });
+        
+        wheel.schedule(other, 10);
+        wheel.schedule(repeating, 10);
+        wheel.advance(1000);
+        CHECK(repeats == 3);
+        CHECK(other_fired == 0);
+        CHECK(wheel.empty());
+    }
+    
+    // One-shot timers are owned by the wheel, fired once and freed.
+    {
+        TimerWheel wheel;
+        int fired = 0;
+        wheel.schedule_once(0, [&fired] { ++fired; });
+        wheel.schedule_once(70000, [&fired] { ++fired; });
+        wheel.advance(1);
+        CHECK(fired == 1);
+        wheel.advance(70000);
+        CHECK(fired == 2 && wheel.empty());
+        
+        wheel.schedule_once(10, [&fired] { ++fired; });
+    }
+    
+    // next_event never overshoots the earliest expiry.
+    {
+        TimerWheel wheel(5);
+        Timer near([] {});
+        Timer far([] {});
+        CHECK(wheel.next_event() == -1);
+        
+        wheel.schedule(far, 5000);
+        CHECK(wheel.next_event() > 0 && wheel.next_event() <= 5000);
+        wheel.schedule(near, 20);
+        CHECK(wheel.next_event() == 20);
+    }
+    
+    std::cout << "SUCCESS: All timer wheel tests passed." << std::endl;
+    return 0;
+}
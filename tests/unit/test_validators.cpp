@@ -0,0 +1,70 @@
+#include "http/validators.hpp"
+#include "check.hpp"
+#include <openssl/sha.h>
+#include <iostream>
+#include <cstring>
+#include <string>
+
+using namespace https_server::http;
+
+int main() {
+    // SHA-256 against OpenSSL, across the one- and two-block padding cases.
+    for (size_t length : {0, 1, 3, 55, 56, 63, 64, 65, 119, 120, 128, 1000}) {
+        std::string data;
+        for (size_t i = 0; i < length; ++i) {
+            data += static_cast<char>('a' + i % 26);
+        }
+        unsigned char expected[SHA256_DIGEST_LENGTH];
+        SHA256(reinterpret_cast<const unsigned char*>(data.data()), data.size(), expected);
+        CHECK(std::memcmp(sha256(data).data(), expected, sizeof(expected)) == 0);
+    }
+    
+    // Entity tags are quoted, stable and differ with the contents.
+    const std::string etag = make_etag("abc");
+    CHECK(etag == "\"ba7816bf8f01cfea414140de5dae2223\"");
+    CHECK(make_etag("abc") == etag && make_etag("abd") != etag);
+    CHECK(coded_etag(etag, "br") == "\"ba7816bf8f01cfea414140de5dae2223-br\"");
+    
+    // If-None-Match lists, with weak comparison and coded variants.
+    CHECK(match_etag(etag, etag) == etag);
+    CHECK(match_etag("W/" + etag, etag) == etag);
+    CHECK(match_etag("\"x\", " + etag, etag) == etag);
+    CHECK(match_etag("*", etag) == etag);
+    const std::string coded = coded_etag(etag, "gzip");
+    CHECK(match_etag(coded, etag) == coded);
+    CHECK(match_etag("\"x\", \"y\"", etag).empty());
+    CHECK(match_etag(make_etag("abd"), etag).empty());
+    CHECK(match_etag("\"ba7816bf8f01cfea414140de5dae2223x\"", etag).empty());
+    CHECK(match_etag("\"unterminated", etag).empty());
+    CHECK(match_etag("", etag).empty());
+    
+    // HTTP-dates in all three forms, and back.
+    const std::int64_t when = 784111777;
+    CHECK(format_http_date(when) == "Sun, 06 Nov 1994 08:49:37 GMT");
+    CHECK(parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT") == when);
+    CHECK(parse_http_date("Sunday, 06-Nov-94 08:49:37 GMT") == when);
+    CHECK(parse_http_date("Sun Nov  6 08:49:37 1994") == when);
+    CHECK(parse_http_date(format_http_date(1700000000)) == 1700000000);
+    CHECK(parse_http_date("Thu, 01 Jan 1970 00:00:00 GMT") == 0);
+    CHECK(parse_http_date("Tue, 29 Feb 2028 12:00:00 GMT") == 1835438400);
+    CHECK(parse_http_date("") == -1);
+    CHECK(parse_http_date("yesterday") == -1);
+    CHECK(parse_http_date("Sun, 06 Nov 1994 08:49:37") == -1);
+    CHECK(parse_http_date("Sun, 06 Foo 1994 08:49:37 GMT") == -1);
+    CHECK(parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT trailing") == -1);
+    
+    // If-Range needs the exact tag or modification time.
+    Validators validators;
+    validators.etag = etag;
+    validators.modified = when;
+    validators.last_modified = format_http_date(when);
+    CHECK(if_range_matches(etag, validators));
+    CHECK(if_range_matches(validators.last_modified, validators));
+    CHECK(!if_range_matches("W/" + etag, validators));
+    CHECK(!if_range_matches(coded, validators));
+    CHECK(!if_range_matches(format_http_date(when - 1), validators));
+    CHECK(!if_range_matches("", validators));
+    
+    std::cout << "Validator tests passed" << std::endl;
+    return 0;
+}